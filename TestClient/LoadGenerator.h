@@ -0,0 +1,497 @@
+#pragma once
+
+#include <engine/NetworkEngine.h>
+#include <engine/protocol/CompactObject.h>
+#include <game/SectorSnapshot.h>
+#include <game/coordinate/Fixture.h>
+#include <concurrent/ConcurrentMap.h>
+#include <utility/Metrics.h>
+#include <utility/Random.h>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string_view>
+
+enum class LoadScenario : uint8_t
+{
+    // every bot connects at once, then walks randomly
+    LoginStorm,
+    // bots connect at connect rate and change direction randomly
+    RandomWalk,
+    // bots walk straight out of spawn sector and back, crossing sector borders together
+    BorderSwarm,
+    // bots walk to one point and crowd around it
+    Hotspot,
+};
+
+struct LoadOption
+{
+    LoadScenario scenario = LoadScenario::RandomWalk;
+
+    uint32_t bot_count = 200;
+    uint32_t bots_per_engine = 1000;
+    uint32_t duration_s = 60;
+
+    // ignored by login storm
+    uint32_t connect_per_second = 500;
+
+    uint32_t move_interval_ms = 500;
+
+    // border swarm turns back every period, long enough to cross border of spawn sector
+    uint32_t border_swarm_period_ms = 10000;
+
+    Vector2 hotspot_offset{ 1500, 1500 };
+    CoordinateUnit hotspot_radius = 300;
+};
+
+// process wide instruments, shared by bot workers of all engines
+class LoadStatistics
+{
+private:
+    static utility::MetricRegistry* Registry()
+    {
+        return utility::MetricRegistry::GetInstance();
+    }
+
+public:
+    static utility::MetricCounter* ConnectRequests()
+    {
+        static utility::MetricCounter* metric = Registry()->Counter("loadgen_connect_requests_total", "connector sockets registered");
+        return metric;
+    }
+
+    static utility::MetricCounter* Connected()
+    {
+        static utility::MetricCounter* metric = Registry()->Counter("loadgen_connected_total", "sessions created with server");
+        return metric;
+    }
+
+    static utility::MetricCounter* Entered()
+    {
+        static utility::MetricCounter* metric = Registry()->Counter("loadgen_entered_total", "bots received game enter response");
+        return metric;
+    }
+
+    static utility::MetricCounter* DisconnectedBeforeEnter()
+    {
+        static utility::MetricCounter* metric = Registry()->Counter("loadgen_disconnects_total", "sessions closed by server or network", "phase=\"enter\"");
+        return metric;
+    }
+
+    static utility::MetricCounter* DisconnectedInGame()
+    {
+        static utility::MetricCounter* metric = Registry()->Counter("loadgen_disconnects_total", "sessions closed by server or network", "phase=\"game\"");
+        return metric;
+    }
+
+    static utility::MetricCounter* MoveRequests()
+    {
+        static utility::MetricCounter* metric = Registry()->Counter("loadgen_move_requests_total", "move requests sent");
+        return metric;
+    }
+
+    static utility::MetricCounter* MoveResponses()
+    {
+        static utility::MetricCounter* metric = Registry()->Counter("loadgen_move_responses_total", "move responses received");
+        return metric;
+    }
+
+    static utility::MetricCounter* UnansweredMoves()
+    {
+        static utility::MetricCounter* metric = Registry()->Counter("loadgen_unanswered_moves_total", "move requests dropped from pending list without response");
+        return metric;
+    }
+
+    static utility::MetricCounter* MovePushes()
+    {
+        static utility::MetricCounter* metric = Registry()->Counter("loadgen_move_pushes_total", "move pushes of other objects received");
+        return metric;
+    }
+
+    static utility::MetricCounter* Snapshots()
+    {
+        static utility::MetricCounter* metric = Registry()->Counter("loadgen_snapshots_total", "sector snapshots received");
+        return metric;
+    }
+
+    static utility::MetricHistogram* EnterLatency()
+    {
+        static utility::MetricHistogram* metric = Registry()->Histogram("loadgen_enter_latency_us", "connect request to game enter response");
+        return metric;
+    }
+
+    static utility::MetricHistogram* MoveLatency()
+    {
+        static utility::MetricHistogram* metric = Registry()->Histogram("loadgen_move_latency_us", "move request to move response of same bot");
+        return metric;
+    }
+
+    static utility::MetricHistogram* PushLatency()
+    {
+        static utility::MetricHistogram* metric = Registry()->Histogram("loadgen_push_latency_us", "move request of a bot to move push arrival at another bot");
+        return metric;
+    }
+};
+
+inline int64_t LoadTickUs()
+{
+    return utility::CurrentTick<utility::Microseconds>().count();
+}
+
+// last move request of every bot, matched against move pushes arriving at other bots
+struct MoveStamp
+{
+    Vector2 position;
+    int64_t sent_us = 0;
+};
+
+// state shared by engines, bot index is attachment of connector socket
+struct LoadContext
+{
+    LoadOption option;
+
+    std::unique_ptr<std::atomic<int64_t>[]> connect_request_us;
+    ConcurrentMap<uint64_t, MoveStamp> last_moves;
+
+    Vector2 spawn_position;
+
+    LoadContext(const LoadOption& load_option) : option(load_option), connect_request_us(new std::atomic<int64_t>[load_option.bot_count])
+    {
+        spawn_position = GetSectorFixtureRectangle(CenterSector.sector_id).Center();
+    }
+};
+
+// direction of 8 closest to vector, y is up
+inline Direction GetDirectionToward(const Vector2 from, const Vector2 to)
+{
+    double angle = std::atan2(static_cast<double>(to.x - from.x), static_cast<double>(to.y - from.y));
+    int32_t index = static_cast<int32_t>(std::lround(angle / (3.14159265358979323846 / 4)));
+
+    return static_cast<Direction>((index + 8) % 8);
+}
+
+class BotWorker : public NetworkEngineWorker
+{
+private:
+    // server pushes more moves than a bot sends, pending list is bounded for lost responses
+    static constexpr std::size_t MAX_PENDING_MOVE_COUNT = 64;
+
+    struct Bot
+    {
+        SocketSessionPtr session;
+        uint64_t bot_index = 0;
+
+        Fixture fixture;
+        bool entered = false;
+        int64_t entered_us = 0;
+        int64_t next_move_us = 0;
+
+        // send time of move requests waiting for response, responses keep request order
+        std::deque<int64_t> pending_moves;
+
+        // received sector snapshots, key: sequence
+        uint64_t snapshot_sector_id = INVALID_SECTOR;
+        std::map<uint32_t, std::vector<PacketObjectInfo>> snapshots;
+    };
+
+    LoadContext* const _load_context;
+    std::unordered_map<uint64_t, Bot> _bots;
+
+    Direction PlanDirection(const Bot& bot, const int64_t now_us) const
+    {
+        const LoadOption& option = _load_context->option;
+
+        switch (option.scenario)
+        {
+        case LoadScenario::BorderSwarm:
+        {
+            // up, right, down, left by bot, reversed every period
+            Direction outward = static_cast<Direction>((bot.bot_index % 4) * 2);
+            int64_t period_index = (now_us - bot.entered_us) / (static_cast<int64_t>(option.border_swarm_period_ms) * 1000);
+
+            return period_index % 2 == 0 ? outward : GetOpositeDirection(outward);
+        }
+        case LoadScenario::Hotspot:
+        {
+            Vector2 hotspot{ _load_context->spawn_position.x + option.hotspot_offset.x, _load_context->spawn_position.y + option.hotspot_offset.y };
+
+            CoordinateUnit distance_x = hotspot.x - bot.fixture.position.x;
+            CoordinateUnit distance_y = hotspot.y - bot.fixture.position.y;
+
+            if (distance_x * distance_x + distance_y * distance_y > option.hotspot_radius * option.hotspot_radius)
+                return GetDirectionToward(bot.fixture.position, hotspot);
+
+            break;
+        }
+        default:
+            break;
+        }
+
+        return static_cast<Direction>(utility::RandomUint64() % 8);
+    }
+
+    void SendMove(Bot& bot, const int64_t now_us)
+    {
+        bot.fixture.direction = PlanDirection(bot, now_us);
+
+        packet_character_move_rq packet;
+        packet.direction = bot.fixture.direction;
+        packet.object_id = bot.fixture.id;
+        packet.starting_position = bot.fixture.position;
+
+        if (bot.pending_moves.size() >= MAX_PENDING_MOVE_COUNT)
+        {
+            bot.pending_moves.pop_front();
+            LoadStatistics::UnansweredMoves()->Add(1);
+        }
+
+        bot.pending_moves.push_back(now_us);
+        _load_context->last_moves.Insert(bot.fixture.id, MoveStamp{ bot.fixture.position, now_us });
+
+        bot.session->Send(packet);
+
+        LoadStatistics::MoveRequests()->Add(1);
+    }
+
+    void OnGameEntered(Bot& bot, const packet_game_enter_request_rs& packet)
+    {
+        int64_t now_us = LoadTickUs();
+
+        bot.fixture = packet.object_info.fixture;
+        bot.entered = true;
+        bot.entered_us = now_us;
+
+        // spread first moves over one interval
+        bot.next_move_us = now_us + static_cast<int64_t>(utility::RandomUint64() % (_load_context->option.move_interval_ms * 1000 + 1));
+
+        LoadStatistics::Entered()->Add(1);
+        LoadStatistics::EnterLatency()->Record(static_cast<uint64_t>(now_us - _load_context->connect_request_us[bot.bot_index].load(std::memory_order_relaxed)));
+    }
+
+    void OnMoveResponse(Bot& bot, const packet_character_move_rs& packet)
+    {
+        LoadStatistics::MoveResponses()->Add(1);
+
+        if (bot.pending_moves.empty())
+            return;
+
+        LoadStatistics::MoveLatency()->Record(static_cast<uint64_t>(LoadTickUs() - bot.pending_moves.front()));
+        bot.pending_moves.pop_front();
+    }
+
+    void OnMovePush(Bot& bot, const packet_object_move_ps& packet)
+    {
+        LoadStatistics::MovePushes()->Add(1);
+
+        // push of a move which is not the latest one of its bot is not measured
+        MoveStamp stamp;
+        if (!_load_context->last_moves.TryGet(packet.object_id, stamp) || stamp.position.x != packet.starting_position.x || stamp.position.y != packet.starting_position.y)
+            return;
+
+        LoadStatistics::PushLatency()->Record(static_cast<uint64_t>(LoadTickUs() - stamp.sent_us));
+    }
+
+    void OnSectorSnapshot(Bot& bot, const SocketSessionPtr& session, const packet_sector_snapshot_ps& packet)
+    {
+        LoadStatistics::Snapshots()->Add(1);
+
+        if (bot.snapshot_sector_id != packet.sector_id)
+        {
+            bot.snapshot_sector_id = packet.sector_id;
+            bot.snapshots.clear();
+        }
+
+        // baselines older than acknowledged one are never referenced again
+        bot.snapshots.erase(bot.snapshots.begin(), bot.snapshots.lower_bound(packet.baseline_sequence));
+
+        auto baseline = bot.snapshots.find(packet.baseline_sequence);
+        if (packet.baseline_sequence != 0 && baseline == bot.snapshots.end())
+        {
+            LOG(LogLevel::Warn, "snapshot baseline not found %llu, %u", packet.sector_id, packet.baseline_sequence);
+            return;
+        }
+
+        static const std::vector<PacketObjectInfo> empty_baseline;
+
+        std::vector<PacketObjectInfo> object_list;
+        if (!ApplySectorSnapshotPacket(packet.baseline_sequence == 0 ? empty_baseline : baseline->second, packet, object_list))
+        {
+            LOG(LogLevel::Warn, "invalid sector snapshot %llu, %u", packet.sector_id, packet.sequence);
+            return;
+        }
+
+        bot.snapshots[packet.sequence] = std::move(object_list);
+
+        packet_sector_snapshot_ack_rq ack;
+        ack.sector_id = packet.sector_id;
+        ack.sequence = packet.sequence;
+
+        session->Send(ack);
+    }
+
+public:
+    BotWorker(LoadContext* const load_context) : _load_context(load_context) {}
+
+    virtual void OnSocketSessionConnected(SocketContext* context) override
+    {
+        Bot& bot = _bots[context->session->GetSessionId()];
+        bot.session = context->session;
+        bot.bot_index = context->attachment;
+
+        LoadStatistics::Connected()->Add(1);
+    }
+
+    virtual void OnSocketSessionClosed(SocketContext* context) override
+    {
+        auto bot_iterator = _bots.find(context->session->GetSessionId());
+        if (bot_iterator == _bots.end())
+            return;
+
+        if (bot_iterator->second.entered)
+            LoadStatistics::DisconnectedInGame()->Add(1);
+        else
+            LoadStatistics::DisconnectedBeforeEnter()->Add(1);
+
+        _bots.erase(bot_iterator);
+    }
+
+    virtual void OnSocketSessionData(SocketContext* context) override
+    {
+        auto bot_iterator = _bots.find(context->session->GetSessionId());
+        if (bot_iterator == _bots.end())
+            return;
+
+        Bot& bot = bot_iterator->second;
+
+        switch (context->header.packet_type)
+        {
+        case PacketType::packet_game_enter_request_rs:
+        {
+            packet_game_enter_request_rs packet;
+            if (DeserializePacketBody(context->buffer.Data(), context->header.body_size, packet))
+                OnGameEntered(bot, packet);
+
+            break;
+        }
+        case PacketType::packet_character_move_rs:
+        {
+            packet_character_move_rs packet;
+            if (DeserializePacketBody(context->buffer.Data(), context->header.body_size, packet))
+                OnMoveResponse(bot, packet);
+
+            break;
+        }
+        case PacketType::packet_object_move_ps:
+        {
+            packet_object_move_ps packet;
+            if (DeserializePacketBody(context->buffer.Data(), context->header.body_size, packet))
+                OnMovePush(bot, packet);
+
+            break;
+        }
+        case PacketType::packet_compact_object_list_ps:
+        {
+            packet_compact_object_list_ps packet;
+            if (!DeserializePacketBody(context->buffer.Data(), context->header.body_size, packet))
+                break;
+
+            std::vector<PacketObjectInfo> object_list;
+            if (!DecodeCompactObjectBlock(packet.sector_id, packet.objects, object_list))
+                LOG(LogLevel::Warn, "invalid compact object list %llu", packet.sector_id);
+
+            break;
+        }
+        case PacketType::packet_sector_snapshot_ps:
+        {
+            packet_sector_snapshot_ps packet;
+            if (DeserializePacketBody(context->buffer.Data(), context->header.body_size, packet))
+                OnSectorSnapshot(bot, context->session, packet);
+
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    virtual bool Update(const WorkerTimeUnit current_time, const WorkerTimeUnit delta_time) override
+    {
+        int64_t now_us = LoadTickUs();
+        int64_t move_interval_us = static_cast<int64_t>(_load_context->option.move_interval_ms) * 1000;
+
+        for (auto& pair : _bots)
+        {
+            Bot& bot = pair.second;
+            if (!bot.entered)
+                continue;
+
+            bot.fixture.Move(delta_time);
+
+            if (bot.next_move_us > now_us)
+                continue;
+
+            bot.next_move_us += move_interval_us;
+            if (bot.next_move_us <= now_us)
+                bot.next_move_us = now_us + move_interval_us;
+
+            SendMove(bot, now_us);
+        }
+
+        return true;
+    }
+};
+
+inline const char* GetLoadScenarioName(const LoadScenario scenario)
+{
+    constexpr std::array<const char*, 4> names{ "login_storm", "random_walk", "border_swarm", "hotspot" };
+
+    return names[static_cast<std::size_t>(scenario)];
+}
+
+inline bool ParseLoadScenario(const std::string_view name, LoadScenario& scenario)
+{
+    for (uint8_t index = 0; index < 4; index++)
+    {
+        if (name == GetLoadScenarioName(static_cast<LoadScenario>(index)))
+        {
+            scenario = static_cast<LoadScenario>(index);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline void PrintLatency(const char* const name, const utility::MetricHistogram* const histogram)
+{
+    utility::HistogramSnapshot snapshot;
+    histogram->Snapshot(snapshot);
+
+    std::printf("  %-16s count %10llu  mean %8llu  p50 %8llu  p90 %8llu  p99 %8llu  p99.9 %8llu us\n", name,
+        snapshot.count, snapshot.count == 0 ? 0 : snapshot.sum / snapshot.count,
+        snapshot.Quantile(0.5), snapshot.Quantile(0.9), snapshot.Quantile(0.99), snapshot.Quantile(0.999));
+}
+
+// latency quantiles are upper bounds of histogram buckets
+inline void PrintLoadSummary(const LoadOption& option, const uint32_t engine_count, const double elapsed_s)
+{
+    uint64_t move_responses = LoadStatistics::MoveResponses()->Value();
+    uint64_t move_pushes = LoadStatistics::MovePushes()->Value();
+    uint64_t snapshots = LoadStatistics::Snapshots()->Value();
+
+    std::printf("\n==== load summary: %s, %u bots, %u engines, %.1f s ====\n", GetLoadScenarioName(option.scenario), option.bot_count, engine_count, elapsed_s);
+    std::printf("sessions\n");
+    std::printf("  requested %llu, connected %llu, entered %llu\n", LoadStatistics::ConnectRequests()->Value(), LoadStatistics::Connected()->Value(), LoadStatistics::Entered()->Value());
+    std::printf("  disconnected before enter %llu, in game %llu\n", LoadStatistics::DisconnectedBeforeEnter()->Value(), LoadStatistics::DisconnectedInGame()->Value());
+    std::printf("throughput\n");
+    std::printf("  move requests %llu, responses %llu (%.1f/s), unanswered %llu\n", LoadStatistics::MoveRequests()->Value(), move_responses, move_responses / elapsed_s, LoadStatistics::UnansweredMoves()->Value());
+    std::printf("  move pushes %llu (%.1f/s), snapshots %llu (%.1f/s)\n", move_pushes, move_pushes / elapsed_s, snapshots, snapshots / elapsed_s);
+    std::printf("  read %.2f MB/s\n", static_cast<double>(EngineMetrics::ReadBytes()->Value()) / elapsed_s / (1024.0 * 1024.0));
+    std::printf("latency\n");
+    PrintLatency("enter", LoadStatistics::EnterLatency());
+    PrintLatency("move response", LoadStatistics::MoveLatency());
+    PrintLatency("move push", LoadStatistics::PushLatency());
+}
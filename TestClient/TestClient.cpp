@@ -1,126 +1,117 @@
 ﻿
 #include <iostream>
-#include <engine/NetworkEngine.h>
 #include <engine/CloudConfigManager.h>
 #include <network/iocp/IocpSocketServer.h>
-#include <game/coordinate/Fixture.h>
-#include <utility/Sampling.h>
-#include <random>
-
-struct SessionFixture
-{
-    Fixture fixture;
-    SocketSessionPtr session;
-};
-
-class ClientWorker : public NetworkEngineWorker
+#include "LoadGenerator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+/*
+    TestClient [scenario] [bot count] [duration s] [host] [port]
+
+    scenario    login_storm | random_walk | border_swarm | hotspot
+    bots are spread over engines of bots_per_engine, summary is printed when duration ends
+*/
+int main(int argc, char* argv[])
 {
-private:
-    std::unordered_map<uint64_t, SessionFixture> _sessions;
-
-    utility::Timer<utility::Milliseconds> _timer = (utility::Milliseconds(500));
+    LoadOption option;
+    std::string host = "127.0.0.1";
+    uint16_t port = 9997;
 
-public:
-    virtual void OnSocketSessionConnected(SocketContext* context)
+    if (argc > 1 && !ParseLoadScenario(argv[1], option.scenario))
     {
-        _sessions[context->session->GetSessionId()] = { {}, context->session };
+        std::printf("unknown scenario %s\n", argv[1]);
+        return 1;
     }
 
-    virtual void OnSocketSessionClosed(SocketContext* context)
-    {
-        _sessions.erase(context->session->GetSessionId());
-    }
+    if (argc > 2)
+        option.bot_count = static_cast<uint32_t>(std::stoul(argv[2]));
+    if (argc > 3)
+        option.duration_s = static_cast<uint32_t>(std::stoul(argv[3]));
+    if (argc > 4)
+        host = argv[4];
+    if (argc > 5)
+        port = static_cast<uint16_t>(std::stoul(argv[5]));
 
-    virtual void OnSocketSessionData(SocketContext* context)
-    {
-        if (context->header.packet_type == PacketType::packet_game_enter_request_rs)
-        {
-            packet_game_enter_request_rs packet;
-            DeserializePacketBody(context->buffer.Data(), context->buffer.RemainBytes(), packet);
+    utility::Logger::InitializeLogger(4096, 4);
+    InitializeSocketService();
 
-            packet.object_info.fixture.user_data = reinterpret_cast<uint64_t>(context->session._UnsafePtr());
+    LoadContext* load_context = new LoadContext(option);
 
-            _sessions[context->session->GetSessionId()].fixture = packet.object_info.fixture;
-        }
-        else if (context->header.packet_type == PacketType::packet_object_list_ps)
-        {
-            int a = 10;
-        }
-    }
+    // one socket server, engine and bot worker per bots_per_engine bots
+    uint32_t engine_count = (option.bot_count + option.bots_per_engine - 1) / option.bots_per_engine;
+    std::vector<NetworkEngine*> engines;
 
-    virtual bool Update(const WorkerTimeUnit current_time, const WorkerTimeUnit delta_time)
+    for (uint32_t engine_index = 0; engine_index < engine_count; engine_index++)
     {
-        for (auto& pair : _sessions)
-        {
-            if (pair.second.fixture.id != 0)
-                pair.second.fixture.Move(delta_time);
-        }
-        if (_timer)
-        {
-            for (auto& pair : _sessions)
-            {
-                SocketSessionPtr ptr = pair.second.session;
+        SocketServerConfig config;
+        config.read_buffer_capacity = 16384;
+        config.read_buffer_pool_size = 4;
+        config.write_buffer_capacity = 16384;
+        config.write_buffer_pool_size = 4;
+        config.max_connectable_socket_count = option.bots_per_engine;
+        config.update_tick = 500;
+        config.worker_count = 2;
 
-                if (pair.second.fixture.id == 0)
-                    continue;
+        NetworkEngineOption engine_option;
+        engine_option.max_session_count = option.bots_per_engine;
+        engine_option.session_idle_timeout_ms = 5000;
+        engine_option.session_heartbeat_interval_ms = 2000;
+        engine_option.socket_idle_timeout_ms = 5000;
+        engine_option.use_session_reconnect = false;
+        engine_option.worker_update_tick_ms = 33;
 
-                Direction random_direction = static_cast<Direction>(utility::RandomUint64() % 8);
-                pair.second.fixture.direction = random_direction;
+        IocpSocketServer* user_server = new IocpSocketServer();
 
-                packet_character_move_rq packet;
-                packet.direction = pair.second.fixture.direction;
-                packet.object_id = pair.second.fixture.id;
-                packet.starting_position = pair.second.fixture.position;
+        if (!user_server->Initialize(config))
+            throw std::exception("failed to initialize user server");
 
-                reinterpret_cast<SocketSession*>(pair.second.fixture.user_data)->Send(packet);
-            }
-            
+        NetworkEngine* user_server_engine = new NetworkEngine();
 
-        }
+        user_server_engine->Initialize(engine_option, user_server, new BotWorker(load_context));
 
-        return true;
+        if (user_server_engine->Start() != 0)
+            throw std::exception("failed to start user server engine");
+
+        engines.push_back(user_server_engine);
     }
-};
-#include <deque>
 
-int main()
-{
-    atomic_queue::AtomicQueueB<int*>* q = new atomic_queue::AtomicQueueB<int*>(1024);
+    SocketAddress address = SocketAddress::New(host, port);
 
-    utility::Logger::InitializeLogger(4096, 4);
-    InitializeSocketService();
+    utility::Nanoseconds start = utility::CurrentTick();
 
-    std::this_thread::sleep_for(utility::Seconds(3));
-    SocketServerConfig config;
-    config.read_buffer_capacity = 131072;
-    config.read_buffer_pool_size = 8;
-    config.max_connectable_socket_count = 1024;
-    config.update_tick = 500;
-    config.worker_count = 2;
+    // login storm connects every bot at once, others ramp up by connect rate
+    uint32_t connect_batch = option.scenario == LoadScenario::LoginStorm ? option.bot_count : std::max<uint32_t>(1, option.connect_per_second / 10);
 
-    NetworkEngineOption option;
-    option.max_session_count = 1024;
-    option.session_idle_timeout_ms = 5000;
-    option.session_heartbeat_interval_ms = 2000;
-    option.socket_idle_timeout_ms = 5000;
-    option.use_session_reconnect = false;
-    option.worker_update_tick_ms = 33;
+    uint32_t bot_index = 0;
+    utility::Timer<utility::Milliseconds> progress_timer(utility::Milliseconds(5000));
 
-    IocpSocketServer* user_server = new IocpSocketServer();
+    while (utility::CurrentTick() - start < utility::Seconds(option.duration_s))
+    {
+        for (uint32_t count = 0; count < connect_batch && bot_index < option.bot_count; count++, bot_index++)
+        {
+            load_context->connect_request_us[bot_index].store(LoadTickUs(), std::memory_order_relaxed);
+            engines[bot_index / option.bots_per_engine]->RegisterConnectorSocket(address, bot_index);
 
-    if (!user_server->Initialize(config))
-        throw std::exception("failed to initialize user server");
+            LoadStatistics::ConnectRequests()->Add();
+        }
 
-    NetworkEngine* user_server_engine = new NetworkEngine();
+        if (progress_timer)
+        {
+            LOG(LogLevel::Info, "connected %llu, entered %llu, move responses %llu, disconnected %llu",
+                LoadStatistics::Connected()->Value(), LoadStatistics::Entered()->Value(), LoadStatistics::MoveResponses()->Value(),
+                LoadStatistics::DisconnectedBeforeEnter()->Value() + LoadStatistics::DisconnectedInGame()->Value());
+        }
 
-    user_server_engine->Initialize(option, user_server, new ClientWorker());
+        std::this_thread::sleep_for(utility::Milliseconds(100));
+    }
 
-    if (user_server_engine->Start() != 0)
-        throw std::exception("failed to start user server engine");
+    double elapsed_s = static_cast<double>((utility::CurrentTick() - start).count()) / 1e9;
 
-    for (int index = 0; index < 200; index++)
-        user_server_engine->RegisterConnectorSocket(SocketAddress::New("127.0.0.1", 9997), 0);
+    PrintLoadSummary(option, engine_count, elapsed_s);
+    std::fflush(stdout);
 
-    while (true)
-        std::this_thread::sleep_for(utility::Seconds(60));
-}
\ No newline at end of file
+    // engines have no shutdown path, workers are still running
+    std::quick_exit(0);
+}
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <engine/NetworkEngine.h>
 #include <engine/CloudConfigManager.h>
+#include <engine/MetricsServer.h>
 #include <network/iocp/IocpSocketServer.h>
 #include "agency/AgencyWorker.h"
 #include "agency/PacketHandler.h"
@@ -17,6 +18,10 @@ int main()
 
     ServerConfig config = config_manager->GetCloudConfig();
 
+    MetricsServer* metrics_server = new MetricsServer();
+    if (config.metrics_listen_port != 0 && !metrics_server->Start(config.metrics_listen_port))
+        throw std::exception("failed to start metrics server");
+
     IocpSocketServer* intra_server = new IocpSocketServer();
     IocpSocketServer* user_server = new IocpSocketServer();
 
@@ -39,7 +44,12 @@ int main()
     PacketHandler* packet_handler = new PacketHandler(agency);
 
     intra_server_engine->Initialize(config.intra_network_engine_option, intra_server, *agency);
-    user_server_engine->Initialize(config.user_network_engine_option, user_server, *agency);
+    uint32_t client_shard_count = std::max<uint32_t>(1, config.game_config.client_shard_count);
+    user_server_engine->Initialize(
+        config.user_network_engine_option,
+        user_server,
+        agency->CreateClientShards(client_shard_count, utility::Milliseconds(config.game_config.packet_batch_process_time_ms))
+    );
 
     agency->SetPacketHandler(packet_handler);
     if (!agency->Initialize(
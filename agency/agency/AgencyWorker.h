@@ -14,12 +14,13 @@ class AgencyWorker : public GameServer
 private:
 	PacketHandler* _packet_handler = nullptr;
 
-	std::unordered_map<uint64_t, UniversalSessionInfo*> _object_sessions;
-
-	uint32_t a1 = 0;
-	uint32_t a2 = 0;
+	// key: object id, value: user id (universal session id of client shard)
+	std::unordered_map<uint64_t, uint64_t> _object_sessions;
 
 	friend PacketHandler;
+
+	// client packet guard, user must own a character
+	bool CheckClientAuthorized(UniversalSessionInfo* client_session);
 public:
 
 	virtual bool InitializeGameServer() override { return true; }
@@ -33,9 +34,6 @@ public:
 	virtual void OnIntraServerConnected(IntraServerInfo* server_session) override;
 	virtual void OnIntraServerAccepted(IntraServerInfo* server_session) override;
 	virtual void OnIntraServerClosed(IntraServerInfo* server_session) override;
-
-	virtual void OnClientData(UniversalSessionInfo* client_session, const PacketHeader& header, const DynamicBufferCursor<SocketBuffer>& buffer) override;
-	virtual void OnIntraServerData(IntraServerInfo* server_session, const PacketHeader& header, const DynamicBufferCursor<SocketBuffer>& buffer) override;
 };
 
 
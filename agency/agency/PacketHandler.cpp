@@ -1,4 +1,5 @@
 #include "PacketHandler.h"
+#include <engine/PacketTrace.h>
 
 /*
 void PacketHandler::OnUserGameEnterReq(UniversalSessionInfo* const session_info, const PacketHeader& header, const packet_game_enter_request_rq& packet)
@@ -40,12 +41,13 @@ void PacketHandler::OnUserGameEnterReq(UniversalSessionInfo* const session_info,
 }
 */
 
-void PacketHandler::OnUserMoveReq(UniversalSessionInfo* const session_info, const PacketHeader& header, packet_character_move_rq& packet)
+// client shard thread
+void PacketHandler::OnUserMoveReq(UniversalSessionInfo* const session_info, const PacketHeader& header, const packet_character_move_rq& packet)
 {
 	uint64_t current_sector_id = session_info->session->GetUserData<AgencySessionValue, uint64_t>(AgencySessionValue::SectorId);
 	uint64_t object_id = session_info->session->GetUserData<AgencySessionValue, uint64_t>(AgencySessionValue::ObjectId);
 
-	const SocketSessionPtr& play_session = _agency->_sector_posting_manager->GetSectorOwnerSession(current_sector_id);
+	const SocketSessionPtr& play_session = session_info->shard->GetSectorPostingManager()->GetSectorOwnerSession(current_sector_id);
 	if (!play_session.Valid())
 	{
 		LOG(LogLevel::Error, "play server session not found %llu", current_sector_id);
@@ -53,12 +55,13 @@ void PacketHandler::OnUserMoveReq(UniversalSessionInfo* const session_info, cons
 		return;
 	}
 
-	packet.sector_id = current_sector_id;
-	packet.object_id = object_id;
+	packet_character_move_rq request = packet;
+	request.sector_id = current_sector_id;
+	request.object_id = object_id;
 
-	packet.to_owner = true;
+	request.to_owner = true;
 
-	_agency->_packet_throttler->PostPacket(play_session, packet, PacketPostingPolicy::Immediate);
+	session_info->shard->GetPacketThrottler()->PostPacket(play_session, request, PacketPostingPolicy::Immediate);
 }
 
 void PacketHandler::OnPlayMoveCharacterRes(IntraServerInfo* const server, const PacketHeader& header, const packet_character_move_rs& packet)
@@ -77,13 +80,27 @@ void PacketHandler::OnPlayMoveCharacterRes(IntraServerInfo* const server, const
 		return;
 	}
 
+	uint64_t user_id = session_iter->second;
+
 	std::unordered_map<uint64_t, Fixture>& sector_objects = _object_cache[packet.sector_id];
 	Fixture& fixture = sector_objects[packet.object_id];
 	fixture.direction = packet.direction;
 	fixture.position = packet.starting_position;
 	fixture.last_transform_time = _agency->_current_epoch_timestamp.count();
 
-	session_iter->second->session->Send(packet);
+	MarkObjectDirty(packet.sector_id, packet.object_id);
+
+	// shard queue is a hop of move trace
+	_agency->PostToClientShard(user_id, [user_id, packet, trace = TraceHandoff::Capture()](ClientShard* const shard) {
+		RunTraced(trace, "client_shard", [&]() {
+			UniversalSessionInfo* session_info = shard->GetClientSession(user_id);
+			if (session_info != nullptr)
+				session_info->session->Send(packet);
+		});
+	});
+
+	if (UseSnapshotReplication())
+		return;
 	
 	packet_object_move_ps response;
 	response.object_id = packet.object_id;
@@ -91,56 +108,115 @@ void PacketHandler::OnPlayMoveCharacterRes(IntraServerInfo* const server, const
 	response.direction = packet.direction;
 	response.starting_position = packet.starting_position;
 
-	_agency->_sector_posting_manager->SendToSectorWithout(session_iter->second->universal_session_id, response, packet.sector_id);
+	_agency->BroadcastToClientSector(response, packet.sector_id, user_id);
 }
 
-void PacketHandler::OnPlaySpawnCharacterRes(IntraServerInfo* const server, const PacketHeader& header, packet_spawn_character_rs& packet)
+async_simple::coro::Lazy<void> PacketHandler::SpawnCharacter(SocketSessionPtr play_session, packet_spawn_character_rq request)
+{
+	CallResult<packet_spawn_character_rs> result = co_await _agency->_call_manager->Call<packet_spawn_character_rs>(play_session, request, utility::Milliseconds(3000));
+
+	if (result.status != CallStatus::Success || result.error_code != ErrorCode::None)
+	{
+		LOG(LogLevel::Warn, "failed to spawn character %llu, status: %d, error: %d", request.user_id, static_cast<int32_t>(result.status), static_cast<int32_t>(result.error_code));
+
+		uint64_t user_id = request.user_id;
+		_agency->PostToClientShard(user_id, [user_id](ClientShard* const shard) {
+			UniversalSessionInfo* session_info = shard->GetClientSession(user_id);
+			if (session_info != nullptr)
+				session_info->session->CloseSession();
+		});
+
+		co_return;
+	}
+
+	OnCharacterSpawned(play_session, result.packet);
+}
+
+void PacketHandler::OnPlayLateSpawnCharacterRes(IntraServerInfo* const server, const PacketHeader& header, const packet_spawn_character_rs& packet)
+{
+	if (header.error_code != ErrorCode::None)
+		return;
+
+	LOG(LogLevel::Warn, "late spawn response, remove character %llu of user %llu", packet.object_info.object_id, packet.user_id);
+
+	packet_remove_character_rq request;
+	request.user_id = packet.user_id;
+	request.sector_id = packet.object_info.sector_id;
+	request.object_id = packet.object_info.object_id;
+	request.to_owner = true;
+
+	server->session->Send(request);
+}
+
+void PacketHandler::OnCharacterSpawned(const SocketSessionPtr& play_session, packet_spawn_character_rs& packet)
 {
 	std::unordered_map<uint64_t, Fixture>& sector_objects = _object_cache[packet.object_info.sector_id];
 	packet.object_info.fixture.last_transform_time = _agency->_current_epoch_timestamp.count();
 
 	sector_objects[packet.object_info.object_id] = packet.object_info.fixture;
 
-	auto iter = _agency->_active_sessions.find(packet.user_id);
-	if (iter == _agency->_active_sessions.end())
-	{
-		LOG(LogLevel::Warn, "character is spawned successfully, but user offline %llu, %llu", packet.user_id, packet.object_info.sector_id);
+	_agency->_object_sessions[packet.object_info.object_id] = packet.user_id;
 
-		packet_remove_character_rs request;
-		request.object_id = packet.object_info.object_id;
-		request.sector_id = packet.object_info.sector_id;
-		request.user_id = packet.user_id;
-		
-		server->session->Send(request);
+	MarkObjectDirty(packet.object_info.sector_id, packet.object_info.object_id);
 
-		return;
-	}
+	bool use_snapshot_replication = UseSnapshotReplication();
+
+	packet_compact_object_list_ps object_push;
+	if (!use_snapshot_replication)
+		object_push = MakeObjectListPacket(packet.object_info.sector_id);
+
+	AgencyWorker* agency = _agency;
+
+	_agency->PostToClientShard(packet.user_id, [agency, play_session, packet, object_push, use_snapshot_replication](ClientShard* const shard) {
+		UniversalSessionInfo* session_info = shard->GetClientSession(packet.user_id);
+		if (session_info == nullptr)
+		{
+			LOG(LogLevel::Warn, "character is spawned successfully, but user offline %llu, %llu", packet.user_id, packet.object_info.sector_id);
+
+			packet_remove_character_rs request;
+			request.object_id = packet.object_info.object_id;
+			request.sector_id = packet.object_info.sector_id;
+			request.user_id = packet.user_id;
+
+			play_session->Send(request);
 
-	const SocketSessionPtr& client_session = iter->second.session;
+			uint64_t object_id = packet.object_info.object_id;
+			agency->PostToGameServer([agency, object_id]() {
+				agency->_object_sessions.erase(object_id);
+			});
 
-	client_session->SetUserData(AgencySessionValue::SectorId, packet.object_info.sector_id);
-	client_session->SetUserData(AgencySessionValue::Nickname, reinterpret_cast<uint64_t>(new std::string(packet.nickname)));
-	client_session->SetUserData(AgencySessionValue::UserId, packet.user_id);
-	client_session->SetUserData(AgencySessionValue::ObjectId, packet.object_info.object_id);
+			return;
+		}
 
-	_agency->_object_sessions[packet.object_info.object_id] = &iter->second;
+		const SocketSessionPtr& client_session = session_info->session;
 
-	packet_create_object_ps broadcast;
-	broadcast.object_info = packet.object_info;
+		client_session->SetUserData(AgencySessionValue::SectorId, packet.object_info.sector_id);
+		client_session->SetUserData(AgencySessionValue::Nickname, reinterpret_cast<uint64_t>(new std::string(packet.nickname)));
+		client_session->SetUserData(AgencySessionValue::UserId, packet.user_id);
+		client_session->SetUserData(AgencySessionValue::ObjectId, packet.object_info.object_id);
 
-	_agency->_sector_posting_manager->SendToSector(broadcast, packet.object_info.sector_id);
+		if (!use_snapshot_replication)
+		{
+			packet_compact_create_object_ps broadcast;
+			broadcast.sector_id = packet.object_info.sector_id;
+			EncodeCompactObjectBlock(packet.object_info, broadcast.objects);
 
-	_agency->_sector_posting_manager->AddSectorListener(packet.object_info.sector_id, packet.user_id);
+			agency->BroadcastToClientSector(broadcast, packet.object_info.sector_id, packet.user_id);
+		}
 
-	packet_game_enter_request_rs user_response;
-	user_response.nickname = packet.nickname;
-	user_response.object_info = packet.object_info;
+		shard->GetSectorPostingManager()->AddSectorListener(packet.object_info.sector_id, packet.user_id);
 
-	client_session->Send(user_response);
+		packet_game_enter_request_rs user_response;
+		user_response.nickname = packet.nickname;
+		user_response.object_info = packet.object_info;
 
-	packet_object_list_ps object_push = MakeObjectListPacket(packet.object_info.sector_id);
-	client_session->Send(object_push);
+		client_session->Send(user_response);
 
+		if (use_snapshot_replication)
+			shard->GetSnapshotReplicator()->AddClient(packet.user_id, client_session, packet.object_info.sector_id);
+		else
+			client_session->Send(object_push);
+	});
 }
 
 void PacketHandler::OnUserStartSkillReq(UniversalSessionInfo* const session_info, const PacketHeader& header, const packet_start_skill_rq& packet)
@@ -148,6 +224,12 @@ void PacketHandler::OnUserStartSkillReq(UniversalSessionInfo* const session_info
 
 }
 
+// client shard thread
+void PacketHandler::OnUserSnapshotAck(UniversalSessionInfo* const session_info, const PacketHeader& header, const packet_sector_snapshot_ack_rq& packet)
+{
+	session_info->shard->GetSnapshotReplicator()->Acknowledge(session_info->universal_session_id, packet.sector_id, packet.sequence);
+}
+
 void PacketHandler::OnPlayObjectStartSkillPush(IntraServerInfo* const server, const PacketHeader& header, const packet_object_start_skill_ps& packet)
 {
 
@@ -161,18 +243,23 @@ void PacketHandler::OnPlayRemoveCharacterRes(IntraServerInfo* const session_info
 
 	sector_objects.erase(packet.object_id);
 
+	MarkObjectDirty(packet.sector_id, packet.object_id);
+
+	if (UseSnapshotReplication())
+		return;
+
 	packet_remove_object_ps response;
 	response.object_id = packet.object_id;
 	response.sector_id = packet.sector_id;
 	response.reason = 0;
 
-	_agency->_sector_posting_manager->SendToSector(response, packet.sector_id);
+	_agency->BroadcastToClientSector(response, packet.sector_id);
 }
 
 void PacketHandler::OnPlayObjectListPush(IntraServerInfo* const server, const PacketHeader& header, packet_object_list_ps& packet)
 {
 	std::unordered_map<uint64_t, Fixture>& sector_objects = _object_cache[packet.sector_id];
-	int64_t now = utility::CurrentTimeEpoch<utility::Milliseconds>().count();
+	int64_t now = utility::CoarseTimeEpoch<utility::Milliseconds>().count();
 
 	sector_objects.clear();
 
@@ -182,10 +269,19 @@ void PacketHandler::OnPlayObjectListPush(IntraServerInfo* const server, const Pa
 		sector_objects[object.object_id] = object.fixture;
 	}
 
-	_agency->_sector_posting_manager->SendToSector(packet, packet.sector_id);
+	MarkSectorDirty(packet.sector_id);
+
+	if (UseSnapshotReplication())
+		return;
+
+	packet_compact_object_list_ps broadcast;
+	broadcast.sector_id = packet.sector_id;
+	EncodeCompactObjectBlock(packet.sector_id, packet.object_list, broadcast.objects);
+
+	_agency->BroadcastToClientSector(broadcast, packet.sector_id);
 }
 
-void PacketHandler::OnPlayObjectMovePush(IntraServerInfo* const server, const PacketHeader& header, packet_object_move_ps& packet)
+void PacketHandler::OnPlayObjectMovePush(IntraServerInfo* const server, const PacketHeader& header, const packet_object_move_ps& packet)
 {
 	std::unordered_map<uint64_t, Fixture>& sector_objects = _object_cache[packet.sector_id];
 
@@ -194,7 +290,13 @@ void PacketHandler::OnPlayObjectMovePush(IntraServerInfo* const server, const Pa
 	cache.direction = packet.direction;
 	cache.position = packet.starting_position;
 	cache.last_transform_time = _agency->_current_epoch_timestamp.count();
-	_agency->_sector_posting_manager->SendToSector(packet, packet.sector_id);
+
+	MarkObjectDirty(packet.sector_id, packet.object_id);
+
+	if (UseSnapshotReplication())
+		return;
+
+	_agency->BroadcastToClientSector(packet, packet.sector_id);
 }
 
 void PacketHandler::OnPlayObjectCreatePush(IntraServerInfo* const server, const PacketHeader& header, const packet_create_object_ps& packet)
@@ -206,7 +308,16 @@ void PacketHandler::OnPlayObjectCreatePush(IntraServerInfo* const server, const
 	cache = packet.object_info.fixture;
 	cache.last_transform_time = _agency->_current_epoch_timestamp.count();
 
-	_agency->_sector_posting_manager->SendToSector(packet, packet.object_info.sector_id);
+	MarkObjectDirty(packet.object_info.sector_id, packet.object_info.object_id);
+
+	if (UseSnapshotReplication())
+		return;
+
+	packet_compact_create_object_ps broadcast;
+	broadcast.sector_id = packet.object_info.sector_id;
+	EncodeCompactObjectBlock(packet.object_info, broadcast.objects);
+
+	_agency->BroadcastToClientSector(broadcast, packet.object_info.sector_id);
 }
 
 void PacketHandler::OnPlayObjectRemovePush(IntraServerInfo* const server, const PacketHeader& header, const packet_remove_object_ps& packet)
@@ -215,7 +326,12 @@ void PacketHandler::OnPlayObjectRemovePush(IntraServerInfo* const server, const
 
 	sector_objects.erase(packet.object_id);
 
-	_agency->_sector_posting_manager->SendToSector(packet, packet.sector_id);
+	MarkObjectDirty(packet.sector_id, packet.object_id);
+
+	if (UseSnapshotReplication())
+		return;
+
+	_agency->BroadcastToClientSector(packet, packet.sector_id);
 }
 
 void PacketHandler::OnPlayPromoteObjectReq(IntraServerInfo* const server, const PacketHeader& header, const packet_promote_object_rq& packet)
@@ -244,46 +360,140 @@ void PacketHandler::OnPlayPromoteObjectReq(IntraServerInfo* const server, const
 
 	departing_sector_objects[origin_object->first] = packet.object_info.fixture;
 
+	MarkObjectDirty(packet.origin_sector_id, packet.object_info.object_id);
+	MarkObjectDirty(packet.object_info.sector_id, packet.object_info.object_id);
+
 	auto user_session = _agency->_object_sessions.find(packet.object_info.object_id);
 	if (user_session != _agency->_object_sessions.end())
 	{
-		uint64_t current_sector_id = user_session->second->session->GetUserData<AgencySessionValue, uint64_t>(AgencySessionValue::SectorId);
+		uint64_t user_id = user_session->second;
+		uint64_t origin_sector_id = packet.origin_sector_id;
+		uint64_t departing_sector_id = packet.object_info.sector_id;
+
+		bool use_snapshot_replication = UseSnapshotReplication();
+
+		packet_compact_object_list_ps object_push;
+		if (!use_snapshot_replication)
+			object_push = MakeObjectListPacket(departing_sector_id);
+
+		_agency->PostToClientShard(user_id, [user_id, origin_sector_id, departing_sector_id, object_push, use_snapshot_replication](ClientShard* const shard) {
+			UniversalSessionInfo* session_info = shard->GetClientSession(user_id);
+			if (session_info == nullptr)
+				return;
+
+			uint64_t current_sector_id = session_info->session->GetUserData<AgencySessionValue, uint64_t>(AgencySessionValue::SectorId);
+
+			assert(current_sector_id == origin_sector_id);
 
-		assert(current_sector_id == packet.origin_sector_id);
+			session_info->session->SetUserData<AgencySessionValue, uint64_t>(AgencySessionValue::SectorId, departing_sector_id);
 
-		packet_object_list_ps object_push = MakeObjectListPacket(packet.object_info.sector_id);
+			if (!use_snapshot_replication)
+				session_info->session->Send(object_push);
 
-		user_session->second->session->SetUserData<AgencySessionValue, uint64_t>(AgencySessionValue::SectorId, packet.object_info.sector_id);
-		
-		user_session->second->session->Send(object_push);
+			shard->GetSectorPostingManager()->RemoveSectorListener(origin_sector_id, user_id);
+			shard->GetSectorPostingManager()->AddSectorListener(departing_sector_id, user_id);
 
-		_agency->_sector_posting_manager->RemoveSectorListener(packet.origin_sector_id, user_session->second->universal_session_id);
-		_agency->_sector_posting_manager->AddSectorListener(packet.object_info.sector_id, user_session->second->universal_session_id);
+			if (use_snapshot_replication)
+				shard->GetSnapshotReplicator()->AddClient(user_id, session_info->session, departing_sector_id);
+		});
 	}
 }
 
-packet_object_list_ps PacketHandler::MakeObjectListPacket(const uint64_t sector_id)
+PacketObjectInfo PacketHandler::MakeObjectInfo(const uint64_t object_id, const Fixture& fixture) const
+{
+	PacketObjectInfo object;
+	object.fixture = fixture;
+	object.fixture.personal_delta_time = 0;
+
+	object.object_id = object_id;
+	object.sector_id = fixture.sector_id;
+	object.type = ObjectType::Character;
+	object.vital = {};
+
+	if (object.fixture.direction != Direction::Max)
+		object.fixture.personal_delta_time = static_cast<uint16_t>(_agency->_current_epoch_timestamp.count() - object.fixture.last_transform_time);
+
+	return object;
+}
+
+template <typename ObjectList>
+void PacketHandler::MakeObjectList(const uint64_t sector_id, ObjectList& object_list)
 {
 	auto& sector_objects = _object_cache[sector_id];
 
-	packet_object_list_ps packet;
-	packet.sector_id = sector_id;
+	object_list.reserve(sector_objects.size());
+
 	for (const auto& pair : sector_objects)
+		object_list.push_back(MakeObjectInfo(pair.first, pair.second));
+
+	std::sort(object_list.begin(), object_list.end(), [](const PacketObjectInfo& left, const PacketObjectInfo& right) {
+		return left.object_id < right.object_id;
+	});
+}
+
+packet_compact_object_list_ps PacketHandler::MakeObjectListPacket(const uint64_t sector_id)
+{
+	// only encoded block leaves this call, the list itself is frame memory
+	FrameVector<PacketObjectInfo> object_list;
+	UseFrameArena(object_list);
+	MakeObjectList(sector_id, object_list);
+
+	packet_compact_object_list_ps packet;
+	packet.sector_id = sector_id;
+	EncodeCompactObjectBlock(sector_id, object_list, packet.objects);
+
+	return packet;
+}
+
+void PacketHandler::PatchObjectList(const uint64_t sector_id, const std::vector<PacketObjectInfo>& baseline, std::vector<uint64_t>& changed_object_ids, std::vector<PacketObjectInfo>& object_list)
+{
+	auto& sector_objects = _object_cache[sector_id];
+
+	std::sort(changed_object_ids.begin(), changed_object_ids.end());
+	changed_object_ids.erase(std::unique(changed_object_ids.begin(), changed_object_ids.end()), changed_object_ids.end());
+
+	object_list.reserve(baseline.size() + changed_object_ids.size());
+
+	auto base = baseline.begin();
+	for (const uint64_t object_id : changed_object_ids)
 	{
-		PacketObjectInfo object;
-		object.fixture = pair.second;
-		object.fixture.personal_delta_time = 0;
+		while (base != baseline.end() && base->object_id < object_id)
+			object_list.push_back(*base++);
+
+		if (base != baseline.end() && base->object_id == object_id)
+			++base;
 
-		object.object_id = pair.first;
-		object.sector_id = pair.second.sector_id;
-		object.type = ObjectType::Character;
-		object.vital = {};
+		auto cached_object = sector_objects.find(object_id);
+		if (cached_object != sector_objects.end())
+			object_list.push_back(MakeObjectInfo(object_id, cached_object->second));
+	}
 
-		if (object.fixture.direction != Direction::Max)
-			object.fixture.personal_delta_time = static_cast<uint16_t>(_agency->_current_epoch_timestamp.count() - object.fixture.last_transform_time);
+	object_list.insert(object_list.end(), base, baseline.end());
+}
 
-		packet.object_list.push_back(object);
+void PacketHandler::PublishSnapshots()
+{
+	for (auto& [sector_id, dirty_sector] : _dirty_sectors)
+	{
+		SectorSnapshotPtr& published = _published_snapshots[sector_id];
+
+		std::shared_ptr<SectorSnapshot> snapshot = std::make_shared<SectorSnapshot>();
+		snapshot->sector_id = sector_id;
+		snapshot->sequence = published == nullptr ? 1 : published->sequence + 1;
+		snapshot->timestamp = _agency->_current_epoch_timestamp.count();
+
+		// only changed objects are looked up, the rest is copied from last snapshot in order
+		if (published == nullptr || dirty_sector.rebuild)
+			MakeObjectList(sector_id, snapshot->objects);
+		else
+			PatchObjectList(sector_id, published->objects, dirty_sector.object_ids, snapshot->objects);
+
+		published = snapshot;
+
+		_agency->PostToClientShards([published](ClientShard* const shard) {
+			shard->GetSnapshotReplicator()->Publish(published);
+		});
 	}
 
-	return packet;
+	_dirty_sectors.clear();
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <engine/SocketSession.h>
 #include <engine/SocketContext.h>
 #include <engine/protocol/Packet.h>
+#include <engine/protocol/CompactObject.h>
+#include <unordered_set>
 
 struct ObjectCache
 {
@@ -18,18 +20,68 @@ private:
 
 	std::unordered_map <uint64_t, std::unordered_map<uint64_t, Fixture>> _object_cache;
 
-	packet_object_list_ps MakeObjectListPacket(const uint64_t sector_id);
+	// snapshot replication, objects changed since last publish
+	struct DirtySector
+	{
+		// whole object list of sector is replaced, it is rebuilt from cache
+		bool rebuild = false;
+		std::vector<uint64_t> object_ids;
+	};
+
+	// key: sector id
+	std::unordered_map<uint64_t, DirtySector> _dirty_sectors;
+
+	// last published snapshot of every sector, next one patches its object list
+	std::unordered_map<uint64_t, SectorSnapshotPtr> _published_snapshots;
+
+	bool UseSnapshotReplication() const
+	{
+		return _agency->_game_config.use_snapshot_replication;
+	}
+
+	void MarkObjectDirty(const uint64_t sector_id, const uint64_t object_id)
+	{
+		if (UseSnapshotReplication())
+			_dirty_sectors[sector_id].object_ids.push_back(object_id);
+	}
+
+	void MarkSectorDirty(const uint64_t sector_id)
+	{
+		if (UseSnapshotReplication())
+			_dirty_sectors[sector_id].rebuild = true;
+	}
+
+	PacketObjectInfo MakeObjectInfo(const uint64_t object_id, const Fixture& fixture) const;
+
+	// sorted by object id, list is std::vector or FrameVector
+	template <typename ObjectList>
+	void MakeObjectList(const uint64_t sector_id, ObjectList& object_list);
+
+	// baseline with changed objects replaced from cache, changed objects not in cache are removed
+	void PatchObjectList(const uint64_t sector_id, const std::vector<PacketObjectInfo>& baseline, std::vector<uint64_t>& changed_object_ids, std::vector<PacketObjectInfo>& object_list);
+	packet_compact_object_list_ps MakeObjectListPacket(const uint64_t sector_id);
+
+	void OnCharacterSpawned(const SocketSessionPtr& play_session, packet_spawn_character_rs& packet);
 public:
 
 	PacketHandler(AgencyWorker* agency) : _agency(agency) {}
 
 	// void OnUserGameEnterReq(UniversalSessionInfo* const session_info, const PacketHeader& header, const packet_game_enter_request_rq& packet);
 
-	void OnUserMoveReq(UniversalSessionInfo* const session_info, const PacketHeader& header, packet_character_move_rq& packet);
+	void OnUserMoveReq(UniversalSessionInfo* const session_info, const PacketHeader& header, const packet_character_move_rq& packet);
 	void OnUserStartSkillReq(UniversalSessionInfo* const session_info, const PacketHeader& header, const packet_start_skill_rq& packet);
+	void OnUserSnapshotAck(UniversalSessionInfo* const session_info, const PacketHeader& header, const packet_sector_snapshot_ack_rq& packet);
+
+	// game server thread, snapshot of every changed sector is posted to client shards
+	void PublishSnapshots();
+
+	// game server thread, request spawn to sector owner and enter user when character is spawned
+	async_simple::coro::Lazy<void> SpawnCharacter(SocketSessionPtr play_session, packet_spawn_character_rq request);
+
+	// spawn response which arrived after its call timed out, user is already closed
+	void OnPlayLateSpawnCharacterRes(IntraServerInfo* const server, const PacketHeader& header, const packet_spawn_character_rs& packet);
 
 	// user action packet
-	void OnPlaySpawnCharacterRes(IntraServerInfo* const session_info, const PacketHeader& header, packet_spawn_character_rs& packet);
 	void OnPlayRemoveCharacterRes(IntraServerInfo* const session_info, const PacketHeader& header, const packet_remove_character_rs& packet);
 	void OnPlayMoveCharacterRes(IntraServerInfo* const server, const PacketHeader& header, const packet_character_move_rs& packet);
 	
@@ -39,7 +91,7 @@ public:
 	void OnPlayObjectListPush(IntraServerInfo* const server, const PacketHeader& header, packet_object_list_ps& packet);
 
 	// other object packet
-	void OnPlayObjectMovePush(IntraServerInfo* const server, const PacketHeader& header, packet_object_move_ps& packet);
+	void OnPlayObjectMovePush(IntraServerInfo* const server, const PacketHeader& header, const packet_object_move_ps& packet);
 	void OnPlayObjectStartSkillPush(IntraServerInfo* const server, const PacketHeader& header, const packet_object_start_skill_ps& packet);
 	void OnPlayObjectCreatePush(IntraServerInfo* const server, const PacketHeader& header, const packet_create_object_ps& packet);
 	void OnPlayObjectRemovePush(IntraServerInfo* const server, const PacketHeader& header, const packet_remove_object_ps& packet);
@@ -0,0 +1,34 @@
+﻿#include "benchmark/Benchmark.h"
+#include "benchmark/PacketBenchmark.h"
+#include "benchmark/PoolBenchmark.h"
+#include "benchmark/ConcurrentBenchmark.h"
+#include "benchmark/EngineBenchmark.h"
+#include "benchmark/SectorBenchmark.h"
+#include <fstream>
+
+// benchmark [result.json], results are printed to stdout and written to the file for regression tracking
+int main(int argc, char* argv[])
+{
+    std::vector<BenchmarkResult> results;
+
+    RunPacketBenchmarks(results, 1000000);
+    RunPoolBenchmarks(results, 1000000);
+    RunConcurrentBenchmarks(results, 1000000);
+    RunEngineBenchmarks(results, 1000000);
+    RunSectorBenchmarks(results, 1000000);
+
+    std::string output = FormatBenchmarkResults(results);
+    std::fputs(output.c_str(), stdout);
+
+    if (argc > 1)
+    {
+        std::ofstream file(argv[1], std::ios::binary | std::ios::trunc);
+        if (!(file << output))
+        {
+            std::fprintf(stderr, "cannot write %s\n", argv[1]);
+            return 1;
+        }
+    }
+
+    return 0;
+}
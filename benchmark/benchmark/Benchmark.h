@@ -0,0 +1,140 @@
+#pragma once
+
+#include <utility/Time.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#ifdef _WIN32
+#include <intrin.h>
+#endif
+
+struct BenchmarkResult
+{
+	std::string name;
+	uint64_t iterations;
+	double nanoseconds_per_operation;
+	uint64_t bytes_per_operation;
+
+	// iterations of multi threaded benchmark are total of all threads, ns_per_op is wall time over them
+	uint32_t thread_count = 1;
+
+	// latency of single operation, 0 = not measured
+	double p50_nanoseconds = 0;
+	double p99_nanoseconds = 0;
+};
+
+// keeps benchmarked value alive without being optimized away
+// the sink pointer itself is volatile, and the barrier makes compiler write value to memory before storing its address
+template <typename T>
+inline void DoNotOptimize(const T& value)
+{
+#ifdef _WIN32
+	static const void* volatile sink;
+	sink = &value;
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+template <typename Function>
+inline BenchmarkResult RunBenchmark(const std::string& name, const uint64_t iterations, const uint64_t bytes_per_operation, Function&& function)
+{
+	// warm up caches and branch predictor
+	for (uint64_t index = 0; index < iterations / 10 + 1; index++)
+		function();
+
+	utility::Nanoseconds start = utility::CurrentTick();
+
+	for (uint64_t index = 0; index < iterations; index++)
+		function();
+
+	utility::Nanoseconds elapsed = utility::CurrentTick() - start;
+
+	return BenchmarkResult{ name, iterations, static_cast<double>(elapsed.count()) / static_cast<double>(iterations), bytes_per_operation };
+}
+
+// threads start together, function receives thread index
+template <typename Function>
+inline BenchmarkResult RunParallelBenchmark(const std::string& name, const uint32_t thread_count, const uint64_t iterations_per_thread, const uint64_t bytes_per_operation, Function&& function)
+{
+	std::atomic<uint32_t> ready_count = 0;
+	std::atomic<bool> started = false;
+
+	std::vector<std::thread> threads;
+	for (uint32_t thread_index = 0; thread_index < thread_count; thread_index++)
+	{
+		threads.emplace_back([&, thread_index]() {
+			ready_count.fetch_add(1, std::memory_order_acq_rel);
+			while (!started.load(std::memory_order_acquire))
+				std::this_thread::yield();
+
+			for (uint64_t index = 0; index < iterations_per_thread; index++)
+				function(thread_index);
+		});
+	}
+
+	while (ready_count.load(std::memory_order_acquire) != thread_count)
+		std::this_thread::yield();
+
+	utility::Nanoseconds start = utility::CurrentTick();
+	started.store(true, std::memory_order_release);
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	utility::Nanoseconds elapsed = utility::CurrentTick() - start;
+
+	uint64_t iterations = iterations_per_thread * thread_count;
+
+	return BenchmarkResult{ name, iterations, static_cast<double>(elapsed.count()) / static_cast<double>(iterations), bytes_per_operation, thread_count };
+}
+
+// samples are reordered
+inline void SetLatencyPercentiles(BenchmarkResult& result, std::vector<uint64_t>& samples)
+{
+	if (samples.empty())
+		return;
+
+	auto percentile = [&samples](const double ratio) {
+		auto position = samples.begin() + static_cast<std::ptrdiff_t>(ratio * static_cast<double>(samples.size() - 1));
+		std::nth_element(samples.begin(), position, samples.end());
+
+		return static_cast<double>(*position);
+	};
+
+	result.p50_nanoseconds = percentile(0.5);
+	result.p99_nanoseconds = percentile(0.99);
+}
+
+inline std::string BenchmarkSuffix(const uint64_t value)
+{
+	return "[" + std::to_string(value) + "]";
+}
+
+inline std::string FormatBenchmarkResults(const std::vector<BenchmarkResult>& results)
+{
+	char line[512];
+
+	std::snprintf(line, sizeof(line), "{\n\t\"timestamp_ms\": %lld,\n\t\"hardware_concurrency\": %u,\n\t\"benchmarks\": [\n",
+		static_cast<long long>(utility::CurrentTimeEpoch<utility::Milliseconds>().count()), std::thread::hardware_concurrency());
+
+	std::string output = line;
+
+	for (std::size_t index = 0; index < results.size(); index++)
+	{
+		const BenchmarkResult& result = results[index];
+
+		std::snprintf(line, sizeof(line), "\t\t{ \"name\": \"%s\", \"iterations\": %llu, \"threads\": %u, \"ns_per_op\": %.2f, \"p50_ns\": %.2f, \"p99_ns\": %.2f, \"bytes_per_op\": %llu }%s\n",
+			result.name.c_str(), result.iterations, result.thread_count, result.nanoseconds_per_operation, result.p50_nanoseconds, result.p99_nanoseconds, result.bytes_per_operation, index + 1 == results.size() ? "" : ",");
+
+		output += line;
+	}
+
+	output += "\t]\n}\n";
+
+	return output;
+}
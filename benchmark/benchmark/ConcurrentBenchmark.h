@@ -0,0 +1,171 @@
+#pragma once
+
+#include "Benchmark.h"
+#include <concurrent/LinearWorkQueue.h>
+#include <concurrent/ConcurrentMap.h>
+
+constexpr std::size_t BENCHMARK_WORK_QUEUE_SIZE = 65536;
+
+// producers push submission tick as fast as possible, one consumer swaps and drains like LinearWorker
+inline void BenchmarkLinearWorkQueue(std::vector<BenchmarkResult>& results, const uint32_t producer_count, const uint64_t iterations)
+{
+	LinearWorkQueue<uint64_t, BENCHMARK_WORK_QUEUE_SIZE>* queue = new LinearWorkQueue<uint64_t, BENCHMARK_WORK_QUEUE_SIZE>();
+
+	uint64_t items_per_producer = iterations / producer_count;
+	uint64_t total_items = items_per_producer * producer_count;
+
+	std::atomic<bool> started = false;
+
+	std::thread consumer([&]() {
+		while (!started.load(std::memory_order_acquire))
+			std::this_thread::yield();
+
+		uint64_t received = 0;
+		while (received < total_items)
+		{
+			queue->LockSubmissionQueue();
+
+			uint64_t submit_tick;
+			bool popped = false;
+			while (queue->TryPop(submit_tick))
+			{
+				received++;
+				popped = true;
+			}
+
+			if (!popped)
+				std::this_thread::yield();
+		}
+	});
+
+	std::vector<std::thread> producers;
+	for (uint32_t producer_index = 0; producer_index < producer_count; producer_index++)
+	{
+		producers.emplace_back([&]() {
+			while (!started.load(std::memory_order_acquire))
+				std::this_thread::yield();
+
+			for (uint64_t index = 0; index < items_per_producer; index++)
+			{
+				uint64_t submit_tick = static_cast<uint64_t>(utility::CurrentTick().count());
+				while (!queue->TryPush(submit_tick))
+					std::this_thread::yield();
+			}
+		});
+	}
+
+	utility::Nanoseconds start = utility::CurrentTick();
+	started.store(true, std::memory_order_release);
+
+	for (std::thread& producer : producers)
+		producer.join();
+
+	consumer.join();
+
+	utility::Nanoseconds elapsed = utility::CurrentTick() - start;
+
+	results.push_back(BenchmarkResult{ "linear_work_queue.push_pop" + BenchmarkSuffix(producer_count), total_items, static_cast<double>(elapsed.count()) / static_cast<double>(total_items), sizeof(uint64_t), producer_count + 1 });
+
+	delete queue;
+}
+
+// unloaded submission to pop latency, producer waits until consumer popped previous item
+inline void BenchmarkLinearWorkQueueLatency(std::vector<BenchmarkResult>& results, const uint64_t sample_count)
+{
+	LinearWorkQueue<uint64_t, BENCHMARK_WORK_QUEUE_SIZE>* queue = new LinearWorkQueue<uint64_t, BENCHMARK_WORK_QUEUE_SIZE>();
+
+	std::vector<uint64_t> latency_samples;
+	latency_samples.reserve(sample_count);
+
+	std::atomic<uint64_t> received = 0;
+
+	std::thread consumer([&]() {
+		while (received.load(std::memory_order_relaxed) < sample_count)
+		{
+			queue->LockSubmissionQueue();
+
+			uint64_t submit_tick;
+			bool popped = false;
+			while (queue->TryPop(submit_tick))
+			{
+				latency_samples.push_back(static_cast<uint64_t>(utility::CurrentTick().count()) - submit_tick);
+				received.fetch_add(1, std::memory_order_release);
+				popped = true;
+			}
+
+			if (!popped)
+				std::this_thread::yield();
+		}
+	});
+
+	utility::Nanoseconds start = utility::CurrentTick();
+
+	for (uint64_t index = 0; index < sample_count; index++)
+	{
+		while (!queue->TryPush(static_cast<uint64_t>(utility::CurrentTick().count())))
+			std::this_thread::yield();
+
+		while (received.load(std::memory_order_acquire) <= index)
+			std::this_thread::yield();
+	}
+
+	consumer.join();
+
+	utility::Nanoseconds elapsed = utility::CurrentTick() - start;
+
+	BenchmarkResult result{ "linear_work_queue.latency", sample_count, static_cast<double>(elapsed.count()) / static_cast<double>(sample_count), sizeof(uint64_t), 2 };
+	SetLatencyPercentiles(result, latency_samples);
+
+	results.push_back(result);
+
+	delete queue;
+}
+
+// read_percent of operations are TryGet, the others Insert over same key space
+inline void BenchmarkConcurrentMap(std::vector<BenchmarkResult>& results, const uint32_t thread_count, const uint32_t read_percent, const uint64_t iterations)
+{
+	constexpr uint64_t key_count = 65536;
+
+	ConcurrentMap<uint64_t, uint64_t> map;
+	for (uint64_t key = 0; key < key_count; key++)
+		map.Insert(key, key);
+
+	std::string name = "concurrent_map.read" + std::to_string(read_percent) + "_write" + std::to_string(100 - read_percent) + BenchmarkSuffix(thread_count);
+
+	std::vector<uint64_t> random_states(thread_count * 8);
+	for (uint32_t thread_index = 0; thread_index < thread_count; thread_index++)
+		random_states[thread_index * 8] = 0x9E3779B97F4A7C15ull * (thread_index + 1);
+
+	results.push_back(RunParallelBenchmark(name, thread_count, iterations / thread_count, sizeof(uint64_t), [&](const uint32_t thread_index) {
+		// xorshift, states are a cache line apart
+		uint64_t& state = random_states[thread_index * 8];
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+
+		uint64_t key = state % key_count;
+
+		if (state % 100 < read_percent)
+		{
+			uint64_t value = 0;
+			map.TryGet(key, value);
+			DoNotOptimize(value);
+		}
+		else
+			map.Insert(key, state);
+	}));
+}
+
+inline void RunConcurrentBenchmarks(std::vector<BenchmarkResult>& results, const uint64_t iterations)
+{
+	for (const uint32_t producer_count : { 1u, 4u })
+		BenchmarkLinearWorkQueue(results, producer_count, iterations);
+
+	BenchmarkLinearWorkQueueLatency(results, iterations / 100);
+
+	for (const uint32_t thread_count : { 1u, 4u })
+	{
+		for (const uint32_t read_percent : { 100u, 90u, 50u })
+			BenchmarkConcurrentMap(results, thread_count, read_percent, iterations);
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Benchmark.h"
+#include <engine/SocketContext.h>
+#include <engine/protocol/Protocol.h>
+#include <memory>
+
+constexpr uint32_t BENCHMARK_READ_BUFFER_SIZE = 65536;
+
+// NetworkEngine::OnRead without stream and session, frames are read by same ReadPacketFrame
+// contexts are popped from slab of io worker and chained, whole buffer is one chain
+inline uint32_t FrameReadBuffer(SocketBuffer* const buffer, SocketContextPool* const context_pool, SocketContext*& first_context)
+{
+	DynamicBufferCursor<SocketBuffer> buffer_cursor(buffer);
+
+	SocketContext* last_context = nullptr;
+	uint32_t packet_count = 0;
+
+	PacketHeader header;
+	uint32_t payload_size = 0;
+
+	while (ReadPacketFrame(buffer_cursor, header, payload_size) == PacketFrameResult::Framed)
+	{
+		SocketContext* context = context_pool->Pop(true);
+		context->network_subject = NetworkSubject::Socket;
+		context->context_type = ContextType::SessionData;
+		context->header = header;
+		context->attachment = 0;
+		context->buffer = buffer_cursor;
+		context->next = nullptr;
+		context->receive_time_us = 0;
+
+		buffer->Retain();
+
+		if (last_context == nullptr)
+			first_context = context;
+		else
+			last_context->next = context;
+
+		last_context = context;
+
+		buffer_cursor.Seek(payload_size);
+		packet_count++;
+	}
+
+	return packet_count;
+}
+
+// read buffer filled with whole frames of body_size, ns_per_op is per framed packet
+inline void BenchmarkReadFraming(std::vector<BenchmarkResult>& results, const uint32_t body_size, const uint64_t iterations)
+{
+	std::vector<uint8_t> memory(BENCHMARK_READ_BUFFER_SIZE);
+
+	std::unique_ptr<SocketBuffer> buffer(new SocketBuffer{ { memory.data(), BENCHMARK_READ_BUFFER_SIZE, 0 } });
+
+	// contexts never get a session, so releasing them only returns them to slab
+	std::unique_ptr<SocketContextPool> context_pool(new SocketContextPool(SOCKET_CONTEXT_POOL_SIZE, SOCKET_CONTEXT_CHUNK_SIZE));
+
+	uint32_t frame_size = PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE + body_size;
+	uint32_t frame_count = BENCHMARK_READ_BUFFER_SIZE / frame_size;
+
+	for (uint32_t frame_index = 0; frame_index < frame_count; frame_index++)
+	{
+		uint8_t* frame = memory.data() + frame_index * frame_size;
+
+		PacketLengthType packet_length = PACKET_HEADER_SIZE + body_size;
+		PacketHeader header{ PacketType::packet_character_move_rq, 0, ErrorCode::None, body_size };
+
+		std::memcpy(frame, &packet_length, PACKET_LENGTH_SIZE);
+		std::memcpy(frame + PACKET_LENGTH_SIZE, &header, PACKET_HEADER_SIZE);
+		std::memset(frame + PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE, static_cast<int>(frame_index), body_size);
+	}
+
+	buffer->length = frame_count * frame_size;
+
+	uint64_t buffer_iterations = iterations / frame_count + 1;
+
+	BenchmarkResult result = RunBenchmark("on_read_framing" + BenchmarkSuffix(body_size), buffer_iterations, buffer->length, [&]() {
+		SocketContext* context = nullptr;
+		uint32_t packet_count = FrameReadBuffer(buffer.get(), context_pool.get(), context);
+		DoNotOptimize(packet_count);
+
+		// worker releases contexts
+		while (context != nullptr)
+		{
+			SocketContext* next_context = static_cast<SocketContext*>(context->next);
+			context->Release();
+			context = next_context;
+		}
+
+		buffer->ReleaseN(buffer->Ref());
+	});
+
+	result.iterations *= frame_count;
+	result.nanoseconds_per_operation /= frame_count;
+	result.bytes_per_operation = frame_size;
+
+	results.push_back(result);
+}
+
+inline void RunEngineBenchmarks(std::vector<BenchmarkResult>& results, const uint64_t iterations)
+{
+	for (const uint32_t body_size : { 16u, 256u, 4096u })
+		BenchmarkReadFraming(results, body_size, iterations);
+}
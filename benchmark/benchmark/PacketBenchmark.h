@@ -0,0 +1,154 @@
+#pragma once
+
+#include "Benchmark.h"
+#include <engine/protocol/Protocol.h>
+#include <engine/protocol/CompactObject.h>
+
+// serialize / deserialize of one packet type
+// fixed layout packets also measure in place view and struct_pack baseline of the same packet
+template <NetworkPacketConcept T>
+inline void BenchmarkPacket(std::vector<BenchmarkResult>& results, const std::string& name, const T& packet, const uint64_t iterations)
+{
+	uint32_t body_size = GetPacketBodySize(packet);
+
+	std::vector<uint8_t> buffer(PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE + body_size);
+	uint32_t packet_size = 0;
+
+	results.push_back(RunBenchmark(name + ".serialize", iterations, buffer.size(), [&]() {
+		SerializePacket(packet, ErrorCode::None, buffer.data(), static_cast<uint32_t>(buffer.size()), packet_size);
+		DoNotOptimize(buffer);
+	}));
+
+	const uint8_t* body = buffer.data() + PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE;
+
+	results.push_back(RunBenchmark(name + ".deserialize", iterations, body_size, [&]() {
+		T result;
+		DeserializePacketBody(body, body_size, result);
+		DoNotOptimize(result);
+	}));
+
+	if constexpr (FixedLayoutPacketConcept<T>)
+	{
+		results.push_back(RunBenchmark(name + ".view", iterations, body_size, [&]() {
+			const T* result = ViewPacketBody<T>(body, body_size);
+			DoNotOptimize(result);
+		}));
+
+		auto struct_pack_size = struct_pack::get_needed_size(packet);
+		std::vector<char> struct_pack_buffer(struct_pack_size.size());
+
+		results.push_back(RunBenchmark(name + ".struct_pack_serialize", iterations, struct_pack_buffer.size(), [&]() {
+			struct_pack::serialize_to(struct_pack_buffer.data(), struct_pack_size, packet);
+			DoNotOptimize(struct_pack_buffer);
+		}));
+
+		results.push_back(RunBenchmark(name + ".struct_pack_deserialize", iterations, struct_pack_buffer.size(), [&]() {
+			T result;
+			struct_pack::deserialize_to(result, struct_pack_buffer.data(), struct_pack_buffer.size());
+			DoNotOptimize(result);
+		}));
+	}
+}
+
+inline PacketObjectInfo MakeBenchmarkObjectInfo(const uint64_t object_id)
+{
+	Vector2 sector_center = GetSectorFixtureRectangle(12).Center();
+
+	PacketObjectInfo object_info{};
+	object_info.object_id = object_id;
+	object_info.sector_id = 12;
+	object_info.type = ObjectType::Character;
+	object_info.fixture.id = object_id;
+	object_info.fixture.sector_id = 12;
+	object_info.fixture.position = Vector2{ sector_center.x + static_cast<CoordinateUnit>(object_id % 2000) - 1000.5f, sector_center.y + static_cast<CoordinateUnit>(object_id % 1500) - 750.25f };
+	object_info.fixture.size = Vector2{ 100, 100 };
+	object_info.fixture.direction = static_cast<Direction>(object_id % 9);
+	object_info.fixture.personal_delta_time = object_id % 300;
+	object_info.vital = Vital{ 100, 10, 5 };
+
+	return object_info;
+}
+
+// bytes per object and per snapshot of full PacketObjectInfo and compact encoding
+inline void BenchmarkCompactObjects(std::vector<BenchmarkResult>& results, const uint64_t object_count, const uint64_t iterations)
+{
+	std::vector<PacketObjectInfo> object_list;
+	for (uint64_t index = 0; index < object_count; index++)
+		object_list.push_back(MakeBenchmarkObjectInfo(100000001 + index * 3));
+
+	std::string suffix = "[" + std::to_string(object_count) + "]";
+
+	packet_object_list_ps full_packet{};
+	full_packet.sector_id = 12;
+	full_packet.object_list.assign(object_list.begin(), object_list.end());
+
+	packet_compact_object_list_ps compact_packet{};
+	compact_packet.sector_id = 12;
+	EncodeCompactObjectBlock(12, object_list, compact_packet.objects);
+
+	uint64_t full_snapshot_size = PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE + GetPacketBodySize(full_packet);
+	uint64_t compact_snapshot_size = PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE + GetPacketBodySize(compact_packet);
+
+	results.push_back(BenchmarkResult{ "object_info.full.bytes_per_object" + suffix, 0, 0, GetPacketBodySize(full_packet) / object_count });
+	results.push_back(BenchmarkResult{ "object_info.compact.bytes_per_object" + suffix, 0, 0, compact_packet.objects.data.size() / object_count });
+	results.push_back(BenchmarkResult{ "snapshot.full.bytes" + suffix, 0, 0, full_snapshot_size });
+	results.push_back(BenchmarkResult{ "snapshot.compact.bytes" + suffix, 0, 0, compact_snapshot_size });
+
+	results.push_back(RunBenchmark("compact_object_block" + suffix + ".encode", iterations, compact_packet.objects.data.size(), [&]() {
+		EncodeCompactObjectBlock(12, object_list, compact_packet.objects);
+		DoNotOptimize(compact_packet);
+	}));
+
+	std::vector<PacketObjectInfo> decoded;
+	results.push_back(RunBenchmark("compact_object_block" + suffix + ".decode", iterations, compact_packet.objects.data.size(), [&]() {
+		DecodeCompactObjectBlock(12, compact_packet.objects, decoded);
+		DoNotOptimize(decoded);
+	}));
+
+	BenchmarkPacket(results, "packet_compact_object_list_ps" + suffix, compact_packet, iterations);
+}
+
+inline void RunPacketBenchmarks(std::vector<BenchmarkResult>& results, const uint64_t iterations)
+{
+	packet_heartbeat_rq heartbeat{};
+	heartbeat.ping = 1;
+	BenchmarkPacket(results, "packet_heartbeat_rq", heartbeat, iterations);
+
+	packet_character_move_rq move_request{};
+	move_request.sector_id = 12;
+	move_request.object_id = 100000001;
+	move_request.starting_position = Vector2{ 1024.5f, 2048.25f };
+	move_request.direction = Direction::UpRight;
+	BenchmarkPacket(results, "packet_character_move_rq", move_request, iterations);
+
+	packet_object_move_ps move_push{};
+	move_push.sector_id = 12;
+	move_push.object_id = 100000001;
+	move_push.starting_position = Vector2{ 1024.5f, 2048.25f };
+	move_push.direction = Direction::Left;
+	BenchmarkPacket(results, "packet_object_move_ps", move_push, iterations);
+
+	packet_create_object_ps create_push{};
+	create_push.object_info = MakeBenchmarkObjectInfo(100000001);
+	BenchmarkPacket(results, "packet_create_object_ps", create_push, iterations);
+
+	packet_spawn_character_rq spawn_request{};
+	spawn_request.user_id = 300000000000001;
+	spawn_request.nickname = "benchmark_user_nickname";
+	spawn_request.object_info = MakeBenchmarkObjectInfo(100000001);
+	BenchmarkPacket(results, "packet_spawn_character_rq", spawn_request, iterations);
+
+	packet_object_list_ps object_list{};
+	object_list.sector_id = 12;
+	for (uint64_t index = 0; index < 100; index++)
+		object_list.object_list.push_back(MakeBenchmarkObjectInfo(100000001 + index));
+	BenchmarkPacket(results, "packet_object_list_ps[100]", object_list, iterations / 10);
+
+	packet_compact_create_object_ps compact_create_push{};
+	compact_create_push.sector_id = 12;
+	EncodeCompactObjectBlock(MakeBenchmarkObjectInfo(100000001), compact_create_push.objects);
+	BenchmarkPacket(results, "packet_compact_create_object_ps", compact_create_push, iterations);
+
+	BenchmarkCompactObjects(results, 100, iterations / 10);
+	BenchmarkCompactObjects(results, 1000, iterations / 100);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Benchmark.h"
+#include <memory/ObjectPool.h>
+#include <memory/SharedObjectPool.h>
+#include <memory/RefCounter.h>
+
+struct BenchmarkPoolObject : public RefCounter<false>
+{
+	uint64_t payload[8];
+};
+
+// each thread pops a small working set then pushes it back, pool never runs dry
+template <typename Pool>
+inline void BenchmarkObjectPool(std::vector<BenchmarkResult>& results, const std::string& name, const uint32_t thread_count, const uint64_t iterations)
+{
+	constexpr uint32_t working_set_size = 16;
+
+	Pool pool(thread_count * working_set_size * 2, 256);
+
+	results.push_back(RunParallelBenchmark(name + BenchmarkSuffix(thread_count), thread_count, iterations / working_set_size, sizeof(BenchmarkPoolObject) * working_set_size, [&](const uint32_t thread_index) {
+		BenchmarkPoolObject* objects[working_set_size];
+
+		for (BenchmarkPoolObject*& object : objects)
+			object = pool.Pop(true);
+
+		DoNotOptimize(objects);
+
+		for (BenchmarkPoolObject* object : objects)
+			pool.Push(object);
+	}));
+}
+
+inline void BenchmarkSharedObjectPool(std::vector<BenchmarkResult>& results, const uint32_t thread_count, const uint64_t iterations)
+{
+	constexpr uint32_t working_set_size = 16;
+
+	SharedObjectPool<BenchmarkPoolObject> pool(thread_count * working_set_size * 2, 256);
+
+	results.push_back(RunParallelBenchmark("shared_object_pool.pop_push" + BenchmarkSuffix(thread_count), thread_count, iterations / working_set_size, sizeof(BenchmarkPoolObject) * working_set_size, [&](const uint32_t thread_index) {
+		IntrusivePtr<BenchmarkPoolObject> objects[working_set_size];
+
+		for (IntrusivePtr<BenchmarkPoolObject>& object : objects)
+			object = pool.Pop();
+
+		DoNotOptimize(objects);
+	}));
+}
+
+// ns_per_op of pool benchmarks is per working set of 16 objects
+inline void RunPoolBenchmarks(std::vector<BenchmarkResult>& results, const uint64_t iterations)
+{
+	BenchmarkObjectPool<ObjectPool<BenchmarkPoolObject>>(results, "object_pool.pop_push", 1, iterations);
+
+	for (const uint32_t thread_count : { 1u, 4u })
+	{
+		BenchmarkObjectPool<ObjectPool<BenchmarkPoolObject, true>>(results, "concurrent_object_pool.pop_push", thread_count, iterations);
+		BenchmarkSharedObjectPool(results, thread_count, iterations);
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Benchmark.h"
+#include <game/coordinate/SectorSystem.h>
+#include <game/coordinate/SectorGrid.h>
+
+// fixtures bounce back on location change so they stay around the sector between iterations
+class BenchmarkSectorCallback : public SectorSystem::Callback
+{
+public:
+	uint64_t event_count = 0;
+
+	virtual void OnChangeFixturePhase(const uint64_t sector_id, Fixture* const fixture, const Direction phase) override
+	{
+		event_count++;
+	}
+
+	virtual void OnChangeFixtureLocation(const uint64_t sector_id, Fixture* const fixture, const FixtureLocation location, const Direction phase) override
+	{
+		event_count++;
+		fixture->direction = GetOpositeDirection(fixture->direction);
+	}
+
+	virtual void OnCollisionFixture(const uint64_t sector_id, Fixture* const fixture1, Fixture* const fixture2) override {}
+};
+
+// one call is one world tick of a sector holding fixture_count moving fixtures
+inline void BenchmarkSectorUpdate(std::vector<BenchmarkResult>& results, const uint32_t fixture_count, const uint64_t tick_count)
+{
+	constexpr uint64_t sector_id = 12;
+	constexpr utility::Milliseconds tick(33);
+
+	BenchmarkSectorCallback callback;
+
+	FixtureRectangle rect = GetSectorFixtureRectangle(sector_id);
+	SectorSystem sector(sector_id, rect.LeftDown(), SectorSize, ChunkSize, SectorGrayZoneChunk, &callback);
+
+	uint64_t random_state = 0x2545F4914F6CDD1Dull;
+	auto next_random = [&random_state]() {
+		random_state ^= random_state << 13;
+		random_state ^= random_state >> 7;
+		random_state ^= random_state << 17;
+
+		return random_state;
+	};
+
+	Vector2 left_down = rect.LeftDown();
+	for (uint32_t index = 0; index < fixture_count; index++)
+	{
+		Vector2 position{ left_down.x + static_cast<CoordinateUnit>(next_random() % static_cast<uint64_t>(SectorSize.x)), left_down.y + static_cast<CoordinateUnit>(next_random() % static_cast<uint64_t>(SectorSize.y)) };
+
+		Fixture* fixture = sector.CreateFixture(position, Size{ 100, 100 });
+		fixture->direction = static_cast<Direction>(next_random() % 8);
+		fixture->location = sector.CalculateCurrentLocation(fixture);
+		fixture->phase = fixture->location == FixtureLocation::Gray ? sector.CalculateCurrentPhase(fixture) : Direction::Max;
+	}
+
+	// cool time of transform has passed for every fixture
+	utility::Milliseconds current_time(TransformCooltime * 10);
+
+	results.push_back(RunBenchmark("sector_system.update" + BenchmarkSuffix(fixture_count), tick_count, 0, [&]() {
+		current_time += tick;
+		sector.Update(current_time, tick);
+	}));
+
+	DoNotOptimize(callback.event_count);
+}
+
+inline void BenchmarkSectorGrid(std::vector<BenchmarkResult>& results, const uint64_t iterations)
+{
+	FixtureRectangle world = WorldRect;
+
+	uint64_t position_index = 0;
+	results.push_back(RunBenchmark("sector_grid.get_sector_by_position", iterations, 0, [&]() {
+		// walks the world diagonal including positions outside of it
+		CoordinateUnit ratio = static_cast<CoordinateUnit>(position_index++ % 1024) / 1000.0f;
+		Vector2 position{ world.left + (world.right - world.left) * ratio, world.down + (world.up - world.down) * ratio };
+
+		uint64_t sector_id = GetSectorByPosition(position);
+		DoNotOptimize(sector_id);
+	}));
+
+	uint64_t query_index = 0;
+	results.push_back(RunBenchmark("sector_grid.get_near_sectors", iterations, 0, [&]() {
+		uint64_t sector_id = query_index % SectorGridList.size();
+		Direction direction = static_cast<Direction>((query_index / SectorGridList.size()) % 8);
+		query_index++;
+
+		std::array<uint64_t, 3> sectors = GetNearSectors(sector_id, direction);
+		DoNotOptimize(sectors);
+	}));
+}
+
+inline void RunSectorBenchmarks(std::vector<BenchmarkResult>& results, const uint64_t iterations)
+{
+	// simulated time stays short enough to keep fixtures inside the sector
+	for (const uint32_t fixture_count : { 1000u, 10000u, 100000u })
+		BenchmarkSectorUpdate(results, fixture_count, 100);
+
+	BenchmarkSectorGrid(results, iterations);
+}
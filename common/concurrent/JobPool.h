@@ -0,0 +1,177 @@
+#pragma once
+
+#include "../memory/Allocator.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <functional>
+
+// work stealing job pool
+// owner pops from back of its own queue, idle thread steals from front of other queues
+// caller of ParallelFor participates as queue 0 and returns after every job is finished
+class JobPool final
+{
+public:
+	using Job = std::function<void(const uint64_t)>;
+
+private:
+	struct JobEntry
+	{
+		const Job* job;
+		uint64_t index;
+	};
+
+	struct JobQueue
+	{
+		CACHE_ALIGN std::mutex mutex;
+		std::deque<JobEntry> entries;
+	};
+
+	std::vector<std::thread> _workers;
+	std::vector<JobQueue*> _queues;
+
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	uint64_t _generation = 0;
+	bool _stop = false;
+
+	CACHE_ALIGN std::atomic<uint64_t> _remain_jobs = 0;
+
+	bool PopJob(const uint32_t queue_index, JobEntry& entry)
+	{
+		JobQueue* queue = _queues[queue_index];
+		std::lock_guard<std::mutex> guard(queue->mutex);
+
+		if (queue->entries.empty())
+			return false;
+
+		entry = queue->entries.back();
+		queue->entries.pop_back();
+
+		return true;
+	}
+
+	bool StealJob(const uint32_t queue_index, JobEntry& entry)
+	{
+		for (uint32_t offset = 1; offset < _queues.size(); offset++)
+		{
+			JobQueue* victim = _queues[(queue_index + offset) % _queues.size()];
+			std::lock_guard<std::mutex> guard(victim->mutex);
+
+			if (victim->entries.empty())
+				continue;
+
+			entry = victim->entries.front();
+			victim->entries.pop_front();
+
+			return true;
+		}
+
+		return false;
+	}
+
+	void Execute(const uint32_t queue_index)
+	{
+		JobEntry entry;
+
+		while (PopJob(queue_index, entry) || StealJob(queue_index, entry))
+		{
+			(*entry.job)(entry.index);
+			_remain_jobs.fetch_sub(1, std::memory_order_acq_rel);
+		}
+	}
+
+	void WorkerMain(const uint32_t queue_index)
+	{
+		uint64_t generation = 0;
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_condition.wait(lock, [&]() { return _stop || _generation != generation; });
+
+				if (_stop)
+					return;
+
+				generation = _generation;
+			}
+
+			Execute(queue_index);
+		}
+	}
+
+public:
+	// concurrency includes caller thread, 1 = run jobs on caller thread only
+	JobPool(const uint32_t concurrency)
+	{
+		uint32_t queue_count = concurrency == 0 ? 1 : concurrency;
+
+		for (uint32_t index = 0; index < queue_count; index++)
+			_queues.push_back(new JobQueue());
+
+		for (uint32_t index = 1; index < queue_count; index++)
+			_workers.emplace_back(&JobPool::WorkerMain, this, index);
+	}
+
+	NONCOPYABLE(JobPool)
+
+	uint32_t Concurrency() const
+	{
+		return static_cast<uint32_t>(_queues.size());
+	}
+
+	// "Thread Unsafe", only one ParallelFor at a time
+	void ParallelFor(const uint64_t count, const Job& job)
+	{
+		if (count == 0)
+			return;
+
+		if (_workers.empty())
+		{
+			for (uint64_t index = 0; index < count; index++)
+				job(index);
+
+			return;
+		}
+
+		_remain_jobs.store(count, std::memory_order_release);
+
+		for (uint32_t queue_index = 0; queue_index < _queues.size(); queue_index++)
+		{
+			JobQueue* queue = _queues[queue_index];
+			std::lock_guard<std::mutex> guard(queue->mutex);
+
+			for (uint64_t index = queue_index; index < count; index += _queues.size())
+				queue->entries.push_back({ &job, index });
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(_mutex);
+			_generation++;
+		}
+		_condition.notify_all();
+
+		Execute(0);
+
+		while (_remain_jobs.load(std::memory_order_acquire) != 0)
+			std::this_thread::yield();
+	}
+
+	~JobPool()
+	{
+		{
+			std::lock_guard<std::mutex> guard(_mutex);
+			_stop = true;
+		}
+		_condition.notify_all();
+
+		for (std::thread& worker : _workers)
+			worker.join();
+
+		for (JobQueue* queue : _queues)
+			delete queue;
+	}
+};
@@ -1,58 +1,239 @@
 #pragma once
 
-#include "../utility/Time.h"
+#include "../utility/Clock.h"
+#include "../utility/Metrics.h"
+#include "../memory/FrameArena.h"
 #include "LinearWorkQueue.h"
+#include "ProducerLaneQueue.h"
 #include <thread>
 #include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <utility>
 
 using WorkerTimeUnit = utility::Milliseconds;
 
+// per-phase timings of worker loop, microseconds
+struct WorkerPhaseStatistics
+{
+	uint64_t tick_count = 0;
+
+	// ticks run back to back to catch up late schedule
+	uint64_t catch_up_tick_count = 0;
+
+	// ticks skipped when lateness is over catch-up limit
+	uint64_t dropped_tick_count = 0;
+
+	// iterations that stopped packet processing at time budget
+	uint64_t budget_exceeded_count = 0;
+	uint64_t deferred_context_count = 0;
+
+	uint64_t last_context_time_us = 0;
+	uint64_t max_context_time_us = 0;
+	uint64_t last_update_time_us = 0;
+	uint64_t max_update_time_us = 0;
+	uint64_t last_every_tick_time_us = 0;
+	uint64_t max_every_tick_time_us = 0;
+
+	// lateness of tick start from fixed schedule
+	uint64_t last_tick_jitter_us = 0;
+	uint64_t max_tick_jitter_us = 0;
+};
+
 template <typename T>
 class LinearWorker
 {
 private:
+	// written by worker thread, read by any thread
+	struct PhaseCounter
+	{
+		std::atomic<uint64_t> last = 0;
+		std::atomic<uint64_t> max = 0;
+
+		utility::MetricHistogram* histogram = nullptr;
+
+		void Record(const utility::Nanoseconds elapsed)
+		{
+			uint64_t value = static_cast<uint64_t>(utility::TimeCast<utility::Microseconds>(elapsed).count());
+
+			last.store(value, std::memory_order_relaxed);
+			if (value > max.load(std::memory_order_relaxed))
+				max.store(value, std::memory_order_relaxed);
+
+			if (histogram != nullptr)
+				histogram->Record(value);
+		}
+	};
+
+	// label of registry instruments, in start order
+	static inline std::atomic<uint32_t> _worker_sequence = 0;
+
+	utility::MetricGauge* _queue_depth_metric = nullptr;
+	utility::MetricGauge* _frame_arena_metric = nullptr;
+
+	// bound to worker thread, containers opted in by UseFrameArena live until next iteration
+	FrameArena _frame_arena;
+
+	// deferred contexts over this count stop draining, producers see full queue instead of unbounded backlog
+	static constexpr std::size_t MAX_DEFERRED_CONTEXT_COUNT = 65536;
+
 	std::thread _worker;
 	LinearWorkQueue<T, 65536> _context_queue;
+	ProducerLaneQueue<T, 64> _lane_queue;
+
+	std::atomic<uint64_t> _tick_count = 0;
+	std::atomic<uint64_t> _catch_up_tick_count = 0;
+	std::atomic<uint64_t> _dropped_tick_count = 0;
+	std::atomic<uint64_t> _budget_exceeded_count = 0;
+	std::atomic<uint64_t> _deferred_context_count = 0;
+
+	PhaseCounter _context_phase;
+	PhaseCounter _update_phase;
+	PhaseCounter _every_tick_phase;
+	PhaseCounter _tick_jitter;
+
+	// process contexts from offset in chunks until budget is spent, return processed offset
+	std::size_t ProcessContexts(const std::vector<T>& contexts, std::size_t offset, std::vector<T>& chunk, const WorkerTimeUnit delta_time)
+	{
+		utility::Nanoseconds phase_start = utility::FineTick();
+
+		if (_context_budget.count() == 0 && offset == 0)
+		{
+			UpdateContext(contexts, _current_time, delta_time);
+			offset = contexts.size();
+		}
+		else
+		{
+			while (offset < contexts.size())
+			{
+				std::size_t count = std::min<std::size_t>(_context_chunk_size, contexts.size() - offset);
+
+				chunk.assign(contexts.begin() + offset, contexts.begin() + offset + count);
+				UpdateContext(chunk, _current_time, delta_time);
+				chunk.clear();
+
+				offset += count;
+
+				if (_context_budget.count() != 0 && offset < contexts.size() && utility::FineTick() - phase_start >= _context_budget)
+				{
+					_budget_exceeded_count.fetch_add(1, std::memory_order_relaxed);
+					break;
+				}
+			}
+		}
+
+		_context_phase.Record(utility::FineTick() - phase_start);
+
+		return offset;
+	}
 
 	void WorkerMain()
 	{
 		bool run = true;
 		bool no_sleep = false;
 
-
 		std::vector<T> contexts;
+		std::vector<T> chunk;
+		std::size_t context_offset = 0;
 		T context;
 
-		WorkerTimeUnit last_update_time(0), last_update_context_time(0);
+		WorkerTimeUnit last_update_context_time(0);
+		WorkerTimeUnit next_update_time = utility::CurrentTick<utility::Milliseconds>();
+
+		FrameArena::Bind(&_frame_arena);
 
 		while (run)
 		{
-			_context_queue.LockSubmissionQueue();
+			_frame_arena.Reset();
+			_frame_arena_metric->Set(static_cast<int64_t>(_frame_arena.Capacity()));
+
+#ifdef _DEBUG
+			// frame container filled in last iteration without UseFrameArena
+			uint64_t missed_allocation_count = std::exchange(FrameArena::MissedAllocationCount(), 0);
+			assert(missed_allocation_count == 0);
+#endif
+
+			if (context_offset > 0)
+			{
+				contexts.erase(contexts.begin(), contexts.begin() + context_offset);
+				context_offset = 0;
+			}
 
-			while (_context_queue.TryPop(context))
-				contexts.push_back(context);
+			if (contexts.size() < MAX_DEFERRED_CONTEXT_COUNT)
+			{
+				_context_queue.LockSubmissionQueue();
+
+				while (_context_queue.TryPop(context))
+					contexts.push_back(context);
+
+				_lane_queue.Drain(contexts, _lane_batch_size);
+			}
+
+			_queue_depth_metric->Set(static_cast<int64_t>(contexts.size() - context_offset));
 
-			_current_time = utility::CurrentTick<utility::Milliseconds>();
+			// one clock read per iteration, contexts and updates of this iteration read coarse clock
+			utility::CoarseClock::Refresh();
+			_current_time = utility::CoarseTick<utility::Milliseconds>();
 
 			if (!contexts.empty())
 			{
-				UpdateContext(contexts, _current_time, _current_time - last_update_context_time);
-				last_update_context_time = utility::CurrentTick<utility::Milliseconds>();
-				contexts.clear();
+				context_offset = ProcessContexts(contexts, context_offset, chunk, _current_time - last_update_context_time);
+				last_update_context_time = _current_time;
+
+				if (context_offset == contexts.size())
+				{
+					contexts.clear();
+					context_offset = 0;
+				}
 
 				no_sleep = true;
 			}
 
-			if ((_current_time - last_update_time) >= _update_tick)
+			_deferred_context_count.store(contexts.size() - context_offset, std::memory_order_relaxed);
+
+			// fixed timestep, every update advances exactly one update tick and sees its own scheduled time
+			if (_current_time >= next_update_time)
 			{
-				run = Update(_current_time, _current_time - last_update_time);
-				last_update_time = _current_time;
+				_tick_jitter.Record(_current_time - next_update_time);
+
+				uint32_t tick_count = 0;
+
+				while (run && _current_time >= next_update_time && tick_count < _max_catch_up_ticks)
+				{
+					utility::Nanoseconds phase_start = utility::FineTick();
+
+					run = Update(next_update_time, _update_tick);
+
+					_update_phase.Record(utility::FineTick() - phase_start);
+
+					next_update_time += _update_tick;
+					tick_count++;
+				}
+
+				_tick_count.fetch_add(tick_count, std::memory_order_relaxed);
+				if (tick_count > 1)
+					_catch_up_tick_count.fetch_add(tick_count - 1, std::memory_order_relaxed);
+
+				// too late to catch up, skip to the next slot of the schedule
+				if (_current_time >= next_update_time)
+				{
+					uint64_t dropped_tick_count = (_current_time - next_update_time) / _update_tick + 1;
+
+					next_update_time += _update_tick * static_cast<int64_t>(dropped_tick_count);
+					_dropped_tick_count.fetch_add(dropped_tick_count, std::memory_order_relaxed);
+
+					OnTickDropped(dropped_tick_count);
+				}
 
 				no_sleep = true;
 			}
 			
+			utility::Nanoseconds every_tick_start = utility::FineTick();
+
 			UpdateEveryTick(_current_time);
 
+			_every_tick_phase.Record(utility::FineTick() - every_tick_start);
+
 			if (no_sleep)
 			{
 				no_sleep = false;
@@ -67,19 +248,39 @@ protected:
 	WorkerTimeUnit _update_tick = WorkerTimeUnit(0);
 	WorkerTimeUnit _current_time = WorkerTimeUnit(0);
 
+	uint32_t _lane_batch_size = 1024;
+
+	// 0 = unbounded, contexts over budget are deferred to next iteration in arrival order
+	utility::Microseconds _context_budget = utility::Microseconds(0);
+	uint32_t _context_chunk_size = 256;
+	uint32_t _max_catch_up_ticks = 4;
+
 	virtual bool Update(const WorkerTimeUnit current_time, const WorkerTimeUnit delta_time) = 0;
 	virtual void UpdateContext(const std::vector<T>& contexts, const WorkerTimeUnit current_time, const WorkerTimeUnit delta_time) {}
 
 	virtual void UpdateEveryTick(const WorkerTimeUnit current_time) {}
 
+	virtual void OnTickDropped(const uint64_t dropped_tick_count) {}
+
 public:
 
-	void Start(const WorkerTimeUnit update_tick)
+	void Start(const WorkerTimeUnit update_tick, const utility::Microseconds context_budget = utility::Microseconds(0), const uint32_t max_catch_up_ticks = 4)
 	{
 		if (_update_tick.count() != 0)
 			return;
 
 		_update_tick = update_tick;
+		_context_budget = context_budget;
+		_max_catch_up_ticks = max_catch_up_ticks == 0 ? 1 : max_catch_up_ticks;
+
+		std::string labels = "worker=\"" + std::to_string(_worker_sequence.fetch_add(1, std::memory_order_relaxed)) + "\"";
+		utility::MetricRegistry* registry = utility::MetricRegistry::GetInstance();
+
+		_queue_depth_metric = registry->Gauge("worker_queue_depth", "contexts pending in worker after draining queues", labels);
+		_context_phase.histogram = registry->Histogram("worker_update_context_time_us", "duration of UpdateContext phase of one iteration", labels);
+		_update_phase.histogram = registry->Histogram("worker_update_time_us", "duration of one Update tick", labels);
+		_frame_arena_metric = registry->Gauge("worker_frame_arena_bytes", "capacity of frame arena, flat once worker reached steady state", labels);
+
 		_worker = std::thread(&LinearWorker::WorkerMain, this);
 	}
 
@@ -87,4 +288,47 @@ public:
 	{
 		return _context_queue.TryPush(context);
 	}
+
+	// producer lane is owned by one producer thread, call before the producer starts submitting
+	uint32_t RegisterProducerLane(const uint64_t initial_capacity, const uint64_t max_capacity)
+	{
+		return _lane_queue.RegisterLane(initial_capacity, max_capacity);
+	}
+
+	bool Submit(const T& context, const uint32_t lane_index)
+	{
+		return _lane_queue.TryPush(lane_index, context);
+	}
+
+	uint32_t GetProducerLaneCount() const
+	{
+		return _lane_queue.LaneCount();
+	}
+
+	LaneStatistics GetProducerLaneStatistics(const uint32_t lane_index) const
+	{
+		return _lane_queue.GetLaneStatistics(lane_index);
+	}
+
+	WorkerPhaseStatistics GetPhaseStatistics() const
+	{
+		WorkerPhaseStatistics statistics;
+
+		statistics.tick_count = _tick_count.load(std::memory_order_relaxed);
+		statistics.catch_up_tick_count = _catch_up_tick_count.load(std::memory_order_relaxed);
+		statistics.dropped_tick_count = _dropped_tick_count.load(std::memory_order_relaxed);
+		statistics.budget_exceeded_count = _budget_exceeded_count.load(std::memory_order_relaxed);
+		statistics.deferred_context_count = _deferred_context_count.load(std::memory_order_relaxed);
+
+		statistics.last_context_time_us = _context_phase.last.load(std::memory_order_relaxed);
+		statistics.max_context_time_us = _context_phase.max.load(std::memory_order_relaxed);
+		statistics.last_update_time_us = _update_phase.last.load(std::memory_order_relaxed);
+		statistics.max_update_time_us = _update_phase.max.load(std::memory_order_relaxed);
+		statistics.last_every_tick_time_us = _every_tick_phase.last.load(std::memory_order_relaxed);
+		statistics.max_every_tick_time_us = _every_tick_phase.max.load(std::memory_order_relaxed);
+		statistics.last_tick_jitter_us = _tick_jitter.last.load(std::memory_order_relaxed);
+		statistics.max_tick_jitter_us = _tick_jitter.max.load(std::memory_order_relaxed);
+
+		return statistics;
+	}
 };
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../common.h"
+#include <mutex>
+#include <vector>
+#include <cassert>
+
+// Multi Provider / Single Consumer
+// unbounded, messages posted before Drain are delivered in posting order
+template <typename T>
+class Mailbox final
+{
+private:
+	std::mutex _mutex;
+	std::vector<T> _messages;
+
+public:
+	Mailbox() {}
+	NONCOPYABLE_T(Mailbox, Mailbox<T>)
+
+	void Post(T&& message)
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+
+		_messages.push_back(std::move(message));
+	}
+
+	// consumer thread only, result must be empty
+	void Drain(std::vector<T>& result)
+	{
+		assert(result.empty());
+
+		std::lock_guard<std::mutex> guard(_mutex);
+
+		if (!_messages.empty())
+			std::swap(_messages, result);
+	}
+};
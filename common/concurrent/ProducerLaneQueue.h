@@ -0,0 +1,267 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <vector>
+#include <mutex>
+#include <cassert>
+#include "../memory/Allocator.h"
+
+struct LaneStatistics
+{
+	uint64_t size = 0;
+	uint64_t capacity = 0;
+	uint64_t high_water_mark = 0;
+	uint64_t full_count = 0;
+};
+
+// Single Provider / Single Consumer
+// grows by doubling the ring up to max_capacity when the producer catches the consumer
+template <typename T>
+class SpscLane final
+{
+private:
+	struct Segment
+	{
+		CACHE_ALIGN std::atomic<uint64_t> tail = 0;
+		CACHE_ALIGN std::atomic<uint64_t> head = 0;
+		CACHE_ALIGN std::atomic<Segment*> next = nullptr;
+
+		const uint64_t capacity;
+		const uint64_t mask;
+		T* const slots;
+
+		Segment(const uint64_t capacity) : capacity(capacity), mask(capacity - 1), slots(new T[capacity]) {}
+
+		~Segment()
+		{
+			delete[] slots;
+		}
+	};
+
+	// producer side
+	CACHE_ALIGN Segment* _producer_segment;
+	uint64_t _cached_head = 0;
+	std::atomic<uint64_t> _high_water_mark = 0;
+	std::atomic<uint64_t> _full_count = 0;
+	std::atomic<uint64_t> _pushed_count = 0;
+	std::atomic<uint64_t> _capacity;
+
+	// consumer side
+	CACHE_ALIGN Segment* _consumer_segment;
+	std::atomic<uint64_t> _popped_count = 0;
+
+	const uint64_t _max_capacity;
+
+	static uint64_t RoundUpPowerOfTwo(const uint64_t value)
+	{
+		uint64_t result = 1;
+		while (result < value)
+			result <<= 1;
+
+		return result;
+	}
+
+public:
+	SpscLane(const uint64_t initial_capacity, const uint64_t max_capacity)
+		: _max_capacity(RoundUpPowerOfTwo(max_capacity < initial_capacity ? initial_capacity : max_capacity))
+	{
+		Segment* segment = new Segment(RoundUpPowerOfTwo(initial_capacity < 2 ? 2 : initial_capacity));
+
+		_producer_segment = segment;
+		_consumer_segment = segment;
+		_capacity = segment->capacity;
+	}
+
+	NONCOPYABLE_T(SpscLane, SpscLane<T>)
+
+	// producer thread only
+	bool TryPush(const T& value)
+	{
+		Segment* segment = _producer_segment;
+		uint64_t tail = segment->tail.load(std::memory_order_relaxed);
+
+		if (tail - _cached_head >= segment->capacity)
+		{
+			_cached_head = segment->head.load(std::memory_order_acquire);
+
+			if (tail - _cached_head >= segment->capacity)
+			{
+				if (segment->capacity * 2 > _max_capacity)
+				{
+					_full_count.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+
+				// consumer drains the old segment first, then follows next
+				Segment* new_segment = new (std::nothrow) Segment(segment->capacity * 2);
+				if (new_segment == nullptr)
+				{
+					_full_count.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+
+				segment->next.store(new_segment, std::memory_order_release);
+
+				_producer_segment = segment = new_segment;
+				_cached_head = 0;
+				tail = 0;
+
+				_capacity.store(new_segment->capacity, std::memory_order_relaxed);
+			}
+		}
+
+		segment->slots[tail & segment->mask] = value;
+		segment->tail.store(tail + 1, std::memory_order_release);
+
+		uint64_t pushed = _pushed_count.fetch_add(1, std::memory_order_relaxed) + 1;
+		uint64_t size = pushed - _popped_count.load(std::memory_order_relaxed);
+		if (size > _high_water_mark.load(std::memory_order_relaxed))
+			_high_water_mark.store(size, std::memory_order_relaxed);
+
+		return true;
+	}
+
+	// consumer thread only
+	bool TryPop(T& result)
+	{
+		while (true)
+		{
+			Segment* segment = _consumer_segment;
+			uint64_t head = segment->head.load(std::memory_order_relaxed);
+
+			if (head != segment->tail.load(std::memory_order_acquire))
+			{
+				result = segment->slots[head & segment->mask];
+				segment->head.store(head + 1, std::memory_order_release);
+				_popped_count.fetch_add(1, std::memory_order_relaxed);
+
+				return true;
+			}
+
+			Segment* next = segment->next.load(std::memory_order_acquire);
+			if (next == nullptr)
+				return false;
+
+			// producer never writes the old segment after linking next, recheck once before release
+			if (segment->head.load(std::memory_order_relaxed) != segment->tail.load(std::memory_order_acquire))
+				continue;
+
+			_consumer_segment = next;
+			delete segment;
+		}
+	}
+
+	LaneStatistics GetStatistics() const
+	{
+		LaneStatistics statistics;
+
+		uint64_t popped = _popped_count.load(std::memory_order_relaxed);
+		uint64_t pushed = _pushed_count.load(std::memory_order_relaxed);
+
+		statistics.size = pushed > popped ? pushed - popped : 0;
+		statistics.capacity = _capacity.load(std::memory_order_relaxed);
+		statistics.high_water_mark = _high_water_mark.load(std::memory_order_relaxed);
+		statistics.full_count = _full_count.load(std::memory_order_relaxed);
+
+		return statistics;
+	}
+
+	~SpscLane()
+	{
+		Segment* segment = _consumer_segment;
+		while (segment != nullptr)
+		{
+			Segment* next = segment->next.load(std::memory_order_acquire);
+			delete segment;
+			segment = next;
+		}
+	}
+};
+
+// Multi Provider / Single Consumer
+// one lane per producer thread, each producer only pushes to its own lane
+template <typename T, std::size_t MAX_LANE_COUNT>
+class ProducerLaneQueue final
+{
+private:
+	std::array<SpscLane<T>*, MAX_LANE_COUNT> _lanes{};
+	std::atomic<uint32_t> _lane_count = 0;
+
+	std::mutex _registration_mutex;
+
+	uint32_t _next_lane = 0;
+
+public:
+	ProducerLaneQueue() {}
+
+	ProducerLaneQueue(const ProducerLaneQueue<T, MAX_LANE_COUNT>&) = delete;
+	ProducerLaneQueue<T, MAX_LANE_COUNT>& operator=(const ProducerLaneQueue<T, MAX_LANE_COUNT>&) = delete;
+
+	// return lane index, UINT32_MAX if no more lane
+	uint32_t RegisterLane(const uint64_t initial_capacity, const uint64_t max_capacity)
+	{
+		std::lock_guard<std::mutex> guard(_registration_mutex);
+
+		uint32_t lane_index = _lane_count.load(std::memory_order_relaxed);
+		if (lane_index >= MAX_LANE_COUNT)
+			return UINT32_MAX;
+
+		_lanes[lane_index] = new SpscLane<T>(initial_capacity, max_capacity);
+		_lane_count.store(lane_index + 1, std::memory_order_release);
+
+		return lane_index;
+	}
+
+	bool TryPush(const uint32_t lane_index, const T& value)
+	{
+		assert(lane_index < _lane_count.load(std::memory_order_acquire));
+
+		return _lanes[lane_index]->TryPush(value);
+	}
+
+	// consumer thread only, pops up to batch_size per lane in round-robin order
+	uint32_t Drain(std::vector<T>& result, const uint32_t batch_size)
+	{
+		uint32_t lane_count = _lane_count.load(std::memory_order_acquire);
+		if (lane_count == 0)
+			return 0;
+
+		uint32_t popped = 0;
+		T value;
+
+		for (uint32_t count = 0; count < lane_count; count++)
+		{
+			SpscLane<T>* lane = _lanes[(_next_lane + count) % lane_count];
+
+			for (uint32_t batch = 0; batch < batch_size && lane->TryPop(value); batch++)
+			{
+				result.push_back(value);
+				popped++;
+			}
+		}
+
+		_next_lane = (_next_lane + 1) % lane_count;
+
+		return popped;
+	}
+
+	uint32_t LaneCount() const
+	{
+		return _lane_count.load(std::memory_order_acquire);
+	}
+
+	LaneStatistics GetLaneStatistics(const uint32_t lane_index) const
+	{
+		if (lane_index >= _lane_count.load(std::memory_order_acquire))
+			return {};
+
+		return _lanes[lane_index]->GetStatistics();
+	}
+
+	~ProducerLaneQueue()
+	{
+		for (SpscLane<T>* lane : _lanes)
+			delete lane;
+	}
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "../utility/Metrics.h"
+#include <array>
+
+// stages of traced hop, see PacketTrace.h
+enum class TraceStage : uint8_t
+{
+	// sender serialized -> OnRead
+	Network,
+	// OnRead -> submitted to worker
+	Ingress,
+	// submitted -> worker dequeued
+	Queue,
+	// dequeued -> handler started, contexts ahead in same batch
+	Batch,
+	// handler started -> handler returned
+	Handle,
+
+	Count,
+};
+
+// predefined instruments, registered on first use
+class EngineMetrics
+{
+private:
+	static utility::MetricRegistry* Registry()
+	{
+		return utility::MetricRegistry::GetInstance();
+	}
+
+public:
+	static utility::MetricCounter* ReadBytes()
+	{
+		static utility::MetricCounter* metric = Registry()->Counter("engine_read_bytes_total", "bytes of complete packets framed by OnRead");
+		return metric;
+	}
+
+	static utility::MetricCounter* ReadPackets()
+	{
+		static utility::MetricCounter* metric = Registry()->Counter("engine_read_packets_total", "complete packets framed by OnRead");
+		return metric;
+	}
+
+	static utility::MetricHistogram* WorkerSojournTime()
+	{
+		static utility::MetricHistogram* metric = Registry()->Histogram("engine_worker_sojourn_time_us", "time from submission to worker until UpdateContext starts");
+		return metric;
+	}
+
+	static utility::MetricGauge* ReadBuffersInUse()
+	{
+		static utility::MetricGauge* metric = Registry()->Gauge("engine_socket_buffers_in_use", "socket buffers taken from stream pools", "kind=\"read\"");
+		return metric;
+	}
+
+	static utility::MetricGauge* WriteBuffersInUse()
+	{
+		static utility::MetricGauge* metric = Registry()->Gauge("engine_socket_buffers_in_use", "socket buffers taken from stream pools", "kind=\"write\"");
+		return metric;
+	}
+
+	static utility::MetricHistogram* ThrottlerFlushBytes()
+	{
+		static utility::MetricHistogram* metric = Registry()->Histogram("engine_throttler_flush_bytes", "size of batch sent by PacketThrottler");
+		return metric;
+	}
+
+	static utility::MetricGauge* OpenedSessions()
+	{
+		static utility::MetricGauge* metric = Registry()->Gauge("engine_sessions", "sessions per state, closed sessions are not counted", "state=\"opened\"");
+		return metric;
+	}
+
+	static utility::MetricGauge* AbandonedSessions()
+	{
+		static utility::MetricGauge* metric = Registry()->Gauge("engine_sessions", "sessions per state, closed sessions are not counted", "state=\"abandoned\"");
+		return metric;
+	}
+
+	static utility::MetricGauge* WaitingSessions()
+	{
+		static utility::MetricGauge* metric = Registry()->Gauge("engine_sessions", "sessions per state, closed sessions are not counted", "state=\"wait\"");
+		return metric;
+	}
+
+	static utility::MetricHistogram* WorldUpdateTime()
+	{
+		static utility::MetricHistogram* metric = Registry()->Histogram("game_world_update_time_us", "duration of World::Update");
+		return metric;
+	}
+
+	static utility::MetricHistogram* TraceStageTime(const TraceStage stage)
+	{
+		static const char* const help = "stage latency of traced packet hops";
+		static const std::array<utility::MetricHistogram*, static_cast<std::size_t>(TraceStage::Count)> metrics = {
+			Registry()->Histogram("engine_trace_stage_time_us", help, "stage=\"network\""),
+			Registry()->Histogram("engine_trace_stage_time_us", help, "stage=\"ingress\""),
+			Registry()->Histogram("engine_trace_stage_time_us", help, "stage=\"queue\""),
+			Registry()->Histogram("engine_trace_stage_time_us", help, "stage=\"batch\""),
+			Registry()->Histogram("engine_trace_stage_time_us", help, "stage=\"handle\""),
+		};
+
+		return metrics[static_cast<std::size_t>(stage)];
+	}
+};
@@ -0,0 +1,295 @@
+#pragma once
+
+#include "SocketSession.h"
+#include "protocol/PacketRegistry.h"
+#include "../utility/Time.h"
+#include "../utility/Clock.h"
+#include "../utility/Logger.h"
+#include "../utility/Metrics.h"
+#include <async_simple/coro/Lazy.h>
+#include <coroutine>
+#include <map>
+#include <unordered_map>
+
+// request: correlation id without response bit, response: same id with response bit
+constexpr uint32_t CORRELATION_RESPONSE_BIT = 0x80000000;
+
+inline bool IsCorrelatedResponse(const PacketHeader& header)
+{
+	return (header.correlation_id & CORRELATION_RESPONSE_BIT) != 0;
+}
+
+inline uint32_t ToResponseCorrelationId(const uint32_t request_correlation_id)
+{
+	return request_correlation_id == 0 ? 0 : (request_correlation_id | CORRELATION_RESPONSE_BIT);
+}
+
+enum class CallStatus : uint8_t
+{
+	Success,
+	Timeout,
+	Disconnected,
+	InvalidResponse,
+};
+
+template <NetworkPacketConcept Response>
+struct CallResult
+{
+	CallStatus status = CallStatus::Success;
+	ErrorCode error_code = ErrorCode::None;
+	Response packet;
+	utility::Milliseconds latency = utility::Milliseconds(0);
+};
+
+// registry instruments of one request type, shared by every manager
+struct CallMetrics
+{
+	utility::MetricCounter* calls;
+	utility::MetricCounter* success;
+	utility::MetricCounter* invalid_response;
+	utility::MetricCounter* timeout;
+	utility::MetricCounter* disconnected;
+
+	// successful calls only
+	utility::MetricHistogram* latency_ms;
+};
+
+// "Thread Unsafe", owned by one worker thread
+// every call on the worker is pipelined on the link, the coroutine is resumed on the worker when response, timeout or disconnect arrives
+class IntraCallManager
+{
+private:
+	struct PendingCall
+	{
+		// complete fills result of awaiter and returns final status, handle is resumed after status is recorded
+		void* awaiter = nullptr;
+		CallStatus (*complete)(void* const awaiter, const CallStatus status, const PacketHeader* const header, const uint8_t* const body) = nullptr;
+		std::coroutine_handle<> handle;
+
+		uint64_t session_id = 0;
+		PacketType request_type;
+		utility::Milliseconds start_time;
+		std::multimap<utility::Milliseconds, uint32_t>::iterator deadline;
+	};
+
+	template <NetworkPacketConcept Response, NetworkPacketConcept Request>
+	class CallAwaiter
+	{
+	private:
+		IntraCallManager* _manager;
+		SocketSessionPtr _session;
+		const Request& _request;
+		utility::Milliseconds _timeout;
+
+		CallResult<Response> _result;
+
+		static CallStatus Complete(void* const awaiter, const CallStatus status, const PacketHeader* const header, const uint8_t* const body)
+		{
+			CallAwaiter* self = static_cast<CallAwaiter*>(awaiter);
+
+			self->_result.status = status;
+
+			if (header != nullptr)
+			{
+				self->_result.error_code = header->error_code;
+
+				if (header->packet_type != Response::PACKET_TYPE || !DeserializePacketBody(body, header->body_size, self->_result.packet))
+					self->_result.status = CallStatus::InvalidResponse;
+			}
+
+			return self->_result.status;
+		}
+
+	public:
+		CallAwaiter(IntraCallManager* const manager, const SocketSessionPtr& session, const Request& request, const utility::Milliseconds timeout)
+			: _manager(manager), _session(session), _request(request), _timeout(timeout) {}
+
+		bool await_ready()
+		{
+			if (_session.Valid())
+				return false;
+
+			_result.status = CallStatus::Disconnected;
+			return true;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle)
+		{
+			uint32_t correlation_id = _manager->Register(this, &CallAwaiter::Complete, handle, _session->GetSessionId(), Request::PACKET_TYPE, _timeout);
+
+			_session->Send(_request, ErrorCode::None, false, correlation_id);
+		}
+
+		CallResult<Response> await_resume()
+		{
+			return std::move(_result);
+		}
+	};
+
+	uint32_t _current_correlation_id = 0;
+
+	std::unordered_map<uint32_t, PendingCall> _pending_calls;
+	std::multimap<utility::Milliseconds, uint32_t> _deadlines;
+
+	// cache of registry lookup, registry locks on every lookup
+	std::unordered_map<PacketType, CallMetrics> _metrics;
+
+	CallMetrics& GetMetrics(const PacketType request_type)
+	{
+		auto iterator = _metrics.find(request_type);
+		if (iterator != _metrics.end())
+			return iterator->second;
+
+		utility::MetricRegistry* registry = utility::MetricRegistry::GetInstance();
+		std::string request = "request=\"" + std::string(GetPacketTraits(request_type).name) + "\"";
+
+		auto counter = [&](const std::string_view status) {
+			return registry->Counter("intra_calls_total", "intra calls by request and completion status", request + ",status=\"" + std::string(status) + "\"");
+		};
+
+		CallMetrics metrics{
+			counter("started"),
+			counter("success"),
+			counter("invalid_response"),
+			counter("timeout"),
+			counter("disconnected"),
+			registry->Histogram("intra_call_latency_ms", "latency of successful intra calls", request),
+		};
+
+		return _metrics.emplace(request_type, metrics).first->second;
+	}
+
+	uint32_t Register(void* const awaiter, CallStatus (*complete)(void* const, const CallStatus, const PacketHeader* const, const uint8_t* const), const std::coroutine_handle<> handle, const uint64_t session_id, const PacketType request_type, const utility::Milliseconds timeout)
+	{
+		do
+		{
+			_current_correlation_id = (_current_correlation_id + 1) & ~CORRELATION_RESPONSE_BIT;
+		} while (_current_correlation_id == 0 || _pending_calls.contains(_current_correlation_id));
+
+		utility::Milliseconds now = utility::CoarseTick<utility::Milliseconds>();
+
+		PendingCall& call = _pending_calls[_current_correlation_id];
+		call.awaiter = awaiter;
+		call.complete = complete;
+		call.handle = handle;
+		call.session_id = session_id;
+		call.request_type = request_type;
+		call.start_time = now;
+		call.deadline = _deadlines.emplace(now + timeout, _current_correlation_id);
+
+		GetMetrics(request_type).calls->Add();
+
+		return _current_correlation_id;
+	}
+
+	void Complete(const uint32_t correlation_id, const CallStatus status, const PacketHeader* const header, const uint8_t* const body)
+	{
+		auto iterator = _pending_calls.find(correlation_id);
+		if (iterator == _pending_calls.end())
+			return;
+
+		PendingCall call = iterator->second;
+
+		_deadlines.erase(call.deadline);
+		_pending_calls.erase(iterator);
+
+		CallMetrics& metrics = GetMetrics(call.request_type);
+		utility::Milliseconds latency = utility::CoarseTick<utility::Milliseconds>() - call.start_time;
+
+		switch (call.complete(call.awaiter, status, header, body))
+		{
+		case CallStatus::Success:
+			metrics.success->Add();
+			metrics.latency_ms->Record(static_cast<uint64_t>(latency.count()));
+			break;
+		case CallStatus::InvalidResponse:
+			metrics.invalid_response->Add();
+			break;
+		case CallStatus::Timeout:
+			metrics.timeout->Add();
+			break;
+		case CallStatus::Disconnected:
+			metrics.disconnected->Add();
+			break;
+		}
+
+		call.handle.resume();
+	}
+
+public:
+	IntraCallManager() {}
+	NONCOPYABLE(IntraCallManager)
+
+	// co_await manager.Call<Response>(session, request, timeout)
+	template <NetworkPacketConcept Response, NetworkPacketConcept Request>
+	async_simple::coro::Lazy<CallResult<Response>> Call(SocketSessionPtr session, Request request, const utility::Milliseconds timeout)
+	{
+		utility::Milliseconds start_time = utility::CoarseTick<utility::Milliseconds>();
+
+		CallResult<Response> result = co_await CallAwaiter<Response, Request>(this, session, request, timeout);
+		result.latency = utility::CoarseTick<utility::Milliseconds>() - start_time;
+
+		co_return result;
+	}
+
+	// response of correlated request, correlation id is taken from request header
+	template <NetworkPacketConcept Response>
+	static void Reply(const SocketSessionPtr& session, const PacketHeader& request_header, const Response& response, const ErrorCode error = ErrorCode::None)
+	{
+		session->Send(response, error, false, ToResponseCorrelationId(request_header.correlation_id));
+	}
+
+	// start coroutine on current thread, it runs until first suspension
+	static void Spawn(async_simple::coro::Lazy<void>&& task)
+	{
+		std::move(task).start([](async_simple::Try<void>&& result) {
+			if (result.hasError())
+				LOG(LogLevel::Error, "intra call coroutine is terminated by exception");
+		});
+	}
+
+	// true if header is response of pending call
+	// late response of timed out call is dispatched as a normal packet, so its handler can undo the remote side effect
+	bool OnResponse(const PacketHeader& header, const uint8_t* const body)
+	{
+		if (!IsCorrelatedResponse(header))
+			return false;
+
+		uint32_t correlation_id = header.correlation_id & ~CORRELATION_RESPONSE_BIT;
+
+		if (!_pending_calls.contains(correlation_id))
+		{
+			LOG(LogLevel::Warn, "response of unknown call %u, timeout or duplicated", correlation_id);
+			return false;
+		}
+
+		Complete(correlation_id, CallStatus::Success, &header, body);
+
+		return true;
+	}
+
+	void OnSessionClosed(const uint64_t session_id)
+	{
+		std::vector<uint32_t> closed_calls;
+
+		for (const auto& pair : _pending_calls)
+		{
+			if (pair.second.session_id == session_id)
+				closed_calls.push_back(pair.first);
+		}
+
+		for (const uint32_t correlation_id : closed_calls)
+			Complete(correlation_id, CallStatus::Disconnected, nullptr, nullptr);
+	}
+
+	void Update(const utility::Milliseconds current_time)
+	{
+		while (!_deadlines.empty() && _deadlines.begin()->first <= current_time)
+			Complete(_deadlines.begin()->second, CallStatus::Timeout, nullptr, nullptr);
+	}
+
+	uint64_t PendingCallCount() const
+	{
+		return _pending_calls.size();
+	}
+};
@@ -0,0 +1,65 @@
+#include "MetricsServer.h"
+#include "../utility/Metrics.h"
+#include "../utility/Logger.h"
+#include "../utility/Profiler.h"
+#include <charconv>
+#include <ylt/coro_http/coro_http_server.hpp>
+
+bool MetricsServer::Start(const uint16_t port)
+{
+	if (_server != nullptr)
+		return false;
+
+	_server = new cinatra::coro_http_server(1, port);
+
+	_server->set_http_handler<cinatra::GET>("/metrics", [](cinatra::coro_http_request& request, cinatra::coro_http_response& response) {
+		response.add_header("Content-Type", "text/plain; version=0.0.4");
+		response.set_status_and_content(cinatra::status_type::ok, utility::MetricRegistry::GetInstance()->Serialize());
+	});
+
+	_server->set_http_handler<cinatra::GET>("/trace", [](cinatra::coro_http_request& request, cinatra::coro_http_response& response) {
+		constexpr uint32_t default_seconds = 5;
+		constexpr uint32_t max_seconds = 60;
+
+		std::string_view value = request.get_query_value("seconds");
+
+		uint32_t seconds = default_seconds;
+		if (std::from_chars(value.data(), value.data() + value.size(), seconds).ec != std::errc{} || seconds == 0)
+			seconds = default_seconds;
+
+		seconds = std::min(seconds, max_seconds);
+
+		response.add_header("Content-Type", "application/json");
+		response.set_status_and_content(cinatra::status_type::ok, utility::Profiler::GetInstance()->ExportChromeTrace(utility::Seconds(seconds)));
+	});
+
+	// listen error is set synchronously, otherwise result arrives when server stops
+	async_simple::Future<std::errc> result = _server->async_start();
+	if (result.hasResult() && result.value() != std::errc{})
+	{
+		LOG(LogLevel::Error, "failed to listen metrics port %u", static_cast<uint32_t>(port));
+
+		delete _server;
+		_server = nullptr;
+
+		return false;
+	}
+
+	return true;
+}
+
+void MetricsServer::Stop()
+{
+	if (_server == nullptr)
+		return;
+
+	_server->stop();
+
+	delete _server;
+	_server = nullptr;
+}
+
+MetricsServer::~MetricsServer()
+{
+	Stop();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../common.h"
+#include <cstdint>
+
+namespace cinatra
+{
+	class coro_http_server;
+}
+
+// admin endpoint
+// GET /metrics: MetricRegistry as prometheus text
+// GET /trace?seconds=N: profiler zones of last N seconds as chrome trace json, build with USE_PROFILER
+class MetricsServer
+{
+private:
+	cinatra::coro_http_server* _server = nullptr;
+
+public:
+	MetricsServer() {}
+	NONCOPYABLE(MetricsServer)
+
+	// listens on every interface with own io thread, keep port behind firewall
+	bool Start(const uint16_t port);
+	void Stop();
+
+	~MetricsServer();
+};
@@ -28,4 +28,7 @@ struct NetworkContext
 	NetworkSubject network_subject;
 	ContextType context_type;
 	uint16_t last_error_code;
+
+	// truncated microsecond tick of submission to worker, for sojourn time
+	uint32_t submit_time_us;
 };
\ No newline at end of file
@@ -1,8 +1,14 @@
 #include "NetworkEngine.h"
 #include "protocol/Protocol.h"
+#include "protocol/PacketRegistry.h"
 #include "SocketContext.h"
+#include "EngineMetrics.h"
+#include "../utility/Defer.h"
 #include "../utility/Time.h"
 #include "../utility/Logger.h"
+#include "../utility/Profiler.h"
+#include "../utility/Trace.h"
+#include "../memory/PoolWarmer.h"
 
 enum class StreamType : uint8_t
 {
@@ -20,6 +26,10 @@ struct SocketStreamExtension
 
 	StreamType stream_type;
 	bool graceful_shutdown_flag = false;
+
+	// entries of worker registries, removed by handle on disconnect
+	utility::SlotHandle socket_handle;
+	utility::SlotHandle session_handle;
 };
 
 void SocketSessionInitializer::Initialize(SocketSession* const session, const uint64_t id, const uint64_t param)
@@ -32,19 +42,90 @@ void SocketSessionInitializer::Initialize(SocketSession* const session, const ui
 
 bool NetworkEngine::Initialize(const NetworkEngineOption& option, SocketServer* const socket_server, NetworkEngineWorker* const worker)
 {
-	assert(sizeof(SocketContext) <= sizeof(SocketBuffer::reserved));
+	return Initialize(option, socket_server, std::vector<NetworkEngineWorker*>{ worker });
+}
+
+bool NetworkEngine::Initialize(const NetworkEngineOption& option, SocketServer* const socket_server, const std::vector<NetworkEngineWorker*>& workers)
+{
+	if (workers.empty())
+		return false;
+
+	// every fixed layout packet must fit in one buffer
+	if (socket_server->GetServerConfig().read_buffer_capacity < MAX_FIXED_PACKET_FRAME_SIZE || socket_server->GetServerConfig().write_buffer_capacity < MAX_FIXED_PACKET_FRAME_SIZE)
+	{
+		LOG(LogLevel::Error, "socket buffer capacity must be larger than %u bytes", MAX_FIXED_PACKET_FRAME_SIZE);
+		return false;
+	}
 
 	for (uint64_t index = 0; index < socket_server->GetServerConfig().worker_count; index++)
 	{
-		_worker_infos.push_back(new SocketWorkerInfo());
+		SocketWorkerInfo* worker_info = new SocketWorkerInfo();
+		worker_info->_context_pool = new SocketContextPool(SOCKET_CONTEXT_POOL_SIZE, SOCKET_CONTEXT_CHUNK_SIZE, 0, 1, SOCKET_CONTEXT_CHUNK_SIZE);
+		PoolWarmer::GetInstance()->Register(worker_info->_context_pool);
+
+		_worker_infos.push_back(worker_info);
 	}
 	socket_server->SetSocketEventHandler(this);
 
-	_socket_session_pool = new SocketSessionPool(option.max_session_count, 64, reinterpret_cast<uint64_t>(this));
+	_socket_session_pool = new SocketSessionPool(option.max_session_count, 64, reinterpret_cast<uint64_t>(this), 1, 64);
+	PoolWarmer::GetInstance()->Register(_socket_session_pool);
+
+	if (option.use_producer_lane)
+	{
+		for (NetworkEngineWorker* const worker : workers)
+		{
+			std::vector<uint32_t>& lanes = _worker_lanes.emplace_back();
+
+			for (uint64_t index = 0; index < socket_server->GetServerConfig().worker_count; index++)
+			{
+				uint32_t lane_index = worker->RegisterProducerLane(option.producer_lane_capacity, option.producer_lane_max_capacity);
+				if (lane_index == UINT32_MAX)
+					break;
+
+				lanes.push_back(lane_index);
+			}
+
+			if (lanes.size() != socket_server->GetServerConfig().worker_count)
+			{
+				LOG(LogLevel::Warn, "no more producer lane in worker, fallback to shared queue");
+				_worker_lanes.clear();
+				break;
+			}
+		}
+
+		// sampled on scrape, workers are never destroyed so samplers keep raw pointers
+		static std::atomic<uint32_t> engine_sequence = 0;
+		uint32_t engine_index = engine_sequence.fetch_add(1, std::memory_order_relaxed);
+
+		utility::MetricRegistry* registry = utility::MetricRegistry::GetInstance();
+
+		for (std::size_t worker_index = 0; worker_index < _worker_lanes.size(); worker_index++)
+		{
+			NetworkEngineWorker* worker = workers[worker_index];
+
+			for (const uint32_t lane_index : _worker_lanes[worker_index])
+			{
+				std::string labels = "engine=\"" + std::to_string(engine_index) + "\",worker=\"" + std::to_string(worker_index) + "\",lane=\"" + std::to_string(lane_index) + "\"";
+
+				registry->SampledGauge("engine_producer_lane_size", "contexts queued in producer lane", labels, [worker, lane_index]() {
+					return static_cast<int64_t>(worker->GetProducerLaneStatistics(lane_index).size);
+				});
+				registry->SampledGauge("engine_producer_lane_capacity", "ring capacity of producer lane", labels, [worker, lane_index]() {
+					return static_cast<int64_t>(worker->GetProducerLaneStatistics(lane_index).capacity);
+				});
+				registry->SampledGauge("engine_producer_lane_high_water_mark", "largest size of producer lane", labels, [worker, lane_index]() {
+					return static_cast<int64_t>(worker->GetProducerLaneStatistics(lane_index).high_water_mark);
+				});
+				registry->SampledCounter("engine_producer_lane_full_total", "pushes which found producer lane at max capacity", labels, [worker, lane_index]() {
+					return worker->GetProducerLaneStatistics(lane_index).full_count;
+				});
+			}
+		}
+	}
 
 	_option = option;
 	_socket_server = socket_server;
-	_worker = worker;
+	_workers = workers;
 
 	return true;
 }
@@ -53,18 +134,38 @@ int NetworkEngine::Start()
 {
 	int result = _socket_server->Start();
 	if (result == 0)
-		_worker->Start(utility::Milliseconds(_option.worker_update_tick_ms));
+	{
+		for (NetworkEngineWorker* const worker : _workers)
+			worker->Start(utility::Milliseconds(_option.worker_update_tick_ms), utility::Microseconds(_option.worker_context_budget_us), _option.worker_max_catch_up_ticks);
+	}
 
 	return result;
 }
 
-void NetworkEngine::SendSocketContext(const DynamicBufferCursor<SocketBuffer>& buffer, const ContextType& context_type, const PacketHeader& header, const SocketSessionPtr& session, const uint64_t attachment)
+bool NetworkEngine::SubmitContext(const uint32_t worker_index, SocketContext* const context)
+{
+	uint64_t shard_index = _workers.size() == 1 ? 0 : context->session->GetSessionId() % _workers.size();
+	NetworkEngineWorker* worker = _workers[shard_index];
+
+	// same clock as receive and dequeue times, coarse tick would skew sojourn and trace stages by its resolution
+	context->submit_time_us = utility::CurrentTraceTime();
+
+	if (_worker_lanes.empty())
+		return worker->Submit(context);
+
+	assert(worker_index < _worker_lanes[shard_index].size());
+
+	return worker->Submit(context, _worker_lanes[shard_index][worker_index]);
+}
+
+void NetworkEngine::SendSocketContext(const uint32_t worker_index, const DynamicBufferCursor<SocketBuffer>& buffer, const ContextType& context_type, const PacketHeader& header, const SocketSessionPtr& session, const uint64_t attachment)
 {
-	SocketContext* context = PrepareSocketContext(buffer, context_type, header, session, attachment);
-	if (!_worker->Submit(context))
+	SocketContext* context = PrepareSocketContext(worker_index, buffer, context_type, header, session, attachment);
+	if (!SubmitContext(worker_index, context))
 	{
 		LOG(LogLevel::Error, "worker queue is full, reduce load to disconnect this session %llu", session->GetSessionId());
 		
+		DiscardSocketContexts(context);
 		buffer->ReleaseN(buffer->Ref());
 		session->ReleaseReadBuffer(buffer);
 		session->Send(packet_server_is_busy_ps{}, ErrorCode::None, true);
@@ -72,15 +173,9 @@ void NetworkEngine::SendSocketContext(const DynamicBufferCursor<SocketBuffer>& b
 	}
 }
 
-SocketContext* NetworkEngine::PrepareSocketContext(const DynamicBufferCursor<SocketBuffer>& buffer, const ContextType& context_type, const PacketHeader& header, const SocketSessionPtr& session, const uint64_t attachment, uint32_t context_sequence)
+SocketContext* NetworkEngine::PrepareSocketContext(const uint32_t worker_index, const DynamicBufferCursor<SocketBuffer>& buffer, const ContextType& context_type, const PacketHeader& header, const SocketSessionPtr& session, const uint64_t attachment)
 {
-	// reserved  ּ SocketContext 1   ־
-	assert(sizeof(SocketBuffer::reserved) >= sizeof(SocketContext));
-
-	if (sizeof(SocketContext) * (context_sequence + 1) > sizeof(SocketBuffer::reserved))
-		return nullptr;
-
-	SocketContext* context = reinterpret_cast<SocketContext*>(static_cast<SocketBuffer*>(buffer)->reserved.data()) + context_sequence;
+	SocketContext* context = GetWorkerInfo(worker_index)->_context_pool->Pop(true);
 	context->network_subject = NetworkSubject::Socket;
 	context->context_type = context_type;
 	context->header = header;
@@ -89,11 +184,28 @@ SocketContext* NetworkEngine::PrepareSocketContext(const DynamicBufferCursor<Soc
 	context->buffer = buffer;
 	context->next = nullptr;
 
+	// frames inside batch and chunk are not known to be traced until worker unpacks them
+	bool may_be_traced = header.trace_id != 0 || header.packet_type == PacketType::packet_compressed_batch_ps || header.packet_type == PacketType::packet_chunk_ps;
+	context->receive_time_us = may_be_traced ? utility::CurrentTraceTime() : 0;
+
 	buffer->Retain();
 
 	return context;
 }
 
+void NetworkEngine::DiscardSocketContexts(SocketContext* context)
+{
+	while (context != nullptr)
+	{
+		SocketContext* next_context = static_cast<SocketContext*>(context->next);
+
+		context->session.Release();
+		SocketContextPool::PushDirect(context);
+
+		context = next_context;
+	}
+}
+
 uint64_t NetworkEngine::RegisterConnectorSocket(const SocketAddress& remote_address, const uint64_t attachment)
 {
 	ConnectorInfo connector_info;
@@ -126,8 +238,6 @@ void NetworkEngine::OnAccept(const TransferStreamPtr& stream)
 {
 	SocketWorkerInfo* worker_info = GetWorkerInfo(stream);
 
-	worker_info->_activated_sockets[stream->GetId()] = stream;
-
 	SocketStreamExtension* extension_info = reinterpret_cast<SocketStreamExtension*>(stream->GetUserData());
 	if (extension_info == nullptr)
 	{
@@ -135,6 +245,8 @@ void NetworkEngine::OnAccept(const TransferStreamPtr& stream)
 		stream->SetUserData(reinterpret_cast<uint64_t>(extension_info));
 	}
 
+	extension_info->socket_handle = worker_info->_activated_sockets.Emplace(stream);
+
 	extension_info->session.Release();
 	extension_info->stream_type = StreamType::Acceptor;
 	extension_info->connection_created_time = utility::CurrentTick();
@@ -164,8 +276,6 @@ void NetworkEngine::OnConnect(const TransferStreamPtr& stream, const uint64_t at
 
 	SocketWorkerInfo* worker_info = GetWorkerInfo(stream);
 
-	worker_info->_activated_sockets[stream->GetId()] = stream;
-
 	SocketStreamExtension* extension_info = reinterpret_cast<SocketStreamExtension*>(stream->GetUserData());
 	if (extension_info == nullptr)
 	{
@@ -173,6 +283,8 @@ void NetworkEngine::OnConnect(const TransferStreamPtr& stream, const uint64_t at
 		stream->SetUserData(reinterpret_cast<uint64_t>(extension_info));
 	}
 
+	extension_info->socket_handle = worker_info->_activated_sockets.Emplace(stream);
+
 	if (!valid_connector)
 	{
 		stream->TransmitDisconnect(attachment);
@@ -205,6 +317,7 @@ void NetworkEngine::OnConnect(const TransferStreamPtr& stream, const uint64_t at
 	{
 		// ű session  û
 		packet_session_create_rq packet;
+		packet.use_compression = _option.use_link_compression;
 
 		SerializePacket(packet, ErrorCode::None, buffer->ptr, buffer->capacity, buffer->length);
 
@@ -246,9 +359,15 @@ ContextType NetworkEngine::ProcessSessionPacket(const TransferStreamPtr& stream,
 		session->ResetSessionKey();
 		session->ResetSocketStream(stream);
 
+		// compression is used only if both sides enabled it
+		bool use_compression = _option.use_link_compression && packet.use_compression;
+		session->SetCompressionThreshold(use_compression ? _option.link_compression_threshold : 0);
+		session->SetTraceSampleInterval(_option.trace_sample_interval);
+
 		packet_session_create_rs response;
 		response.session_id = session->GetSessionId();
 		response.session_key = session->GetSessionKey()._buffer;
+		response.use_compression = use_compression;
 
 		SocketBuffer* new_buffer = stream->AllocateWriteBuffer();
 
@@ -285,6 +404,8 @@ ContextType NetworkEngine::ProcessSessionPacket(const TransferStreamPtr& stream,
 
 		session->ResetSessionKey(packet.session_key);
 		session->ResetSocketStream(stream);
+		session->SetCompressionThreshold(packet.use_compression && _option.use_link_compression ? _option.link_compression_threshold : 0);
+		session->SetTraceSampleInterval(_option.trace_sample_interval);
 
 		if (_option.use_session_reconnect)
 		{
@@ -359,7 +480,7 @@ ContextType NetworkEngine::ProcessSessionPacket(const TransferStreamPtr& stream,
 				success = _abandoned_session_list.Remove(connector_info->session_id, session);
 				if (success)
 				{
-					SendSocketContext(buffer, ContextType::SessionClosed, header, session, 0);
+					SendSocketContext(stream->GetWorkerIndex(), buffer, ContextType::SessionClosed, header, session, 0);
 					session.Release();
 				}
 
@@ -368,6 +489,7 @@ ContextType NetworkEngine::ProcessSessionPacket(const TransferStreamPtr& stream,
 
 				// ű session  û
 				packet_session_create_rq packet;
+				packet.use_compression = _option.use_link_compression;
 
 				SerializePacket(packet, ErrorCode::None, buffer->ptr, buffer->capacity, buffer->length);
 
@@ -389,6 +511,7 @@ ContextType NetworkEngine::ProcessSessionPacket(const TransferStreamPtr& stream,
 
 			// ű session  û
 			packet_session_create_rq packet;
+			packet.use_compression = _option.use_link_compression;
 
 			SerializePacket(packet, ErrorCode::None, buffer->ptr, buffer->capacity, buffer->length);
 
@@ -408,7 +531,8 @@ ContextType NetworkEngine::ProcessSessionPacket(const TransferStreamPtr& stream,
 		return context_type;
 	}
 
-	worker_info->_opened_sessions[session->GetSessionId()] = session;
+	worker_info->_opened_sessions.Erase(extension_info->session_handle);
+	extension_info->session_handle = worker_info->_opened_sessions.Emplace(session);
 
 	session->UpdateHeartbeatSendingTime(utility::CurrentTick<utility::Milliseconds>());
 	session->UpdateHeartbeatReceivingTime(utility::CurrentTick<utility::Milliseconds>());
@@ -420,31 +544,46 @@ ContextType NetworkEngine::ProcessSessionPacket(const TransferStreamPtr& stream,
 
 void NetworkEngine::OnRead(const TransferStreamPtr stream, SocketBuffer* const buffer, const uint64_t attachment)
 {
+	PROFILE_ZONE("NetworkEngine::OnRead");
+
 	SocketWorkerInfo* worker_info = GetWorkerInfo(stream);
 	SocketStreamExtension* extension_info = reinterpret_cast<SocketStreamExtension*>(stream->GetUserData());
 
-	SocketContext* first_context = reinterpret_cast<SocketContext*>(buffer->reserved.data());
+	SocketContext* first_context = nullptr;
 	SocketContext* last_context = nullptr;
 
 	DynamicBufferCursor<SocketBuffer> buffer_cursor(buffer);
 
-	uint32_t context_sequence = 0;
+	uint64_t read_bytes = 0;
+	uint64_t read_packets = 0;
 
-	while (buffer_cursor.RemainBytes() > PACKET_LENGTH_SIZE)
-	{
-		PacketLengthType packet_length;
-		std::memcpy(&packet_length, buffer_cursor.Data(), PACKET_LENGTH_SIZE);
+	DEFER({
+		EngineMetrics::ReadBytes()->Add(read_bytes);
+		EngineMetrics::ReadPackets()->Add(read_packets);
+	});
 
-		if (buffer_cursor.RemainBytes() - PACKET_LENGTH_SIZE < packet_length)
-			break;
-		
-		buffer_cursor.Seek(PACKET_LENGTH_SIZE);
+	// contexts come from slab of this io worker, so a buffer delivers any number of packets in one chain
+	auto chain_context = [&](SocketContext* const context) {
+		if (last_context == nullptr)
+			first_context = context;
+		else
+			last_context->next = context;
+
+		last_context = context;
+	};
+
+	while (true)
+	{
+		PacketHeader header;
 
-		PacketHeader header = DeserializePacketHeader(buffer_cursor.Data(), PACKET_HEADER_SIZE);
+		// body and optional extensions
+		uint32_t payload_size = 0;
 
-		buffer_cursor.Seek(PACKET_HEADER_SIZE);
+		PacketFrameResult frame_result = ReadPacketFrame(buffer_cursor, header, payload_size);
+		if (frame_result == PacketFrameResult::Incomplete)
+			break;
 
-		if (buffer_cursor.RemainBytes() < header.body_size)
+		if (frame_result == PacketFrameResult::Corrupted)
 		{
 			LOG(LogLevel::Warn, "packet header size mismatch %s:%d, %u", stream->GetSocketAddress().ip.data(), stream->GetSocketAddress().port, stream->GetId());
 
@@ -453,12 +592,16 @@ void NetworkEngine::OnRead(const TransferStreamPtr stream, SocketBuffer* const b
 			else
 				stream->TransmitDisconnect(GRACEFUL_SHUTDOWN_CODE);
 
+			DiscardSocketContexts(first_context);
 			buffer_cursor->ReleaseN(buffer_cursor->Ref());
 			stream->ReleaseReadBuffer(buffer_cursor);
 
 			return;
 		}
 
+		read_bytes += PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE + payload_size;
+		read_packets++;
+
 		if (!extension_info->session.Valid())
 		{
 			ConnectorInfo connector_info;
@@ -467,50 +610,42 @@ void NetworkEngine::OnRead(const TransferStreamPtr stream, SocketBuffer* const b
 			if (session_context == ContextType::SessionError)
 			{
 				LOG(LogLevel::Warn, "failed to authorize session %s:%d, %u", stream->GetSocketAddress().ip.data(), stream->GetSocketAddress().port, stream->GetId());
-				buffer_cursor.Seek(header.body_size);
+				buffer_cursor.Seek(payload_size);
 				continue;
 			}
 
-			last_context = PrepareSocketContext(buffer_cursor, session_context, header, extension_info->session, connector_info.attachment, context_sequence++);
-			if (last_context == nullptr)
-			{
-				LOG(LogLevel::Warn, "cannot create socket context %s:%d, %u", stream->GetSocketAddress().ip.data(), stream->GetSocketAddress().port, stream->GetId());
-
-				stream->TransmitDisconnect(GRACEFUL_SHUTDOWN_CODE);
-				stream->ReleaseReadBuffer(buffer_cursor);
-
-				return;
-			}
+			chain_context(PrepareSocketContext(stream->GetWorkerIndex(), buffer_cursor, session_context, header, extension_info->session, connector_info.attachment));
 
-			buffer_cursor.Seek(header.body_size);
+			buffer_cursor.Seek(payload_size);
 
 			continue;
 		}
 
 		if (header.packet_type == PacketType::packet_heartbeat_rq)
 		{
-			utility::Milliseconds now = utility::CurrentTick<utility::Milliseconds>();
+			utility::Milliseconds now = utility::CoarseTick<utility::Milliseconds>();
 
 			extension_info->session->UpdateHeartbeatReceivingTime(now);
 			
 			extension_info->session->Send(packet_heartbeat_rs{});
 			
-			buffer_cursor.Seek(header.body_size);
+			buffer_cursor.Seek(payload_size);
 
 			continue;
 		}
 		else if (header.packet_type == PacketType::packet_heartbeat_rs)
 		{
-			utility::Milliseconds now = utility::CurrentTick<utility::Milliseconds>();
+			utility::Milliseconds now = utility::CoarseTick<utility::Milliseconds>();
 			extension_info->session->UpdateHeartbeatReceivingTime(now);
 
-			buffer_cursor.Seek(header.body_size);
+			buffer_cursor.Seek(payload_size);
 
 			continue;
 		}
 		else if (header.packet_type == PacketType::packet_session_create_rq || header.packet_type == PacketType::packet_session_create_rs)
 		{
 			extension_info->session->CloseSession();
+			DiscardSocketContexts(first_context);
 			stream->ReleaseReadBuffer(buffer_cursor);
 
 			return;
@@ -518,52 +653,27 @@ void NetworkEngine::OnRead(const TransferStreamPtr stream, SocketBuffer* const b
 		else if (header.packet_type == PacketType::packet_session_close_rq)
 		{
 			extension_info->session->CloseSession();
+			DiscardSocketContexts(first_context);
 			stream->ReleaseReadBuffer(buffer_cursor);
 
 			return;
 		}
-
-		SocketContext* current_context = PrepareSocketContext(buffer_cursor, ContextType::SessionData, header, extension_info->session, attachment, context_sequence);
-		
-		if (current_context == nullptr)
+		else if (header.packet_type == PacketType::packet_chunk_ps && !_option.accept_packet_chunk)
 		{
-			SocketBuffer* new_buffer = extension_info->session->TryAllocateReadBuffer();
-			if (new_buffer == nullptr)
-			{
-				stream->ReleaseReadBuffer(buffer_cursor);
-				return;
-			}
-
-			new_buffer->length = buffer_cursor.RemainBytes();
-			std::memcpy(new_buffer->ptr, buffer_cursor.Data(), new_buffer->length);
-
-			if (!_worker->Submit(first_context))
-			{
-				LOG(LogLevel::Error, "worker queue is full, reduce load to disconnect this socket %s:%d, %u", stream->GetSocketAddress().ip.data(), stream->GetSocketAddress().port, stream->GetId());
-				
-				extension_info->session->CloseSession();
-
-				stream->ReleaseReadBuffer(buffer_cursor);
-				stream->ReleaseReadBuffer(new_buffer);
-				return;
-			}
+			LOG(LogLevel::Warn, "packet chunk on link which does not accept it, session %llu", extension_info->session->GetSessionId());
 
-			context_sequence = 0;
-
-			first_context = reinterpret_cast<SocketContext*>(new_buffer->reserved.data());
-			last_context = nullptr;
-			buffer_cursor = DynamicBufferCursor<SocketBuffer>(new_buffer);
+			extension_info->session->CloseSession();
+			DiscardSocketContexts(first_context);
+			stream->ReleaseReadBuffer(buffer_cursor);
 
-			current_context = PrepareSocketContext(buffer_cursor, ContextType::SessionData, header, extension_info->session, attachment, context_sequence);
+			return;
 		}
 
-		if (last_context != nullptr)
-			last_context->next = current_context;
+		SamplePacketTrace(header, _option.trace_sample_interval);
 
-		last_context = current_context;
+		chain_context(PrepareSocketContext(stream->GetWorkerIndex(), buffer_cursor, ContextType::SessionData, header, extension_info->session, attachment));
 
-		buffer_cursor.Seek(header.body_size);
-		context_sequence++;
+		buffer_cursor.Seek(payload_size);
 	}
 
 	// Ŷ      Ȱ
@@ -574,6 +684,7 @@ void NetworkEngine::OnRead(const TransferStreamPtr stream, SocketBuffer* const b
 		SocketBuffer* new_buffer = extension_info->session->TryAllocateReadBuffer();
 		if (new_buffer == nullptr)
 		{
+			DiscardSocketContexts(first_context);
 			stream->ReleaseReadBuffer(buffer_cursor);
 			return;
 		}
@@ -586,10 +697,11 @@ void NetworkEngine::OnRead(const TransferStreamPtr stream, SocketBuffer* const b
 
 		if (last_context != nullptr)
 		{
-			if (!_worker->Submit(first_context))
+			if (!SubmitContext(stream->GetWorkerIndex(), first_context))
 			{
 				LOG(LogLevel::Error, "worker queue is full, reduce load to disconnect this socket %s:%d, %u", stream->GetSocketAddress().ip.data(), stream->GetSocketAddress().port, stream->GetId());
 				
+				DiscardSocketContexts(first_context);
 				stream->ReleaseReadBuffer(buffer_cursor);
 				stream->ReleaseReadBuffer(new_buffer);
 
@@ -619,7 +731,8 @@ void NetworkEngine::OnDisconnect(const TransferStreamPtr& stream, const uint64_t
 
 	ContextType context_type = ContextType::SessionClosed;
 
-	worker_info->_activated_sockets.erase(stream->GetId());
+	worker_info->_activated_sockets.Erase(extension_info->socket_handle);
+	extension_info->socket_handle = {};
 
 	LOG(LogLevel::Info, "socket disconnect %s:%d, %llu", stream->GetSocketAddress().ip.data(), stream->GetSocketAddress().port, stream->GetId());
 
@@ -662,30 +775,33 @@ void NetworkEngine::OnDisconnect(const TransferStreamPtr& stream, const uint64_t
 
 	SocketBuffer* buffer = stream->AllocateReadBuffer(true);
 
-	worker_info->_opened_sessions.erase(extension_info->session->GetSessionId());
+	// stale when OnTick already closed it as idle
+	worker_info->_opened_sessions.Erase(extension_info->session_handle);
+	extension_info->session_handle = {};
 	
-	SendSocketContext(buffer, context_type, {}, extension_info->session, 0);
+	SendSocketContext(stream->GetWorkerIndex(), buffer, context_type, {}, extension_info->session, 0);
 
 	extension_info->connector_id = 0;
 	extension_info->session.Release();
 }
 
 thread_local std::vector<uint64_t> deleted_session;
+thread_local std::vector<utility::SlotHandle> closed_session_handles;
 
 void NetworkEngine::OnTick(const uint32_t worker_index)
 {
 	SocketWorkerInfo* worker_info = GetWorkerInfo(worker_index);
 
-	utility::Nanoseconds now = utility::CurrentTick();
+	utility::Nanoseconds now = utility::CoarseClock::Tick();
 
-	for (const auto& pair : worker_info->_activated_sockets)
+	for (const TransferStreamPtr& stream : worker_info->_activated_sockets)
 	{
-		SocketStreamExtension* extension_info = reinterpret_cast<SocketStreamExtension*>(pair.second->GetUserData());
+		SocketStreamExtension* extension_info = reinterpret_cast<SocketStreamExtension*>(stream->GetUserData());
 		if (!extension_info->session.Valid() && now >= extension_info->connection_created_time + utility::Milliseconds(_option.socket_idle_timeout_ms))
 		{
-			LOG(LogLevel::Info, "close idle socket %u", pair.first);
+			LOG(LogLevel::Info, "close idle socket %u", stream->GetId());
 			// idle socket timeout
-			pair.second->TransmitDisconnect(GRACEFUL_SHUTDOWN_CODE);
+			stream->TransmitDisconnect(GRACEFUL_SHUTDOWN_CODE);
 		}
 
 		if (extension_info->session.Valid() && extension_info->stream_type == StreamType::Acceptor)
@@ -695,31 +811,32 @@ void NetworkEngine::OnTick(const uint32_t worker_index)
 				packet_heartbeat_rq packet;
 				packet.ping = extension_info->ping_ms;
 
-				SocketBuffer* buffer = pair.second->AllocateWriteBuffer(true);
+				SocketBuffer* buffer = stream->AllocateWriteBuffer(true);
 
 				SerializePacket(packet, ErrorCode::None, buffer->ptr, buffer->capacity, buffer->length);
 
-				pair.second->TransmitWrite(buffer, 0, 0);
+				stream->TransmitWrite(buffer, 0, 0);
 
 				extension_info->session->UpdateHeartbeatSendingTime(utility::TimeCast<utility::Milliseconds>(now));
 			}
 		}
 	}
 
-	for (const auto& pair : worker_info->_opened_sessions)
+	for (std::size_t index = 0; index < worker_info->_opened_sessions.Size(); index++)
 	{
-		if (now >= pair.second->GetLastHeartbeatReceivingTime() + utility::Milliseconds(_option.session_idle_timeout_ms))
+		const SocketSessionPtr& session = worker_info->_opened_sessions[index];
+		if (now >= session->GetLastHeartbeatReceivingTime() + utility::Milliseconds(_option.session_idle_timeout_ms))
 		{
-			LOG(LogLevel::Info, "close idle session %u", pair.first);
-			deleted_session.push_back(pair.first);
-			pair.second->CloseSession();
+			LOG(LogLevel::Info, "close idle session %u", session->GetSessionId());
+			closed_session_handles.push_back(worker_info->_opened_sessions.HandleAt(index));
+			session->CloseSession();
 		}
 	}
 
-	for (uint64_t id : deleted_session)
-		worker_info->_opened_sessions.erase(id);
+	for (const utility::SlotHandle handle : closed_session_handles)
+		worker_info->_opened_sessions.Erase(handle);
 
-	deleted_session.clear();
+	closed_session_handles.clear();
 
 	for (const auto& pair : worker_info->_abandoned_sessions)
 	{
@@ -751,7 +868,7 @@ void NetworkEngine::OnTick(const uint32_t worker_index)
 			LOG(LogLevel::Info, "abandoned session timeout %d", pair.first);
 
 			// sesson reconnect timeout
-			SendSocketContext(session->_socket_stream->AllocateReadBuffer(true), ContextType::SessionClosed, {}, pair.second, 0);
+			SendSocketContext(worker_index, session->_socket_stream->AllocateReadBuffer(true), ContextType::SessionClosed, {}, pair.second, 0);
 		}
 	}
 	
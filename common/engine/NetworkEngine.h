@@ -24,10 +24,14 @@ private:
 	SocketSessionPool* _socket_session_pool;
 
 	SocketServer* _socket_server;
-	NetworkEngineWorker* _worker;
+	// session affinity, context of a session is always submitted to the same worker
+	std::vector<NetworkEngineWorker*> _workers;
 
 	std::vector<SocketWorkerInfo*> _worker_infos;
 
+	// producer lane index per [worker][io worker], empty if producer lane is not used
+	std::vector<std::vector<uint32_t>> _worker_lanes;
+
 	ConcurrentMap<uint64_t, SocketSessionPtr> _abandoned_session_list;
 	ConcurrentMap<uint64_t, ConnectorInfo> _connector_list;
 
@@ -48,14 +52,20 @@ private:
 	
 	ContextType ProcessSessionPacket(const TransferStreamPtr& stream, const PacketHeader& header, const DynamicBufferCursor<SocketBuffer>& buffer, ConnectorInfo* connector_info);
 
-	void SendSocketContext(const DynamicBufferCursor<SocketBuffer>& buffer, const ContextType& context_type, const PacketHeader& header, const SocketSessionPtr& session, const uint64_t attachment);
+	bool SubmitContext(const uint32_t worker_index, SocketContext* const context);
+
+	void SendSocketContext(const uint32_t worker_index, const DynamicBufferCursor<SocketBuffer>& buffer, const ContextType& context_type, const PacketHeader& header, const SocketSessionPtr& session, const uint64_t attachment);
+
+	SocketContext* PrepareSocketContext(const uint32_t worker_index, const DynamicBufferCursor<SocketBuffer>& buffer, const ContextType& context_type, const PacketHeader& header, const SocketSessionPtr& session, const uint64_t attachment);
 
-	SocketContext* PrepareSocketContext(const DynamicBufferCursor<SocketBuffer>& buffer, const ContextType& context_type, const PacketHeader& header, const SocketSessionPtr& session, const uint64_t attachment, uint32_t context_sequence = 0);
+	// returns chain which is not submitted to slab, buffer is released by caller
+	void DiscardSocketContexts(SocketContext* context);
 
 	friend SocketSessionInitializer;
 public:
 
 	bool Initialize(const NetworkEngineOption& option, SocketServer* const socket_server, NetworkEngineWorker* const worker);
+	bool Initialize(const NetworkEngineOption& option, SocketServer* const socket_server, const std::vector<NetworkEngineWorker*>& workers);
 
 	int Start();
 
@@ -2,21 +2,186 @@
 
 #include "../concurrent/LinearWorker.h"
 #include "../utility/Logger.h"
+#include "../utility/Profiler.h"
 #include "SocketContext.h"
+#include "EngineMetrics.h"
+#include "PacketTrace.h"
+#include "PacketChunkAssembler.h"
+#include "../utility/Compression.h"
+#include <vector>
 
 class NetworkEngine;
 
 class NetworkEngineWorker : public LinearWorker<NetworkContext*>
 {
+private:
+	// decompressed frames of current compressed batch, handlers see them as one read buffer
+	std::vector<uint8_t> _decompressed_batch;
+	SocketBuffer _decompressed_buffer{};
+
+	// chain being processed by UpdateContext, stages of traced packets
+	uint32_t _chain_submit_time_us = 0;
+	uint32_t _dequeue_time_us = 0;
+
+	// handler of traced packet runs inside trace scope, packets it sends carry same trace id
+	void DispatchSessionData(SocketContext* context)
+	{
+		if (context->header.trace_id == 0)
+		{
+			OnSocketSessionData(context);
+			return;
+		}
+
+		utility::TraceSpan span{ context->header.trace_id, context->header.trace_sent_us, context->receive_time_us, _chain_submit_time_us, _dequeue_time_us };
+		{
+			utility::TraceScope scope(span);
+			OnSocketSessionData(context);
+		}
+
+		RecordTraceSpan(span, "packet", static_cast<uint32_t>(context->header.packet_type));
+	}
+
+	// inner frames are dispatched with temporary context, it does not own buffer
+	void OnCompressedBatch(SocketContext* context)
+	{
+		const SocketSessionPtr& session = context->session;
+
+		utility::Nanoseconds begin = utility::FineTick();
+
+		// peer which did not negotiate compression must not send it
+		if (session->GetCompressionThreshold() == 0)
+		{
+			LOG(LogLevel::Warn, "compressed batch on uncompressed link, session %llu", session->GetSessionId());
+			session->CloseSession();
+			return;
+		}
+
+		uint32_t original_size = 0;
+		if (context->header.body_size <= COMPRESSED_BATCH_PREFIX_SIZE)
+		{
+			LOG(LogLevel::Warn, "compressed batch is too short, session %llu", session->GetSessionId());
+			session->CloseSession();
+			return;
+		}
+
+		std::memcpy(&original_size, context->buffer.Data(), COMPRESSED_BATCH_PREFIX_SIZE);
+		if (original_size == 0 || original_size > MAX_DECOMPRESSED_BATCH_SIZE)
+		{
+			LOG(LogLevel::Warn, "invalid compressed batch size %u, session %llu", original_size, session->GetSessionId());
+			session->CloseSession();
+			return;
+		}
+
+		if (_decompressed_batch.size() < original_size)
+		{
+			_decompressed_batch.resize(original_size);
+			_decompressed_buffer.ptr = _decompressed_batch.data();
+			*const_cast<unsigned int*>(&_decompressed_buffer.capacity) = static_cast<unsigned int>(_decompressed_batch.size());
+		}
+
+		uint32_t decompressed_size = utility::LzDecompress(context->buffer.Data() + COMPRESSED_BATCH_PREFIX_SIZE, context->header.body_size - COMPRESSED_BATCH_PREFIX_SIZE, _decompressed_buffer.ptr, original_size);
+		if (decompressed_size != original_size)
+		{
+			LOG(LogLevel::Warn, "corrupted compressed batch, session %llu", session->GetSessionId());
+			session->CloseSession();
+			return;
+		}
+
+		LinkCompressionStatistics& statistics = session->GetCompressionStatistics();
+		statistics.decompressed_batch_count.fetch_add(1, std::memory_order_relaxed);
+		statistics.decompress_time_ns.fetch_add((utility::FineTick() - begin).count(), std::memory_order_relaxed);
+
+		SocketContext frame_context{ { nullptr, NetworkSubject::Socket, ContextType::SessionData, 0 }, PacketHeader{}, DynamicBufferCursor<SocketBuffer>(&_decompressed_buffer), session, context->attachment, context->receive_time_us };
+
+		uint32_t offset = 0;
+		while (original_size - offset >= PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE)
+		{
+			PacketLengthType packet_length;
+			std::memcpy(&packet_length, _decompressed_buffer.ptr + offset, PACKET_LENGTH_SIZE);
+
+			PacketHeader header = DeserializePacketHeader(_decompressed_buffer.ptr + offset + PACKET_LENGTH_SIZE, PACKET_HEADER_SIZE);
+
+			if (packet_length < PACKET_HEADER_SIZE || original_size - offset - PACKET_LENGTH_SIZE < packet_length || packet_length - PACKET_HEADER_SIZE < header.body_size)
+				break;
+
+			uint32_t body_offset = offset + PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE;
+
+			if (!ReadPacketExtensions(header, _decompressed_buffer.ptr + body_offset + header.body_size, packet_length - PACKET_HEADER_SIZE - header.body_size))
+				break;
+
+			SamplePacketTrace(header, session->GetTraceSampleInterval());
+
+			// handler can not read beyond its own frame
+			_decompressed_buffer.length = body_offset + header.body_size;
+
+			frame_context.header = header;
+			frame_context.buffer = DynamicBufferCursor<SocketBuffer>(&_decompressed_buffer, static_cast<int32_t>(body_offset));
+
+			if (header.packet_type == PacketType::packet_chunk_ps)
+				OnPacketChunk(&frame_context);
+			else if (header.packet_type != PacketType::packet_compressed_batch_ps)
+				DispatchSessionData(&frame_context);
+			else
+				break;
+
+			offset += PACKET_LENGTH_SIZE + packet_length;
+		}
+
+		if (offset != original_size)
+		{
+			LOG(LogLevel::Warn, "compressed batch has broken frame, session %llu", session->GetSessionId());
+			session->CloseSession();
+		}
+	}
+
+	// reassembled packet is dispatched with temporary context, it does not own buffer
+	void OnPacketChunk(SocketContext* context)
+	{
+		PacketHeader header;
+		DynamicBufferCursor<SocketBuffer> message(nullptr);
+
+		switch (_chunk_assembler.Append(context->session->GetSessionId(), context->buffer.Data(), context->header.body_size, header, message))
+		{
+		case PacketChunkResult::Incomplete:
+			return;
+		case PacketChunkResult::Corrupted:
+			LOG(LogLevel::Warn, "corrupted packet chunk, session %llu", context->session->GetSessionId());
+			context->session->CloseSession();
+			return;
+		case PacketChunkResult::Completed:
+			break;
+		}
+
+		SamplePacketTrace(header, context->session->GetTraceSampleInterval());
+
+		SocketContext message_context{ { nullptr, NetworkSubject::Socket, ContextType::SessionData, 0 }, header, message, context->session, context->attachment, context->receive_time_us };
+
+		DispatchSessionData(&message_context);
+	}
+
+protected:
+	PacketChunkAssembler _chunk_assembler;
 
 public:
 	// virtual bool Update(const WorkerTimeUnit delta_time) override;
 	virtual void UpdateContext(const std::vector<NetworkContext*>& contexts, const WorkerTimeUnit current_time, const WorkerTimeUnit delta_time) override
 	{
+		PROFILE_ZONE("NetworkEngineWorker::UpdateContext");
+
+		uint32_t now_us = utility::CurrentTraceTime();
+		_dequeue_time_us = now_us;
+
 		for (NetworkContext* context : contexts)
 		{
+			// chain head carries submission time of whole chain
+			EngineMetrics::WorkerSojournTime()->Record(now_us - context->submit_time_us);
+			_chain_submit_time_us = context->submit_time_us;
+
 			while (context != nullptr)
 			{
+				// released context goes back to slab, read link first
+				NetworkContext* next_context = context->next;
+
 				switch (context->network_subject)
 				{
 				case NetworkSubject::Socket:
@@ -31,6 +196,7 @@ public:
 						OnSocketSessionConnected(socket_context);
 						break;
 					case ContextType::SessionAbandoned:
+						_chunk_assembler.Remove(socket_context->session->GetSessionId());
 						OnSocketSessionAbandoned(socket_context);
 						if (!socket_context->session->ChangeSessionState(SessionState::Abandoned, SessionState::Wait))
 							assert(false);
@@ -40,13 +206,20 @@ public:
 						OnSocketSessionAlived(socket_context);
 						break;
 					case ContextType::SessionClosed:
+						_chunk_assembler.Remove(socket_context->session->GetSessionId());
 						OnSocketSessionClosed(socket_context);
 						socket_context->Release();
 						context = nullptr;
 						continue;
 					case ContextType::SessionData:
 						assert(socket_context->session->GetSessionState() == SessionState::Opened);
-						OnSocketSessionData(socket_context);
+						if (socket_context->header.packet_type == PacketType::packet_compressed_batch_ps)
+							OnCompressedBatch(socket_context);
+						else if (socket_context->header.packet_type == PacketType::packet_chunk_ps)
+							OnPacketChunk(socket_context);
+						else
+							DispatchSessionData(socket_context);
+
 						break;
 					}
 
@@ -57,11 +230,18 @@ public:
 
 				}
 
-				context = context->next;
+				context = next_context;
 			}
 		}
 	}
 
+	virtual void OnTickDropped(const uint64_t dropped_tick_count) override
+	{
+		WorkerPhaseStatistics statistics = GetPhaseStatistics();
+
+		LOG(LogLevel::Warn, "worker is too late to catch up, %llu ticks are dropped, update: %llu us, context: %llu us", dropped_tick_count, statistics.last_update_time_us, statistics.last_context_time_us);
+	}
+
 	virtual void OnSocketSessionConnected(SocketContext* context) {}
 	virtual void OnSocketSessionAccepted(SocketContext* context) {}
 	virtual void OnSocketSessionAbandoned(SocketContext* context) {}
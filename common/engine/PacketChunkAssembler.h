@@ -0,0 +1,124 @@
+#pragma once
+
+#include "protocol/Protocol.h"
+#include "../network/Meta.h"
+#include "../memory/Buffer.h"
+#include <unordered_map>
+#include <vector>
+
+enum class PacketChunkResult : uint8_t
+{
+	Incomplete,
+	Completed,
+	Corrupted,
+};
+
+// "Thread Unsafe", one per network engine worker, session is always handled by same worker
+// reassembles packet_chunk_ps frames into original header + body
+class PacketChunkAssembler
+{
+private:
+	// in flight messages of one session, more than this is treated as corrupted
+	static constexpr uint32_t MAX_PENDING_MESSAGE_COUNT = 8;
+
+	// received bytes of incomplete messages of one session, more than this is treated as corrupted
+	static constexpr uint64_t MAX_PENDING_SESSION_BYTES = 2ull * MAX_CHUNKED_MESSAGE_SIZE;
+
+	struct PendingMessage
+	{
+		uint32_t message_size = 0;
+		std::vector<uint8_t> data;
+	};
+
+	struct PendingSession
+	{
+		// key: message id
+		std::unordered_map<uint32_t, PendingMessage> messages;
+		uint64_t pending_bytes = 0;
+	};
+
+	// key: session id
+	std::unordered_map<uint64_t, PendingSession> _pending_sessions;
+
+	// last completed message, valid until next Append
+	std::vector<uint8_t> _completed_message;
+	SocketBuffer _completed_buffer{};
+
+public:
+	PacketChunkAssembler() = default;
+	NONCOPYABLE(PacketChunkAssembler)
+
+	// on Completed, header and message cursor (at body) point to reassembled packet
+	PacketChunkResult Append(const uint64_t session_id, const uint8_t* const body, const uint32_t body_size, PacketHeader& header, DynamicBufferCursor<SocketBuffer>& message)
+	{
+		if (body_size <= PACKET_CHUNK_HEADER_SIZE)
+			return PacketChunkResult::Corrupted;
+
+		PacketChunkHeader chunk;
+		std::memcpy(&chunk, body, PACKET_CHUNK_HEADER_SIZE);
+
+		uint32_t payload_size = body_size - PACKET_CHUNK_HEADER_SIZE;
+
+		if (chunk.message_size <= PACKET_HEADER_SIZE || chunk.message_size > MAX_CHUNKED_MESSAGE_SIZE || payload_size > chunk.message_size - chunk.offset)
+			return PacketChunkResult::Corrupted;
+
+		PendingSession& session = _pending_sessions[session_id];
+
+		auto message_iterator = session.messages.find(chunk.message_id);
+		if (message_iterator == session.messages.end())
+		{
+			if (chunk.offset != 0 || session.messages.size() >= MAX_PENDING_MESSAGE_COUNT)
+				return PacketChunkResult::Corrupted;
+
+			// declared size is not trusted, buffer grows only as chunks arrive
+			message_iterator = session.messages.try_emplace(chunk.message_id).first;
+			message_iterator->second.message_size = chunk.message_size;
+		}
+
+		PendingMessage& pending = message_iterator->second;
+
+		// chunks of one message are in order
+		if (chunk.offset != pending.data.size() || chunk.message_size != pending.message_size)
+			return PacketChunkResult::Corrupted;
+
+		if (session.pending_bytes + payload_size > MAX_PENDING_SESSION_BYTES)
+			return PacketChunkResult::Corrupted;
+
+		pending.data.insert(pending.data.end(), body + PACKET_CHUNK_HEADER_SIZE, body + body_size);
+		session.pending_bytes += payload_size;
+
+		if (pending.data.size() < pending.message_size)
+			return PacketChunkResult::Incomplete;
+
+		session.pending_bytes -= pending.data.size();
+
+		_completed_message.swap(pending.data);
+		session.messages.erase(message_iterator);
+
+		if (session.messages.empty())
+			_pending_sessions.erase(session_id);
+
+		header = DeserializePacketHeader(_completed_message.data(), _completed_message.size());
+
+		// chunk and compressed batch are never chunked
+		if (PACKET_HEADER_SIZE + header.body_size > _completed_message.size() || header.packet_type == PacketType::packet_chunk_ps || header.packet_type == PacketType::packet_compressed_batch_ps)
+			return PacketChunkResult::Corrupted;
+
+		uint32_t extension_offset = PACKET_HEADER_SIZE + header.body_size;
+		if (!ReadPacketExtensions(header, _completed_message.data() + extension_offset, _completed_message.size() - extension_offset))
+			return PacketChunkResult::Corrupted;
+
+		_completed_buffer.ptr = _completed_message.data();
+		*const_cast<unsigned int*>(&_completed_buffer.capacity) = static_cast<unsigned int>(_completed_message.size());
+		_completed_buffer.length = extension_offset;
+
+		message = DynamicBufferCursor<SocketBuffer>(&_completed_buffer, PACKET_HEADER_SIZE);
+
+		return PacketChunkResult::Completed;
+	}
+
+	void Remove(const uint64_t session_id)
+	{
+		_pending_sessions.erase(session_id);
+	}
+};
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "protocol/PacketRegistry.h"
+#include "../network/Meta.h"
+#include "../memory/Buffer.h"
+#include "../utility/Clock.h"
+#include "../utility/Metrics.h"
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+
+// per packet type, shared by every dispatcher
+struct PacketDispatchMetrics
+{
+	utility::MetricCounter* packets;
+
+	// length + header + body + extensions
+	utility::MetricCounter* bytes;
+
+	utility::MetricCounter* handler_time_ns;
+};
+
+// registered on first dispatch of the type, instruments of packet types never received are not exported
+inline const PacketDispatchMetrics* GetPacketDispatchMetrics(const PacketType packet_type)
+{
+	static std::array<std::atomic<const PacketDispatchMetrics*>, PACKET_TYPE_COUNT> metrics{};
+
+	std::atomic<const PacketDispatchMetrics*>& slot = metrics[static_cast<std::size_t>(packet_type)];
+
+	const PacketDispatchMetrics* current = slot.load(std::memory_order_acquire);
+	if (current != nullptr)
+		return current;
+
+	// racing threads get same instruments from registry, loser frees its holder only
+	utility::MetricRegistry* registry = utility::MetricRegistry::GetInstance();
+	std::string labels = "packet=\"" + std::string(GetPacketTraits(packet_type).name) + "\"";
+
+	const PacketDispatchMetrics* created = new PacketDispatchMetrics{
+		registry->Counter("engine_dispatched_packets_total", "packets handled by registered handler", labels),
+		registry->Counter("engine_dispatched_bytes_total", "frame bytes of packets handled by registered handler", labels),
+		registry->Counter("engine_dispatch_handler_time_ns_total", "time spent in registered handler", labels),
+	};
+
+	if (slot.compare_exchange_strong(current, created, std::memory_order_acq_rel))
+		return created;
+
+	delete created;
+	return current;
+}
+
+enum class PacketDispatchResult : uint8_t
+{
+	Handled,
+	Unregistered,
+	Rejected,
+	DeserializeFailed,
+};
+
+// handler is a member function, its last parameter is the packet
+// void Handler(Session session, const PacketHeader& header, const T& packet) or void Handler(Session session, const T& packet)
+template <typename Handler>
+struct PacketHandlerTraits;
+
+template <typename Result, typename Target, typename... Args>
+struct PacketHandlerTraits<Result (Target::*)(Args...)>
+{
+	using TargetType = Target;
+	using Packet = std::remove_cvref_t<std::tuple_element_t<sizeof...(Args) - 1, std::tuple<Args...>>>;
+};
+
+// "Thread Safe" after registration, every handler must be registered before workers start
+// one table slot per PacketType, lookup and call do not pass through virtual function
+template <typename Session>
+class PacketDispatcher
+{
+private:
+	using Invoker = bool(*)(void* const target, Session session, const PacketHeader& header, const DynamicBufferCursor<SocketBuffer>& buffer);
+	using Guard = bool(*)(void* const target, Session session);
+
+	struct Entry
+	{
+		void* target = nullptr;
+		Invoker invoker = nullptr;
+	};
+
+	std::array<Entry, PACKET_TYPE_COUNT> _entries{};
+
+	void* _guard_target = nullptr;
+	Guard _guard = nullptr;
+
+	template <auto Handler, typename Target, typename T>
+	static void CallHandler(Target* const target, Session session, const PacketHeader& header, T& packet)
+	{
+		if constexpr (std::is_invocable_v<decltype(Handler), Target*, Session, const PacketHeader&, T&>)
+			std::invoke(Handler, target, session, header, packet);
+		else
+			std::invoke(Handler, target, session, packet);
+	}
+
+	// fixed layout packet is passed as in place view of receive buffer, its handler takes const reference
+	template <auto Handler>
+	static bool Invoke(void* const target, Session session, const PacketHeader& header, const DynamicBufferCursor<SocketBuffer>& buffer)
+	{
+		using Target = typename PacketHandlerTraits<decltype(Handler)>::TargetType;
+		using T = typename PacketHandlerTraits<decltype(Handler)>::Packet;
+
+		if constexpr (FixedLayoutPacketConcept<T>)
+		{
+			const T* packet = ViewPacketBody<T>(buffer.Data(), header.body_size);
+			if (packet == nullptr)
+				return false;
+
+			CallHandler<Handler>(static_cast<Target*>(target), session, header, *packet);
+		}
+		else
+		{
+			T packet;
+			if (!DeserializePacketBody(buffer.Data(), header.body_size, packet))
+				return false;
+
+			CallHandler<Handler>(static_cast<Target*>(target), session, header, packet);
+		}
+
+		return true;
+	}
+
+	template <auto Guard>
+	static bool InvokeGuard(void* const target, Session session)
+	{
+		using Target = typename PacketHandlerTraits<decltype(Guard)>::TargetType;
+
+		return std::invoke(Guard, static_cast<Target*>(target), session);
+	}
+
+public:
+	PacketDispatcher() = default;
+	NONCOPYABLE(PacketDispatcher)
+
+	// one handler per packet type
+	template <auto Handler>
+	void Register(typename PacketHandlerTraits<decltype(Handler)>::TargetType* const target)
+	{
+		using T = typename PacketHandlerTraits<decltype(Handler)>::Packet;
+
+		Entry& entry = _entries[static_cast<std::size_t>(T::PACKET_TYPE)];
+		assert(entry.invoker == nullptr);
+
+		entry.target = target;
+		entry.invoker = &Invoke<Handler>;
+	}
+
+	// checked before every packet, false = packet is dropped (guard closes session by itself)
+	template <auto Guard>
+	void SetGuard(typename PacketHandlerTraits<decltype(Guard)>::TargetType* const target)
+	{
+		_guard_target = target;
+		_guard = &InvokeGuard<Guard>;
+	}
+
+	bool IsRegistered(const PacketType packet_type) const
+	{
+		return static_cast<std::size_t>(packet_type) < PACKET_TYPE_COUNT && _entries[static_cast<std::size_t>(packet_type)].invoker != nullptr;
+	}
+
+	PacketDispatchResult Dispatch(Session session, const PacketHeader& header, const DynamicBufferCursor<SocketBuffer>& buffer)
+	{
+		if (_guard != nullptr && !_guard(_guard_target, session))
+			return PacketDispatchResult::Rejected;
+
+		if (!IsRegistered(header.packet_type))
+			return PacketDispatchResult::Unregistered;
+
+		const std::size_t index = static_cast<std::size_t>(header.packet_type);
+		const Entry& entry = _entries[index];
+
+		utility::Nanoseconds begin = utility::FineTick();
+
+		bool success = entry.invoker(entry.target, session, header, buffer);
+
+		const PacketDispatchMetrics* metrics = GetPacketDispatchMetrics(header.packet_type);
+		metrics->packets->Add();
+		metrics->bytes->Add(PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE + header.body_size + GetPacketExtensionSize(header));
+		metrics->handler_time_ns->Add((utility::FineTick() - begin).count());
+
+		return success ? PacketDispatchResult::Handled : PacketDispatchResult::DeserializeFailed;
+	}
+};
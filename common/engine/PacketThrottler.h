@@ -1,10 +1,16 @@
 #pragma once
 
 #include "SocketSession.h"
+#include "EngineMetrics.h"
+#include "../utility/Profiler.h"
 #include "../utility/Sampling.h"
 #include "../network/Meta.h"
 #include "protocol/Packet.h"
 #include "protocol/Protocol.h"
+#include "../utility/Compression.h"
+#include <array>
+#include <unordered_map>
+#include <vector>
 
 enum class PacketPostingPolicy : uint8_t
 {
@@ -12,31 +18,238 @@ enum class PacketPostingPolicy : uint8_t
 	Throttle = 2,
 };
 
+// flush trigger of batched session, whichever comes first
+struct CoalescingPolicy
+{
+	// 0 = only when buffer is full
+	uint32_t flush_bytes = 0;
+
+	// from first packet of batch, 0 = next TryFlushPacket
+	utility::Milliseconds max_delay = utility::Milliseconds(0);
+};
+
+// about one tcp segment
+constexpr uint32_t LOW_LATENCY_FLUSH_BYTES = 1400;
+
 class PacketThrottler
 {
 private:
 
+	// kept while session is alive, session and buffer are held only while it is dirty
 	struct ThrottleData
 	{
 		SocketSessionPtr session = SocketSessionPtr(nullptr);
 		SocketBuffer* buffer = nullptr;
+
+		utility::Milliseconds flush_deadline = utility::Milliseconds(0);
+		CoalescingProfile profile = CoalescingProfile::HighThroughput;
+
+		bool dirty = false;
+		ThrottleData* prev_dirty = nullptr;
+		ThrottleData* next_dirty = nullptr;
+	};
+
+	// intrusive, ordered by flush deadline since every entry of a list has same delay
+	struct DirtyList
+	{
+		ThrottleData* head = nullptr;
+		ThrottleData* tail = nullptr;
 	};
 
+	// key: session id, node address is stable for dirty list
 	std::unordered_map<uint64_t, ThrottleData> _throttle_data;
 
-	utility::Throttler<utility::Milliseconds> _throttler;
+	std::array<CoalescingPolicy, COALESCING_PROFILE_COUNT> _policies;
+	std::array<DirtyList, COALESCING_PROFILE_COUNT> _dirty_lists;
+
+	// clean entries of sessions closed without CleanUp are removed periodically
+	utility::Throttler<utility::Milliseconds> _idle_sweeper;
+
+	void LinkDirty(ThrottleData& throttle_data)
+	{
+		DirtyList& list = _dirty_lists[static_cast<std::size_t>(throttle_data.profile)];
+
+		throttle_data.dirty = true;
+		throttle_data.prev_dirty = list.tail;
+		throttle_data.next_dirty = nullptr;
+
+		if (list.tail != nullptr)
+			list.tail->next_dirty = &throttle_data;
+		else
+			list.head = &throttle_data;
+
+		list.tail = &throttle_data;
+	}
+
+	void UnlinkDirty(ThrottleData& throttle_data)
+	{
+		if (!throttle_data.dirty)
+			return;
+
+		DirtyList& list = _dirty_lists[static_cast<std::size_t>(throttle_data.profile)];
+
+		if (throttle_data.prev_dirty != nullptr)
+			throttle_data.prev_dirty->next_dirty = throttle_data.next_dirty;
+		else
+			list.head = throttle_data.next_dirty;
+
+		if (throttle_data.next_dirty != nullptr)
+			throttle_data.next_dirty->prev_dirty = throttle_data.prev_dirty;
+		else
+			list.tail = throttle_data.prev_dirty;
+
+		throttle_data.dirty = false;
+		throttle_data.prev_dirty = nullptr;
+		throttle_data.next_dirty = nullptr;
+	}
+
+	// buffer of new batch is allocated, nullptr if session can not send
+	ThrottleData* AcquireThrottleData(const SocketSessionPtr& session)
+	{
+		ThrottleData& throttle_data = _throttle_data[session->GetSessionId()];
+
+		if (throttle_data.dirty)
+			return &throttle_data;
+
+		throttle_data.buffer = session->TryAllocateWriteBuffer();
+		if (throttle_data.buffer == nullptr)
+			return nullptr;
+
+		throttle_data.session = session;
+		throttle_data.profile = session->GetCoalescingProfile();
+		throttle_data.flush_deadline = utility::CoarseTick<utility::Milliseconds>() + _policies[static_cast<std::size_t>(throttle_data.profile)].max_delay;
+
+		LinkDirty(throttle_data);
+
+		return &throttle_data;
+	}
+
+	void Flush(ThrottleData& throttle_data)
+	{
+		if (throttle_data.buffer != nullptr)
+			SendPacket(throttle_data);
+
+		UnlinkDirty(throttle_data);
+		throttle_data.session = SocketSessionPtr(nullptr);
+	}
+
+	void CompleteStore(ThrottleData& throttle_data, const PacketPostingPolicy policy)
+	{
+		// write buffer is exhausted while storing, session is closing
+		if (throttle_data.buffer == nullptr)
+		{
+			UnlinkDirty(throttle_data);
+			throttle_data.session = SocketSessionPtr(nullptr);
+			return;
+		}
+
+		uint32_t flush_bytes = _policies[static_cast<std::size_t>(throttle_data.profile)].flush_bytes;
+
+		if (policy == PacketPostingPolicy::Immediate || (flush_bytes != 0 && throttle_data.buffer->length >= flush_bytes))
+			Flush(throttle_data);
+	}
+
+	// whole batch is compressed into one packet_compressed_batch_ps frame, kept raw if it does not shrink
+	// every batch is an independent block, throttlers of several threads can post to same link
+	void CompressBatch(const SocketSessionPtr& session, SocketBuffer* const buffer)
+	{
+		static thread_local std::vector<uint8_t> compressed;
+
+		LinkCompressionStatistics& statistics = session->GetCompressionStatistics();
+
+		const uint32_t frame_prefix_size = PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE + COMPRESSED_BATCH_PREFIX_SIZE;
+		if (buffer->length <= frame_prefix_size)
+		{
+			statistics.raw_batch_count.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		utility::Nanoseconds begin = utility::FineTick();
+
+		compressed.resize(utility::LzCompressBound(buffer->length));
+
+		// output must save more than frame prefix
+		uint32_t compressed_size = utility::LzCompress(buffer->ptr, buffer->length, compressed.data(), buffer->length - frame_prefix_size);
+
+		if (compressed_size == 0)
+		{
+			statistics.raw_batch_count.fetch_add(1, std::memory_order_relaxed);
+			statistics.compress_time_ns.fetch_add((utility::FineTick() - begin).count(), std::memory_order_relaxed);
+			return;
+		}
+
+		uint32_t original_size = buffer->length;
+		uint32_t body_size = COMPRESSED_BATCH_PREFIX_SIZE + compressed_size;
+
+		PacketLengthType packet_length = PACKET_HEADER_SIZE + body_size;
+		PacketHeader header{ PacketType::packet_compressed_batch_ps, 0, ErrorCode::None, body_size };
+
+		std::memcpy(buffer->ptr, &packet_length, PACKET_LENGTH_SIZE);
+		std::memcpy(buffer->ptr + PACKET_LENGTH_SIZE, &header, PACKET_HEADER_SIZE);
+		std::memcpy(buffer->ptr + PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE, &original_size, COMPRESSED_BATCH_PREFIX_SIZE);
+		std::memcpy(buffer->ptr + frame_prefix_size, compressed.data(), compressed_size);
+
+		buffer->length = frame_prefix_size + compressed_size;
+
+		statistics.compressed_batch_count.fetch_add(1, std::memory_order_relaxed);
+		statistics.input_bytes.fetch_add(original_size, std::memory_order_relaxed);
+		statistics.output_bytes.fetch_add(buffer->length, std::memory_order_relaxed);
+		statistics.compress_time_ns.fetch_add((utility::FineTick() - begin).count(), std::memory_order_relaxed);
+	}
 
 	void SendPacket(ThrottleData& throttle_data)
 	{
+		const SocketSessionPtr& session = throttle_data.session;
+
+		uint32_t threshold = session->GetCompressionThreshold();
+		if (threshold != 0 && throttle_data.buffer != nullptr)
+		{
+			if (throttle_data.buffer->length >= threshold)
+				CompressBatch(session, throttle_data.buffer);
+			else
+				session->GetCompressionStatistics().raw_batch_count.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		if (throttle_data.buffer != nullptr)
+			EngineMetrics::ThrottlerFlushBytes()->Record(throttle_data.buffer->length);
+
 		throttle_data.session->Send(throttle_data.buffer);
 		throttle_data.buffer = nullptr;
 	}
 
+	// message larger than one buffer continues in packet_chunk_ps frames, batch buffer is sent whenever it is full
+	void StoreChunks(ThrottleData& throttle_data, const uint8_t* const message, const uint32_t message_size)
+	{
+		uint32_t message_id = throttle_data.session->NextChunkMessageId();
+
+		for (uint32_t offset = 0; offset < message_size;)
+		{
+			uint32_t chunk_size = WritePacketChunk(message, message_size, message_id, offset, throttle_data.buffer->ptr + throttle_data.buffer->length, throttle_data.buffer->capacity - throttle_data.buffer->length);
+
+			if (chunk_size == 0)
+			{
+				if (throttle_data.buffer->length == 0)
+					throw std::exception("socket buffer is too small for packet chunk");
+
+				SendPacket(throttle_data);
+				throttle_data.buffer = throttle_data.session->TryAllocateWriteBuffer();
+
+				if (throttle_data.buffer == nullptr)
+					return;
+
+				continue;
+			}
+
+			throttle_data.buffer->length += chunk_size;
+			offset += chunk_size - PACKET_CHUNK_OVERHEAD;
+		}
+	}
+
 	template <NetworkPacketConcept Packet>
-	void StorePacket(ThrottleData& throttle_data, const Packet& packet, const ErrorCode error)
+	void StorePacket(ThrottleData& throttle_data, const Packet& packet, const ErrorCode error, const uint32_t correlation_id)
 	{
 		uint32_t packet_size = 0;
-		bool success = SerializePacket(packet, error, throttle_data.buffer->ptr + throttle_data.buffer->length, throttle_data.buffer->capacity - throttle_data.buffer->length, packet_size);
+		bool success = SerializePacket(packet, error, throttle_data.buffer->ptr + throttle_data.buffer->length, throttle_data.buffer->capacity - throttle_data.buffer->length, packet_size, correlation_id);
 
 		if (!success)
 		{
@@ -46,47 +259,78 @@ private:
 			if (throttle_data.buffer == nullptr)
 				return;
 
-			success = SerializePacket(packet, error, throttle_data.buffer->ptr + throttle_data.buffer->length, throttle_data.buffer->capacity - throttle_data.buffer->length, packet_size);
+			success = SerializePacket(packet, error, throttle_data.buffer->ptr + throttle_data.buffer->length, throttle_data.buffer->capacity - throttle_data.buffer->length, packet_size, correlation_id);
 			if (!success)
-				throw std::exception("packet size overflow");
+			{
+				static thread_local std::vector<uint8_t> frame;
+				SerializePacketFrame(packet, error, frame, correlation_id);
+
+				StoreChunks(throttle_data, frame.data() + PACKET_LENGTH_SIZE, static_cast<uint32_t>(frame.size()) - PACKET_LENGTH_SIZE);
+				return;
+			}
 		}
 
 		throttle_data.buffer->length += packet_size;
 	}
 
-public:
-
-	PacketThrottler(const utility::Milliseconds tick) : _throttler(tick) {}
-
-	template <NetworkPacketConcept Packet>
-	void PostPacket(const SocketSessionPtr& session, const Packet& packet, const PacketPostingPolicy policy = PacketPostingPolicy::Immediate)
+	void StoreFrame(ThrottleData& throttle_data, const uint8_t* const frame, const uint32_t frame_size)
 	{
-		ThrottleData& throttle_data = _throttle_data[session->GetSessionId()];
+		if (frame_size > throttle_data.buffer->capacity)
+		{
+			StoreChunks(throttle_data, frame + PACKET_LENGTH_SIZE, frame_size - PACKET_LENGTH_SIZE);
+			return;
+		}
 
-		if (throttle_data.buffer == nullptr)
+		if (frame_size > throttle_data.buffer->capacity - throttle_data.buffer->length)
 		{
-			throttle_data.buffer = session->TryAllocateWriteBuffer();
+			SendPacket(throttle_data);
+			throttle_data.buffer = throttle_data.session->TryAllocateWriteBuffer();
+
 			if (throttle_data.buffer == nullptr)
-			{
-				_throttle_data.erase(session->GetSessionId());
 				return;
-			}
 		}
-		
-		throttle_data.session = session;
 
-		StorePacket(throttle_data, packet, ErrorCode::None);
+		std::memcpy(throttle_data.buffer->ptr + throttle_data.buffer->length, frame, frame_size);
+		throttle_data.buffer->length += frame_size;
+	}
 
-		switch (policy)
-		{
-		case PacketPostingPolicy::Immediate:
-			SendPacket(throttle_data);
-			_throttle_data.erase(session->GetSessionId());
-			break;
-		case PacketPostingPolicy::Throttle:
-			break;
-		}
+	// every post acquires batch of session, stores into it and flushes by policy
+	template <typename Store>
+	void Post(const SocketSessionPtr& session, const PacketPostingPolicy policy, Store&& store)
+	{
+		ThrottleData* throttle_data = AcquireThrottleData(session);
+		if (throttle_data == nullptr)
+			return;
+
+		store(*throttle_data);
+
+		CompleteStore(*throttle_data, policy);
+	}
+
+public:
+
+	// tick is max delay of high throughput links, low latency links are flushed by size or on next tick
+	PacketThrottler(const utility::Milliseconds tick) : _idle_sweeper(utility::Milliseconds(10000))
+	{
+		_policies[static_cast<std::size_t>(CoalescingProfile::HighThroughput)] = CoalescingPolicy{ 0, tick };
+		_policies[static_cast<std::size_t>(CoalescingProfile::LowLatency)] = CoalescingPolicy{ LOW_LATENCY_FLUSH_BYTES, utility::Milliseconds(0) };
+	}
 
+	void SetCoalescingPolicy(const CoalescingProfile profile, const CoalescingPolicy& policy)
+	{
+		_policies[static_cast<std::size_t>(profile)] = policy;
+	}
+
+	template <NetworkPacketConcept Packet>
+	void PostPacket(const SocketSessionPtr& session, const Packet& packet, const PacketPostingPolicy policy = PacketPostingPolicy::Immediate, const ErrorCode error = ErrorCode::None, const uint32_t correlation_id = 0)
+	{
+		Post(session, policy, [&](ThrottleData& throttle_data) { StorePacket(throttle_data, packet, error, correlation_id); });
+	}
+
+	// serialized packet (length + header + body), copied into the session batch as is
+	void PostSerializedPacket(const SocketSessionPtr& session, const uint8_t* const frame, const uint32_t frame_size, const PacketPostingPolicy policy = PacketPostingPolicy::Immediate)
+	{
+		Post(session, policy, [&](ThrottleData& throttle_data) { StoreFrame(throttle_data, frame, frame_size); });
 	}
 
 	void CleanUp(const SocketSessionPtr& session)
@@ -98,23 +342,38 @@ public:
 		if (iter->second.buffer != nullptr)
 			iter->second.session->ReleaseWriteBuffer(iter->second.buffer);
 
+		UnlinkDirty(iter->second);
 		_throttle_data.erase(iter);
 	}
 
+	// flushes dirty sessions past deadline, cost is proportional to flushed sessions
 	void TryFlushPacket()
 	{
-		if (!_throttler)
-			return;
+		utility::Milliseconds now = utility::CoarseTick<utility::Milliseconds>();
+
+		for (DirtyList& list : _dirty_lists)
+		{
+			while (list.head != nullptr && list.head->flush_deadline <= now)
+				Flush(*list.head);
+		}
 
-		ForceFlushPacket();
+		if (_idle_sweeper)
+		{
+			std::erase_if(_throttle_data, [](const std::pair<const uint64_t, ThrottleData>& pair) {
+				return !pair.second.dirty;
+			});
+		}
 	}
 
 	void ForceFlushPacket()
 	{
-		for (std::pair<const uint64_t, ThrottleData>& pair : _throttle_data)
-			SendPacket(pair.second);
+		PROFILE_ZONE("PacketThrottler::ForceFlushPacket");
 
-		_throttle_data.clear();
+		for (DirtyList& list : _dirty_lists)
+		{
+			while (list.head != nullptr)
+				Flush(*list.head);
+		}
 	}
 
 };
\ No newline at end of file
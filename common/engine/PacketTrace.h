@@ -0,0 +1,80 @@
+#pragma once
+
+#include "../utility/Trace.h"
+#include "../utility/Logger.h"
+#include "EngineMetrics.h"
+#include "protocol/Packet.h"
+
+// received header takes sampled trace instead of trace context of peer, see NetworkEngineOption::trace_sample_interval
+inline void SamplePacketTrace(PacketHeader& header, const uint32_t interval)
+{
+	if (interval == 0)
+		return;
+
+	header.trace_id = utility::SampleTraceId(interval);
+	header.trace_sent_us = 0;
+}
+
+inline void RecordTraceStage(const TraceStage stage, const uint32_t begin_us, const uint32_t end_us)
+{
+	// stage is not recorded if one of its ends is missing
+	if (begin_us == 0 || end_us == 0)
+		return;
+
+	EngineMetrics::TraceStageTime(stage)->Record(utility::TraceElapsed(begin_us, end_us));
+}
+
+// aggregates stages of finished hop and logs it as sampled span, grep trace id to follow the request
+inline void RecordTraceSpan(const utility::TraceSpan& span, const char* const hop, const uint32_t packet_type)
+{
+	RecordTraceStage(TraceStage::Network, span.sent_us, span.receive_us);
+	RecordTraceStage(TraceStage::Ingress, span.receive_us, span.enqueue_us);
+	RecordTraceStage(TraceStage::Queue, span.enqueue_us, span.dequeue_us);
+	RecordTraceStage(TraceStage::Batch, span.dequeue_us, span.handle_begin_us);
+	RecordTraceStage(TraceStage::Handle, span.handle_begin_us, span.handle_end_us);
+
+	LOG(LogLevel::Info, "trace %08x %s %u, network %u, ingress %u, queue %u, batch %u, handle %u, send %u us",
+		span.trace_id, hop, packet_type,
+		utility::TraceElapsed(span.sent_us, span.receive_us),
+		utility::TraceElapsed(span.receive_us, span.enqueue_us),
+		utility::TraceElapsed(span.enqueue_us, span.dequeue_us),
+		utility::TraceElapsed(span.dequeue_us, span.handle_begin_us),
+		utility::TraceElapsed(span.handle_begin_us, span.handle_end_us),
+		utility::TraceElapsed(span.handle_begin_us, span.send_us));
+}
+
+// trace context of handler posting a task to another worker, task is recorded as hop of its own
+struct TraceHandoff
+{
+	uint32_t trace_id = 0;
+	uint32_t posted_us = 0;
+
+	static TraceHandoff Capture()
+	{
+		utility::TraceSpan* span = utility::TraceScope::Current();
+		if (span == nullptr)
+			return TraceHandoff{};
+
+		return TraceHandoff{ span->trace_id, utility::CurrentTraceTime() };
+	}
+};
+
+template <typename Function>
+inline void RunTraced(const TraceHandoff& handoff, const char* const hop, Function&& function)
+{
+	if (handoff.trace_id == 0)
+	{
+		function();
+		return;
+	}
+
+	utility::TraceSpan span{ handoff.trace_id };
+	span.enqueue_us = handoff.posted_us;
+	span.dequeue_us = utility::CurrentTraceTime();
+	{
+		utility::TraceScope scope(span);
+		function();
+	}
+
+	RecordTraceSpan(span, hop, 0);
+}
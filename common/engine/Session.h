@@ -7,6 +7,7 @@
 #include "../utility/Random.h"
 #include "../utility/Time.h"
 #include "../memory/RefCounter.h"
+#include "EngineMetrics.h"
 
 constexpr uint8_t SessionKeySize = 64;
 using SessionKey = utility::RandomBuffer<SessionKeySize>;
@@ -39,6 +40,21 @@ private:
 	std::unordered_map<uint64_t, uint64_t> _user_data;
 
 	uint64_t _session_id;
+
+	static utility::MetricGauge* GetStateMetric(const SessionState state)
+	{
+		switch (state)
+		{
+		case SessionState::Opened:
+			return EngineMetrics::OpenedSessions();
+		case SessionState::Abandoned:
+			return EngineMetrics::AbandonedSessions();
+		case SessionState::Wait:
+			return EngineMetrics::WaitingSessions();
+		default:
+			return nullptr;
+		}
+	}
 public:
 
 	void Initialize(const uint64_t session_id)
@@ -70,6 +86,11 @@ public:
 		bool success = _session_state.compare_exchange_strong(expected, desired, std::memory_order_acq_rel);
 		if (success)
 		{
+			if (utility::MetricGauge* metric = GetStateMetric(expected))
+				metric->Add(-1);
+
+			if (utility::MetricGauge* metric = GetStateMetric(desired))
+				metric->Add(1);
 		}
 
 		return success;
@@ -2,29 +2,79 @@
 
 #include "NetworkContext.h"
 #include "SocketSession.h"
+#include "../memory/ObjectPool.h"
 
 struct SocketContext : public NetworkContext
 {
 	PacketHeader header;
-	DynamicBufferCursor<SocketBuffer> buffer;
+	DynamicBufferCursor<SocketBuffer> buffer = nullptr;
 	SocketSessionPtr session;
 	uint64_t attachment;
 
-	void Release()
+	// truncated microsecond tick of OnRead, recorded for packets which may carry trace context only
+	uint32_t receive_time_us;
+
+	// releases buffer and session, then returns context to slab of io worker, context must not be touched after
+	void Release();
+};
+
+// slab of contexts owned by one io worker, contexts are released to it from logic worker
+// beyond pool size contexts fall back to heap
+constexpr uint32_t SOCKET_CONTEXT_POOL_SIZE = 65536;
+constexpr uint32_t SOCKET_CONTEXT_CHUNK_SIZE = 256;
+
+using SocketContextPool = ObjectPool<SocketContext, true>;
+
+inline void SocketContext::Release()
+{
+	if (session.Valid() && buffer != nullptr)
 	{
-		if (session.Valid() && buffer != nullptr)
+		if (static_cast<SocketBuffer*>(buffer)->Release() <= 0)
 		{
-			if (static_cast<SocketBuffer*>(buffer)->Release() <= 0)
-			{
-				assert(buffer->Ref() >= 0);
+			assert(buffer->Ref() >= 0);
 
-				session->ReleaseReadBuffer(buffer);
+			session->ReleaseReadBuffer(buffer);
 
-				if (context_type == ContextType::SessionClosed)
-					 session->ReleaseStream();
-			}
-
-			session.Release();
+			if (context_type == ContextType::SessionClosed)
+				 session->ReleaseStream();
 		}
+
+		session.Release();
 	}
-};
\ No newline at end of file
+
+	SocketContextPool::PushDirect(this);
+}
+enum class PacketFrameResult : uint8_t
+{
+	Incomplete,
+	Framed,
+	Corrupted,
+};
+
+// framing of NetworkEngine::OnRead, shared with benchmark so it measures the engine code
+// on Framed cursor is at body and payload_size is body + extensions, otherwise cursor is not moved
+inline PacketFrameResult ReadPacketFrame(const DynamicBufferCursor<SocketBuffer>& cursor, PacketHeader& header, uint32_t& payload_size)
+{
+	if (cursor.RemainBytes() <= PACKET_LENGTH_SIZE)
+		return PacketFrameResult::Incomplete;
+
+	PacketLengthType packet_length;
+	std::memcpy(&packet_length, cursor.Data(), PACKET_LENGTH_SIZE);
+
+	if (cursor.RemainBytes() - PACKET_LENGTH_SIZE < packet_length)
+		return PacketFrameResult::Incomplete;
+
+	if (packet_length < PACKET_HEADER_SIZE)
+		return PacketFrameResult::Corrupted;
+
+	header = DeserializePacketHeader(cursor.Data() + PACKET_LENGTH_SIZE, PACKET_HEADER_SIZE);
+	payload_size = packet_length - PACKET_HEADER_SIZE;
+
+	const uint8_t* body = cursor.Data() + PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE;
+	if (payload_size < header.body_size || !ReadPacketExtensions(header, body + header.body_size, payload_size - header.body_size))
+		return PacketFrameResult::Corrupted;
+
+	cursor.Seek(PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE);
+
+	return PacketFrameResult::Framed;
+}
@@ -11,12 +11,89 @@ constexpr uint64_t GRACEFUL_SHUTDOWN_CODE = 0x01;
 
 class NetworkEngine;
 
+// outbound batching preference of a link, see PacketThrottler
+enum class CoalescingProfile : uint8_t
+{
+	// intra server link, batch until buffer is full or deadline
+	HighThroughput,
+
+	// client link, flush small batch without waiting deadline
+	LowLatency,
+};
+
+constexpr std::size_t COALESCING_PROFILE_COUNT = 2;
+
+// updated by every thread posting batches to the link, relaxed counters
+// never reset, pooled session keeps counting across sessions, readers take deltas between samples
+struct LinkCompressionStatistics
+{
+	std::atomic<uint64_t> compressed_batch_count = 0;
+	std::atomic<uint64_t> raw_batch_count = 0;
+
+	// original and compressed frame bytes of compressed batches
+	std::atomic<uint64_t> input_bytes = 0;
+	std::atomic<uint64_t> output_bytes = 0;
+
+	std::atomic<uint64_t> compress_time_ns = 0;
+
+	std::atomic<uint64_t> decompressed_batch_count = 0;
+	std::atomic<uint64_t> decompress_time_ns = 0;
+
+	double CompressionRatio() const
+	{
+		uint64_t input = input_bytes.load(std::memory_order_relaxed);
+
+		return input == 0 ? 1.0 : static_cast<double>(output_bytes.load(std::memory_order_relaxed)) / static_cast<double>(input);
+	}
+};
+
 class SocketSession : public Session
 {
 private:
 	TransferStreamPtr _socket_stream;
 	NetworkEngine* _engine;
 
+	// negotiated on session creation, 0 = batches are sent raw
+	uint32_t _compression_threshold = 0;
+	LinkCompressionStatistics _compression_statistics;
+
+	// trace_sample_interval of engine, inner frames of batches and chunks are sampled by worker with it
+	uint32_t _trace_sample_interval = 0;
+
+	std::atomic<uint32_t> _chunk_message_id = 0;
+
+	// set by game worker, read by throttler threads
+	std::atomic<CoalescingProfile> _coalescing_profile = CoalescingProfile::HighThroughput;
+
+	// buffer is transmitted, next buffer is allocated for every chunk
+	void SendChunks(SocketBuffer* buffer, const uint8_t* const message, const uint32_t message_size, const bool must_send)
+	{
+		uint32_t message_id = NextChunkMessageId();
+
+		for (uint32_t offset = 0; offset < message_size;)
+		{
+			if (buffer == nullptr)
+			{
+				buffer = _socket_stream->AllocateWriteBuffer(must_send);
+				if (buffer == nullptr)
+				{
+					CloseSession();
+					return;
+				}
+			}
+
+			uint32_t chunk_size = WritePacketChunk(message, message_size, message_id, offset, buffer->ptr, buffer->capacity);
+			if (chunk_size == 0)
+				throw std::exception("socket buffer is too small for packet chunk");
+
+			buffer->length = chunk_size;
+			offset += chunk_size - PACKET_CHUNK_OVERHEAD;
+
+			GetSocketStream()->TransmitWrite(buffer, 0, 0);
+			buffer = nullptr;
+		}
+	}
+
 	TransferStream* GetSocketStream()
 	{
 		SessionState state = GetSessionState();
@@ -38,8 +115,48 @@ public:
 		_engine = engine;
 	}
 
+	void SetCompressionThreshold(const uint32_t threshold)
+	{
+		_compression_threshold = threshold;
+	}
+
+	uint32_t GetCompressionThreshold() const
+	{
+		return _compression_threshold;
+	}
+
+	void SetTraceSampleInterval(const uint32_t interval)
+	{
+		_trace_sample_interval = interval;
+	}
+
+	uint32_t GetTraceSampleInterval() const
+	{
+		return _trace_sample_interval;
+	}
+
+	LinkCompressionStatistics& GetCompressionStatistics()
+	{
+		return _compression_statistics;
+	}
+
+	void SetCoalescingProfile(const CoalescingProfile profile)
+	{
+		_coalescing_profile.store(profile, std::memory_order_relaxed);
+	}
+
+	CoalescingProfile GetCoalescingProfile() const
+	{
+		return _coalescing_profile.load(std::memory_order_relaxed);
+	}
+
+	uint32_t NextChunkMessageId()
+	{
+		return _chunk_message_id.fetch_add(1, std::memory_order_relaxed) + 1;
+	}
+
 	template <NetworkPacketConcept Packet>
-	void Send(const Packet& packet, const ErrorCode error = ErrorCode::None, bool must_send = false)
+	void Send(const Packet& packet, const ErrorCode error = ErrorCode::None, bool must_send = false, const uint32_t correlation_id = 0)
 	{
 		SocketBuffer* buffer = _socket_stream->AllocateWriteBuffer();
 
@@ -54,8 +171,15 @@ public:
 			}
 		}
 #pragma warning ( disable : 6011 )
-		if (!SerializePacket(packet, error, buffer->ptr, buffer->capacity, buffer->length))
-			assert(false);
+		if (!SerializePacket(packet, error, buffer->ptr, buffer->capacity, buffer->length, correlation_id))
+		{
+			// larger than one buffer
+			static thread_local std::vector<uint8_t> frame;
+			SerializePacketFrame(packet, error, frame, correlation_id);
+
+			SendChunks(buffer, frame.data() + PACKET_LENGTH_SIZE, static_cast<uint32_t>(frame.size()) - PACKET_LENGTH_SIZE, must_send);
+			return;
+		}
 #pragma warning ( default : 6011 )
 
 		GetSocketStream()->TransmitWrite(buffer, 0, 0);
@@ -74,7 +198,7 @@ public:
 
 		PacketHeader header = DeserializePacketHeader(cursor.Data(), cursor.RemainBytes());
 		
-		assert(header.body_size + sizeof(PacketHeader) == packet_length);
+		assert(PACKET_HEADER_SIZE + header.body_size + GetPacketExtensionSize(header) == packet_length);
 #endif
 		GetSocketStream()->TransmitWrite(buffer, 0, 0);
 	}
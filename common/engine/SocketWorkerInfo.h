@@ -2,6 +2,8 @@
 
 #include "../memory/SequentialBuffer.h"
 #include "../network/SocketServer.h"
+#include "../utility/SlotMap.h"
+#include "SocketContext.h"
 #include "SocketSession.h"
 #include <unordered_map>
 #include <unordered_set>
@@ -20,10 +22,14 @@ struct ConnectorInfo
 
 struct SocketWorkerInfo
 {
-	std::unordered_map<uint64_t, TransferStreamPtr> _activated_sockets;
+	// handles are kept in extension of stream, OnTick walks values linearly
+	utility::SlotMap<TransferStreamPtr> _activated_sockets;
 
 	std::unordered_map<uint64_t, ConnectorInfo> _connector_list;
 
-	std::unordered_map<uint64_t, SocketSessionPtr> _opened_sessions;
+	utility::SlotMap<SocketSessionPtr> _opened_sessions;
 	std::unordered_map<uint64_t, SocketSessionPtr> _abandoned_sessions;
+
+	// contexts of packets read by this worker, any number of packets per read buffer
+	SocketContextPool* _context_pool = nullptr;
 };
\ No newline at end of file
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "Packet.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+/*
+	compact object layout, objects are sorted by id
+
+	varint	id delta (first object from id_base, others from previous object)
+	int16	position x, y (fixed point relative to sector center, 1 unit = SectorSize / 32767)
+	uint16	direction(4) | phase(4) | location(2) | type(3)
+	varint	size x, y
+	varint	force
+	varint	elapsed time since last transform (ms)
+	varint	hp, speed, damage
+
+	server only fields (is_observing_fixture, last_transform_time, user_data) are not encoded
+*/
+
+constexpr CoordinateUnit CompactPositionScale = 32767.0f / SectorSize.x;
+
+// 7 one byte varints, positions and bits
+constexpr uint64_t CompactObjectMinSize = 7 + sizeof(int16_t) * 2 + sizeof(uint16_t);
+
+inline void WriteVarint(std::vector<uint8_t>& buffer, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		buffer.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+
+	buffer.push_back(static_cast<uint8_t>(value));
+}
+
+inline bool ReadVarint(const uint8_t*& data, const uint8_t* const end, uint64_t& value)
+{
+	value = 0;
+
+	for (uint32_t shift = 0; shift < 64; shift += 7)
+	{
+		if (data == end)
+			return false;
+
+		uint8_t byte = *data++;
+		value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+		if ((byte & 0x80) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+inline int16_t QuantizeSectorPosition(const CoordinateUnit value, const CoordinateUnit center)
+{
+	CoordinateUnit quantized = std::round((value - center) * CompactPositionScale);
+
+	return static_cast<int16_t>(std::clamp(quantized, -32767.0f, 32767.0f));
+}
+
+inline CoordinateUnit DequantizeSectorPosition(const int16_t value, const CoordinateUnit center)
+{
+	return center + static_cast<CoordinateUnit>(value) / CompactPositionScale;
+}
+
+inline void EncodeCompactObject(std::vector<uint8_t>& buffer, const Vector2 sector_center, const uint64_t previous_id, const PacketObjectInfo& object)
+{
+	const Fixture& fixture = object.fixture;
+
+	WriteVarint(buffer, object.object_id - previous_id);
+
+	int16_t position[2] = { QuantizeSectorPosition(fixture.position.x, sector_center.x), QuantizeSectorPosition(fixture.position.y, sector_center.y) };
+
+	uint16_t bits = static_cast<uint16_t>(fixture.direction) | static_cast<uint16_t>(fixture.phase) << 4 | static_cast<uint16_t>(fixture.location) << 8 | static_cast<uint16_t>(object.type) << 10;
+
+	std::size_t offset = buffer.size();
+	buffer.resize(offset + sizeof(position) + sizeof(bits));
+	std::memcpy(buffer.data() + offset, position, sizeof(position));
+	std::memcpy(buffer.data() + offset + sizeof(position), &bits, sizeof(bits));
+
+	WriteVarint(buffer, static_cast<uint64_t>(std::max(fixture.size.x, 0.0f)));
+	WriteVarint(buffer, static_cast<uint64_t>(std::max(fixture.size.y, 0.0f)));
+	WriteVarint(buffer, static_cast<uint64_t>(std::max(fixture.force, 0.0f)));
+	WriteVarint(buffer, fixture.personal_delta_time);
+
+	WriteVarint(buffer, object.vital.hp);
+	WriteVarint(buffer, object.vital.speed);
+	WriteVarint(buffer, object.vital.damage);
+}
+
+inline bool DecodeCompactObject(const uint8_t*& data, const uint8_t* const end, const uint64_t sector_id, const Vector2 sector_center, const uint64_t previous_id, PacketObjectInfo& object)
+{
+	uint64_t id_delta = 0;
+	if (!ReadVarint(data, end, id_delta))
+		return false;
+
+	int16_t position[2];
+	uint16_t bits;
+
+	if (static_cast<std::size_t>(end - data) < sizeof(position) + sizeof(bits))
+		return false;
+
+	std::memcpy(position, data, sizeof(position));
+	std::memcpy(&bits, data + sizeof(position), sizeof(bits));
+	data += sizeof(position) + sizeof(bits);
+
+	uint64_t values[7];
+	for (uint64_t& value : values)
+	{
+		if (!ReadVarint(data, end, value))
+			return false;
+	}
+
+	object = {};
+	object.object_id = previous_id + id_delta;
+	object.sector_id = sector_id;
+	object.type = static_cast<ObjectType>((bits >> 10) & 0x7);
+
+	Fixture& fixture = object.fixture;
+	fixture.id = object.object_id;
+	fixture.sector_id = sector_id;
+	fixture.position = Vector2{ DequantizeSectorPosition(position[0], sector_center.x), DequantizeSectorPosition(position[1], sector_center.y) };
+	fixture.direction = static_cast<Direction>(bits & 0xF);
+	fixture.phase = static_cast<Direction>((bits >> 4) & 0xF);
+	fixture.location = static_cast<FixtureLocation>((bits >> 8) & 0x3);
+	fixture.size = Vector2{ static_cast<CoordinateUnit>(values[0]), static_cast<CoordinateUnit>(values[1]) };
+	fixture.force = static_cast<CoordinateUnit>(values[2]);
+	fixture.personal_delta_time = values[3];
+
+	object.vital = Vital{ static_cast<uint32_t>(values[4]), static_cast<uint32_t>(values[5]), static_cast<uint32_t>(values[6]) };
+
+	return true;
+}
+
+// objects are sorted by id in place, list is std::vector or FrameVector
+template <typename ObjectList>
+inline void EncodeCompactObjectBlock(const uint64_t sector_id, ObjectList& objects, CompactObjectBlock& block)
+{
+	std::sort(objects.begin(), objects.end(), [](const PacketObjectInfo& left, const PacketObjectInfo& right) {
+		return left.object_id < right.object_id;
+	});
+
+	Vector2 sector_center = GetSectorFixtureRectangle(sector_id).Center();
+
+	block.id_base = objects.empty() ? 0 : objects.front().object_id;
+	block.object_count = static_cast<uint32_t>(objects.size());
+	block.data.clear();
+	block.data.reserve(objects.size() * 16);
+
+	uint64_t previous_id = block.id_base;
+	for (const PacketObjectInfo& object : objects)
+	{
+		EncodeCompactObject(block.data, sector_center, previous_id, object);
+		previous_id = object.object_id;
+	}
+}
+
+inline void EncodeCompactObjectBlock(const PacketObjectInfo& object, CompactObjectBlock& block)
+{
+	block.id_base = object.object_id;
+	block.object_count = 1;
+	block.data.clear();
+
+	EncodeCompactObject(block.data, GetSectorFixtureRectangle(object.sector_id).Center(), object.object_id, object);
+}
+
+inline bool DecodeCompactObjectBlock(const uint64_t sector_id, const CompactObjectBlock& block, std::vector<PacketObjectInfo>& objects)
+{
+	if (sector_id >= SectorGridList.size() || block.object_count > block.data.size() / CompactObjectMinSize)
+		return false;
+
+	Vector2 sector_center = GetSectorFixtureRectangle(sector_id).Center();
+
+	const uint8_t* data = block.data.data();
+	const uint8_t* const end = data + block.data.size();
+
+	objects.resize(block.object_count);
+
+	uint64_t previous_id = block.id_base;
+	for (PacketObjectInfo& object : objects)
+	{
+		if (!DecodeCompactObject(data, end, sector_id, sector_center, previous_id, object))
+			return false;
+
+		previous_id = object.object_id;
+	}
+
+	return data == end;
+}
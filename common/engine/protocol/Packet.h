@@ -4,10 +4,12 @@
 #include "../../game/coordinate/Fixture.h"
 #include "../../game/object/Vital.h"
 #include "../Session.h"
+#include "../../memory/FrameArena.h"
 #include "PacketEnum.h"
 #include "PacketStruct.h"
 #include <xmemory>
 #include <concepts>
+#include <cstddef>
 
 enum class PacketType : uint16_t
 {
@@ -20,19 +22,25 @@ enum class PacketType : uint16_t
 	packet_session_close_rq,
 	packet_bandwith_overflow_ps,
 	packet_server_is_busy_ps,
+	packet_compressed_batch_ps,
+	packet_chunk_ps,
 
 	packet_game_enter_request_rq,
 	packet_game_enter_request_rs,
 	packet_enter_new_character_ps,
 	packet_object_list_ps,
+	packet_compact_object_list_ps,
 	packet_object_move_ps,
 	packet_create_object_ps,
+	packet_compact_create_object_ps,
 	packet_remove_object_ps,
 	packet_object_start_skill_ps,
 	packet_character_move_rq,
 	packet_character_move_rs,
 	packet_start_skill_rq,
 	packet_start_skill_rs,
+	packet_sector_snapshot_ps,
+	packet_sector_snapshot_ack_rq,
 
 	packet_load_server_config_rq,
 	packet_load_server_config_rs,
@@ -52,6 +60,9 @@ enum class PacketType : uint16_t
 	packet_create_observing_object_rq,
 	packet_remove_observing_object_rq,
 	packet_promote_object_rq,
+
+	// not a packet, number of packet types
+	packet_type_count,
 };
 
 
@@ -62,16 +73,36 @@ concept NetworkPacketConcept = requires {
 
 using PacketLengthType = uint32_t;
 
+// optional header fields, sent after body in bit order only when flagged in header
+// frame is length | header | body | extensions, so readers of body are not changed by them
+enum class PacketExtension : uint8_t
+{
+	Correlation = 1 << 0,
+	Trace = 1 << 1,
+};
+
 struct PacketHeader
 {
 	PacketType packet_type;
+
+	// PacketExtension bits, set by serializer from optional fields
+	uint8_t extensions = 0;
 	ErrorCode error_code;
 	PacketLengthType body_size;
+
+	// optional fields, not a part of fixed header on wire
+
+	// 0 = not correlated, see IntraCall.h
+	uint32_t correlation_id = 0;
+
+	// 0 = not traced, sent_us is truncated microsecond tick of sender, see utility/Trace.h
+	uint32_t trace_id = 0;
+	uint32_t trace_sent_us = 0;
 };
 
 // struct packing        
 constexpr PacketLengthType PACKET_LENGTH_SIZE = sizeof(PacketLengthType);
-constexpr PacketLengthType PACKET_HEADER_SIZE = sizeof(PacketHeader);
+constexpr PacketLengthType PACKET_HEADER_SIZE = offsetof(PacketHeader, correlation_id);
 
 ////////////////////////////////////////////////
 // general protocol
@@ -91,7 +122,9 @@ struct packet_heartbeat_rs
 struct packet_session_create_rq 
 {
 	static constexpr PacketType PACKET_TYPE = PacketType::packet_session_create_rq;
-	uint8_t _1;
+
+	// connector supports compressed batch
+	bool use_compression;
 };
 
 struct packet_session_create_rs
@@ -99,6 +132,9 @@ struct packet_session_create_rs
 	static constexpr PacketType PACKET_TYPE = PacketType::packet_session_create_rs;
 	uint64_t session_id;
 	std::array<uint8_t, SessionKeySize>  session_key;
+
+	// both sides agreed to compressed batch
+	bool use_compression;
 };
 
 struct packet_session_auth_rq
@@ -152,7 +188,14 @@ struct packet_object_list_ps
 {
 	static constexpr PacketType PACKET_TYPE = PacketType::packet_object_list_ps;
 	uint64_t sector_id;
-	std::vector<PacketObjectInfo> object_list;
+	FrameVector<PacketObjectInfo> object_list;
+};
+
+struct packet_compact_object_list_ps
+{
+	static constexpr PacketType PACKET_TYPE = PacketType::packet_compact_object_list_ps;
+	uint64_t sector_id;
+	CompactObjectBlock objects;
 };
 
 struct packet_create_object_ps
@@ -161,6 +204,13 @@ struct packet_create_object_ps
 	PacketObjectInfo object_info;
 };
 
+struct packet_compact_create_object_ps
+{
+	static constexpr PacketType PACKET_TYPE = PacketType::packet_compact_create_object_ps;
+	uint64_t sector_id;
+	CompactObjectBlock objects;
+};
+
 struct packet_remove_object_ps
 {
 	static constexpr PacketType PACKET_TYPE = PacketType::packet_remove_object_ps;
@@ -230,6 +280,26 @@ struct packet_start_skill_rs
 	uint8_t _1;
 };
 
+// baseline_sequence 0 = full snapshot, otherwise delta against acknowledged baseline
+struct packet_sector_snapshot_ps
+{
+	static constexpr PacketType PACKET_TYPE = PacketType::packet_sector_snapshot_ps;
+	uint64_t sector_id;
+	uint32_t sequence;
+	uint32_t baseline_sequence;
+
+	// created or changed objects
+	CompactObjectBlock objects;
+	std::vector<uint64_t> removed_object_ids;
+};
+
+struct packet_sector_snapshot_ack_rq
+{
+	static constexpr PacketType PACKET_TYPE = PacketType::packet_sector_snapshot_ack_rq;
+	uint64_t sector_id;
+	uint32_t sequence;
+};
+
 ////////////////////////////////////////////////
 // server to supervisor
 ////////////////////////////////////////////////
@@ -266,8 +336,8 @@ struct packet_recovery_minion_server_rq
 	static constexpr PacketType PACKET_TYPE = PacketType::packet_recovery_minion_server_rq;
 	std::array<uint8_t, SessionKeySize> auth_key;
 	ServerInfo server_info;
-	std::vector<uint64_t> sectors;
-	std::vector<ServerInfo> intra_servers;
+	FrameVector<uint64_t> sectors;
+	FrameVector<ServerInfo> intra_servers;
 };
 
 struct packet_recovery_minion_server_rs
@@ -286,8 +356,8 @@ struct packet_update_intra_server_info_ps
 struct packet_sector_allocation_ps
 {
 	static constexpr PacketType PACKET_TYPE = PacketType::packet_sector_allocation_ps;
-	std::vector<SectorAllocationInfo> allocation_info;
-	std::vector<SectorAllocationInfo> deallocation_info;
+	FrameVector<SectorAllocationInfo> allocation_info;
+	FrameVector<SectorAllocationInfo> deallocation_info;
 };
 
 struct packet_authorize_server_rq
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Protocol.h"
+#include <algorithm>
+#include <array>
+#include <string_view>
+
+// every packet struct of Packet.h, new packet must be added here
+#define PACKET_REGISTRY_LIST(X) \
+	X(packet_heartbeat_rq) \
+	X(packet_heartbeat_rs) \
+	X(packet_session_create_rq) \
+	X(packet_session_create_rs) \
+	X(packet_session_auth_rq) \
+	X(packet_session_auth_rs) \
+	X(packet_session_close_rq) \
+	X(packet_bandwith_overflow_ps) \
+	X(packet_server_is_busy_ps) \
+	X(packet_game_enter_request_rq) \
+	X(packet_game_enter_request_rs) \
+	X(packet_enter_new_character_ps) \
+	X(packet_object_list_ps) \
+	X(packet_compact_object_list_ps) \
+	X(packet_object_move_ps) \
+	X(packet_create_object_ps) \
+	X(packet_compact_create_object_ps) \
+	X(packet_remove_object_ps) \
+	X(packet_object_start_skill_ps) \
+	X(packet_character_move_rq) \
+	X(packet_character_move_rs) \
+	X(packet_start_skill_rq) \
+	X(packet_start_skill_rs) \
+	X(packet_sector_snapshot_ps) \
+	X(packet_sector_snapshot_ack_rq) \
+	X(packet_load_server_config_rq) \
+	X(packet_load_server_config_rs) \
+	X(packet_register_minion_server_rq) \
+	X(packet_register_minion_server_rs) \
+	X(packet_authorize_server_rq) \
+	X(packet_authorize_server_rs) \
+	X(packet_update_intra_server_info_ps) \
+	X(packet_sector_allocation_ps) \
+	X(packet_recovery_minion_server_rq) \
+	X(packet_recovery_minion_server_rs) \
+	X(packet_spawn_character_rq) \
+	X(packet_spawn_character_rs) \
+	X(packet_remove_character_rq) \
+	X(packet_remove_character_rs) \
+	X(packet_create_observing_object_rq) \
+	X(packet_remove_observing_object_rq) \
+	X(packet_promote_object_rq)
+
+constexpr std::size_t PACKET_TYPE_COUNT = static_cast<std::size_t>(PacketType::packet_type_count);
+
+struct PacketTraits
+{
+	std::string_view name = "unknown packet";
+
+	// false for packet type without struct (packet_compressed_batch_ps, packet_chunk_ps)
+	bool registered = false;
+
+	bool fixed_layout = false;
+
+	// body size of fixed layout packet, 0 = variable size
+	uint32_t fixed_body_size = 0;
+};
+
+template <NetworkPacketConcept T>
+constexpr PacketTraits MakePacketTraits(const std::string_view name)
+{
+	if constexpr (FixedLayoutPacketConcept<T>)
+		return PacketTraits{ name, true, true, static_cast<uint32_t>(sizeof(T)) };
+	else
+		return PacketTraits{ name, true, false, 0 };
+}
+
+// index: PacketType
+constexpr std::array<PacketTraits, PACKET_TYPE_COUNT> PacketTraitsTable = []() {
+	std::array<PacketTraits, PACKET_TYPE_COUNT> table{};
+
+	// duplicated packet type fails to compile
+#define REGISTER_PACKET_TRAITS(packet) \
+	if (table[static_cast<std::size_t>(packet::PACKET_TYPE)].registered) \
+		throw "duplicated packet type"; \
+	table[static_cast<std::size_t>(packet::PACKET_TYPE)] = MakePacketTraits<packet>(#packet);
+
+	PACKET_REGISTRY_LIST(REGISTER_PACKET_TRAITS)
+
+#undef REGISTER_PACKET_TRAITS
+
+	return table;
+}();
+
+// largest fixed layout frame, write buffer smaller than it can not carry every fixed layout packet
+// it is only checked against socket buffer capacity at engine startup, socket buffers have one size class so nothing is selected per packet
+constexpr uint32_t MAX_FIXED_PACKET_FRAME_SIZE = []() {
+	uint32_t max_body_size = 0;
+	for (const PacketTraits& traits : PacketTraitsTable)
+		max_body_size = std::max(max_body_size, traits.fixed_body_size);
+
+	return PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE + max_body_size + MAX_PACKET_EXTENSION_SIZE;
+}();
+
+constexpr PacketTraits UnknownPacketTraits{};
+
+inline constexpr const PacketTraits& GetPacketTraits(const PacketType packet_type)
+{
+	if (static_cast<std::size_t>(packet_type) >= PACKET_TYPE_COUNT)
+		return UnknownPacketTraits;
+
+	return PacketTraitsTable[static_cast<std::size_t>(packet_type)];
+}
+
+template <NetworkPacketConcept T>
+constexpr std::string_view GetPacketName()
+{
+	static_assert(PacketTraitsTable[static_cast<std::size_t>(T::PACKET_TYPE)].registered, "packet is not in PACKET_REGISTRY_LIST");
+
+	return PacketTraitsTable[static_cast<std::size_t>(T::PACKET_TYPE)].name;
+}
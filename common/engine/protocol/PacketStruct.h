@@ -2,6 +2,7 @@
 
 #include "PacketEnum.h"
 #include "../../network/SocketServer.h"
+#include <vector>
 
 
 struct NetworkEngineOption
@@ -15,6 +16,27 @@ struct NetworkEngineOption
 	uint32_t session_reconnect_timeout_ms = 30000;
 
 	uint32_t worker_update_tick_ms = 500;
+
+	// io worker -> engine worker, one spsc lane per io worker
+	bool use_producer_lane = false;
+	uint32_t producer_lane_capacity = 4096;
+	uint32_t producer_lane_max_capacity = 65536;
+
+	// packet processing time per worker loop, 0 = unbounded
+	uint32_t worker_context_budget_us = 0;
+	// fixed timestep ticks run back to back before late ticks are dropped
+	uint32_t worker_max_catch_up_ticks = 4;
+
+	// negotiated on session creation, throttled batch at least threshold bytes is compressed
+	// intra server links only, user links would pay compression per client and accept compressed input from clients
+	bool use_link_compression = false;
+	uint32_t link_compression_threshold = 512;
+
+	// one of interval received packets starts a trace replacing trace context of peer, 0 = trace context of peer is kept
+	uint32_t trace_sample_interval = 0;
+
+	// packet_chunk_ps is received and reassembled, user links disable it so clients can not make workers hold partial messages
+	bool accept_packet_chunk = true;
 };
 
 struct GameConfig
@@ -22,6 +44,15 @@ struct GameConfig
 	uint16_t game_update_tick_ms;
 	uint16_t packet_batch_process_time_ms;
 	uint16_t fixture_transform_cooltime_ms;
+
+	// client session logic shard count, 0 = client session is handled by game worker
+	uint16_t client_shard_count = 0;
+
+	// thread count updating world sectors in parallel including game worker, 0 or 1 = serial
+	uint16_t world_update_concurrency = 0;
+
+	// client receives per sector snapshots (full or delta against acknowledged baseline) instead of object event pushes
+	bool use_snapshot_replication = false;
 };
 
 struct ServerConfig
@@ -39,6 +70,8 @@ struct ServerConfig
 	// game layer //
 	GameConfig game_config;
 	
+	// prometheus scrape endpoint, 0 = disabled
+	uint16_t metrics_listen_port = 0;
 };
 
 struct ServerInfo
@@ -61,4 +94,12 @@ struct PacketObjectInfo
 	ObjectType type;
 	Fixture fixture;
 	Vital vital;
+};
+
+// client facing object state, see CompactObject.h for layout
+struct CompactObjectBlock
+{
+	uint64_t id_base;
+	uint32_t object_count;
+	std::vector<uint8_t> data;
 };
\ No newline at end of file
@@ -2,42 +2,276 @@
 
 #include "Packet.h"
 #include "../../common.h"
+#include "../../memory/IntrusivePtr.h"
+#include "../../memory/RefCounter.h"
+#include "../../utility/Trace.h"
 #include <ylt/struct_pack.hpp>
 #include <xmemory>
+#include <algorithm>
 #include <cassert>
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <type_traits>
 
+// fixed layout packet body is the packet memory itself, struct_pack is used for variable size packets only
+template <typename T>
+concept FixedLayoutPacketConcept = NetworkPacketConcept<T> && std::is_trivially_copyable_v<T> && std::is_standard_layout_v<T>;
+
+template <NetworkPacketConcept T>
+inline uint32_t GetPacketBodySize(const T& packet)
+{
+	if constexpr (FixedLayoutPacketConcept<T>)
+		return sizeof(T);
+	else
+		return static_cast<uint32_t>(struct_pack::get_needed_size(packet));
+}
+
+// fixed header only, optional fields are read from end of frame by ReadPacketExtensions
 inline PacketHeader DeserializePacketHeader(const uint8_t* const packet_buffer, const std::size_t buffer_size)
 {
 	assert(buffer_size >= PACKET_HEADER_SIZE);
-	return *reinterpret_cast<const PacketHeader*>(packet_buffer);
+
+	PacketHeader header;
+	std::memcpy(&header, packet_buffer, PACKET_HEADER_SIZE);
+
+	return header;
+}
+
+inline bool HasPacketExtension(const PacketHeader& header, const PacketExtension extension)
+{
+	return (header.extensions & static_cast<uint8_t>(extension)) != 0;
+}
+
+inline uint32_t GetPacketExtensionSize(const PacketHeader& header)
+{
+	uint32_t size = 0;
+	if (HasPacketExtension(header, PacketExtension::Correlation))
+		size += sizeof(header.correlation_id);
+	if (HasPacketExtension(header, PacketExtension::Trace))
+		size += sizeof(header.trace_id) + sizeof(header.trace_sent_us);
+
+	return size;
+}
+
+// every extension set at once
+constexpr uint32_t MAX_PACKET_EXTENSION_SIZE = sizeof(PacketHeader::correlation_id) + sizeof(PacketHeader::trace_id) + sizeof(PacketHeader::trace_sent_us);
+
+// sets extension bits from optional fields, returns size of extensions
+inline uint32_t PreparePacketExtensions(PacketHeader& header)
+{
+	header.extensions = 0;
+	if (header.correlation_id != 0)
+		header.extensions |= static_cast<uint8_t>(PacketExtension::Correlation);
+	if (header.trace_id != 0)
+		header.extensions |= static_cast<uint8_t>(PacketExtension::Trace);
+
+	return GetPacketExtensionSize(header);
+}
+
+inline void WritePacketExtensions(const PacketHeader& header, uint8_t* dest_buffer)
+{
+	if (HasPacketExtension(header, PacketExtension::Correlation))
+	{
+		std::memcpy(dest_buffer, &header.correlation_id, sizeof(header.correlation_id));
+		dest_buffer += sizeof(header.correlation_id);
+	}
+
+	if (HasPacketExtension(header, PacketExtension::Trace))
+	{
+		std::memcpy(dest_buffer, &header.trace_id, sizeof(header.trace_id));
+		std::memcpy(dest_buffer + sizeof(header.trace_id), &header.trace_sent_us, sizeof(header.trace_sent_us));
+	}
+}
+
+// extension_buffer is end of body, false if remain bytes of frame do not match extension bits
+inline bool ReadPacketExtensions(PacketHeader& header, const uint8_t* const extension_buffer, const std::size_t extension_size)
+{
+	if (extension_size != GetPacketExtensionSize(header))
+		return false;
+
+	const uint8_t* cursor = extension_buffer;
+
+	if (HasPacketExtension(header, PacketExtension::Correlation))
+	{
+		std::memcpy(&header.correlation_id, cursor, sizeof(header.correlation_id));
+		cursor += sizeof(header.correlation_id);
+	}
+
+	if (HasPacketExtension(header, PacketExtension::Trace))
+	{
+		std::memcpy(&header.trace_id, cursor, sizeof(header.trace_id));
+		std::memcpy(&header.trace_sent_us, cursor + sizeof(header.trace_id), sizeof(header.trace_sent_us));
+	}
+
+	return true;
+}
+
+// bytes which are not a value of bool or enum field make the packet undefined, they are checked before it is read
+// fixed layout packet with such fields which is received from client specializes this
+template <FixedLayoutPacketConcept T>
+inline bool ValidatePacketBody(const uint8_t* const packet_buffer)
+{
+	return true;
+}
+
+template <>
+inline bool ValidatePacketBody<packet_session_create_rq>(const uint8_t* const packet_buffer)
+{
+	return packet_buffer[offsetof(packet_session_create_rq, use_compression)] <= 1;
+}
+
+template <>
+inline bool ValidatePacketBody<packet_character_move_rq>(const uint8_t* const packet_buffer)
+{
+	uint8_t direction = packet_buffer[offsetof(packet_character_move_rq, direction)];
+	uint8_t to_owner = packet_buffer[offsetof(packet_character_move_rq, to_owner)];
+
+	return direction < static_cast<uint8_t>(Direction::Max) && to_owner <= 1;
+}
+
+// in place view of fixed layout packet body, nullptr if body size does not match or body is not valid
+// body is not aligned in receive buffer, x64 allows unaligned access same as DeserializePacketHeader
+template <FixedLayoutPacketConcept T>
+inline const T* ViewPacketBody(const uint8_t* const packet_buffer, const std::size_t buffer_size)
+{
+	if (buffer_size != sizeof(T) || !ValidatePacketBody<T>(packet_buffer))
+		return nullptr;
+
+	return reinterpret_cast<const T*>(packet_buffer);
 }
 
 template <NetworkPacketConcept T>
 inline bool DeserializePacketBody(const uint8_t* const packet_buffer, const std::size_t buffer_size, T& packet)
 {
-	struct_pack::err_code error = struct_pack::deserialize_to(packet, reinterpret_cast<const char*>(packet_buffer), buffer_size);
+	if constexpr (FixedLayoutPacketConcept<T>)
+	{
+		if (buffer_size != sizeof(T) || !ValidatePacketBody<T>(packet_buffer))
+			return false;
 
-	return error == struct_pack::errc::ok;
+		std::memcpy(&packet, packet_buffer, sizeof(T));
+		return true;
+	}
+	else
+	{
+		// received packet may outlive the frame
+		FrameHeapScope heap_scope;
+
+		struct_pack::err_code error = struct_pack::deserialize_to(packet, reinterpret_cast<const char*>(packet_buffer), buffer_size);
+
+		return error == struct_pack::errc::ok;
+	}
 }
 
 template <NetworkPacketConcept T>
-inline bool SerializePacket(const T& packet, const ErrorCode error_code, uint8_t* const dest_buffer, const uint32_t buffer_size, uint32_t& packet_size)
+inline bool SerializePacket(const T& packet, const ErrorCode error_code, uint8_t* const dest_buffer, const uint32_t buffer_size, uint32_t& packet_size, const uint32_t correlation_id = 0)
 {
-	auto needed_size = struct_pack::get_needed_size(packet);
+	auto needed_size = [&packet]() {
+		if constexpr (FixedLayoutPacketConcept<T>)
+			return sizeof(T);
+		else
+			return struct_pack::get_needed_size(packet);
+	}();
+
+	PacketHeader header{ T::PACKET_TYPE, 0, error_code, static_cast<uint32_t>(needed_size) };
+	header.correlation_id = correlation_id;
+	utility::StampTrace(header.trace_id, header.trace_sent_us);
 
-	packet_size = PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE + static_cast<uint32_t>(needed_size);
+	uint32_t extension_size = PreparePacketExtensions(header);
+
+	packet_size = PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE + static_cast<uint32_t>(needed_size) + extension_size;
 
 	if (packet_size > buffer_size)
 		return false;
 
 	PacketLengthType packet_length = packet_size - PACKET_LENGTH_SIZE;
 
-	PacketHeader header{ T::PACKET_TYPE, error_code, static_cast<uint32_t>(needed_size)};
-
 	std::memcpy(dest_buffer, &packet_length, PACKET_LENGTH_SIZE);
 	std::memcpy(dest_buffer + PACKET_LENGTH_SIZE, &header, PACKET_HEADER_SIZE);
 
-	struct_pack::serialize_to(reinterpret_cast<char*>(dest_buffer + PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE), needed_size, packet);
+	if constexpr (FixedLayoutPacketConcept<T>)
+		std::memcpy(dest_buffer + PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE, &packet, sizeof(T));
+	else
+		struct_pack::serialize_to(reinterpret_cast<char*>(dest_buffer + PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE), needed_size, packet);
+
+	WritePacketExtensions(header, dest_buffer + PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE + needed_size);
 
 	return true;
-}
\ No newline at end of file
+}
+
+// body of packet_compressed_batch_ps: uint32 original size + lz4 block of packet frames
+constexpr uint32_t COMPRESSED_BATCH_PREFIX_SIZE = sizeof(uint32_t);
+
+// upper bound of decompressed batch, larger batch is treated as corrupted
+constexpr uint32_t MAX_DECOMPRESSED_BATCH_SIZE = 4 * 1024 * 1024;
+
+// serialized packet (length + header + body), shared by every receiver
+// pooled frames keep their capacity, so a steady broadcast does not allocate
+struct SharedPacketFrame : public RefCounter<false>
+{
+	std::vector<uint8_t> data;
+};
+
+using PacketFrame = IntrusivePtr<SharedPacketFrame>;
+
+template <NetworkPacketConcept T>
+inline void SerializePacketFrame(const T& packet, const ErrorCode error_code, std::vector<uint8_t>& frame, const uint32_t correlation_id = 0)
+{
+	frame.resize(PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE + GetPacketBodySize(packet) + MAX_PACKET_EXTENSION_SIZE);
+
+	uint32_t packet_size = 0;
+	if (!SerializePacket(packet, error_code, frame.data(), static_cast<uint32_t>(frame.size()), packet_size, correlation_id))
+		assert(false);
+
+	frame.resize(packet_size);
+}
+
+/*
+	packet larger than one socket buffer is split into packet_chunk_ps frames
+
+	message	header + body of original packet (length prefix is not included)
+	body	PacketChunkHeader + message[offset, offset + payload size)
+
+	chunks of one message are sent in order by one thread, chunks of other messages can be interleaved
+*/
+struct PacketChunkHeader
+{
+	// unique in sending session
+	uint32_t message_id;
+
+	uint32_t message_size;
+	uint32_t offset;
+};
+
+constexpr uint32_t PACKET_CHUNK_HEADER_SIZE = sizeof(PacketChunkHeader);
+constexpr uint32_t PACKET_CHUNK_OVERHEAD = PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE + PACKET_CHUNK_HEADER_SIZE;
+
+// remain space of batch buffer smaller than it is not used for chunk
+constexpr uint32_t MIN_PACKET_CHUNK_PAYLOAD_SIZE = 256;
+
+// upper bound of reassembled message, larger message is treated as corrupted
+constexpr uint32_t MAX_CHUNKED_MESSAGE_SIZE = 16 * 1024 * 1024;
+
+// writes chunk of message starting at offset, returns frame size or 0 if dest is too small
+inline uint32_t WritePacketChunk(const uint8_t* const message, const uint32_t message_size, const uint32_t message_id, const uint32_t offset, uint8_t* const dest, const uint32_t dest_size)
+{
+	assert(offset < message_size);
+
+	uint32_t remain_size = message_size - offset;
+
+	if (dest_size < PACKET_CHUNK_OVERHEAD + std::min(remain_size, MIN_PACKET_CHUNK_PAYLOAD_SIZE))
+		return 0;
+
+	uint32_t payload_size = std::min(remain_size, dest_size - PACKET_CHUNK_OVERHEAD);
+
+	PacketChunkHeader chunk{ message_id, message_size, offset };
+	PacketHeader header{ PacketType::packet_chunk_ps, 0, ErrorCode::None, PACKET_CHUNK_HEADER_SIZE + payload_size };
+	PacketLengthType packet_length = PACKET_HEADER_SIZE + header.body_size;
+
+	std::memcpy(dest, &packet_length, PACKET_LENGTH_SIZE);
+	std::memcpy(dest + PACKET_LENGTH_SIZE, &header, PACKET_HEADER_SIZE);
+	std::memcpy(dest + PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE, &chunk, PACKET_CHUNK_HEADER_SIZE);
+	std::memcpy(dest + PACKET_CHUNK_OVERHEAD, message + offset, payload_size);
+
+	return PACKET_CHUNK_OVERHEAD + payload_size;
+}
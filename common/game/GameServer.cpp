@@ -1,5 +1,6 @@
 #include "GameServer.h"
 #include "../utility/Defer.h"
+#include "../utility/Uid.h"
 
 constexpr uint64_t SERVER_ID_KEY = UINT64_MAX - 1;
 constexpr uint64_t UNIVERSAL_SESSION_INFO_KEY = UINT64_MAX;
@@ -34,6 +35,9 @@ void GameServer::GameServerWorker::OnSocketSessionConnected(SocketContext* conte
 			packet_recovery_minion_server_rq packet;
 			packet.server_info = _server->_my_server_info;
 
+			UseFrameArena(packet.sectors);
+			UseFrameArena(packet.intra_servers);
+
 			for (const auto& sector_pair : _server->_sector_posting_manager->GetOwnershipSectors(_server->_my_server_info.server_id))
 				packet.sectors.push_back(sector_pair.first);
 
@@ -56,9 +60,9 @@ void GameServer::GameServerWorker::OnSocketSessionConnected(SocketContext* conte
 		return;
 	}
 
-	uint64_t session_id = _server->_current_universal_session_id;
+	uint64_t session_id = UidGenerator::GetInstance()->Generate(UidType::Session);
 
-	UniversalSessionInfo& session_info = _server->_active_sessions[_server->_current_universal_session_id++];
+	UniversalSessionInfo& session_info = _server->_active_sessions[session_id];
 
 	session_info.session = context->session;
 	session_info.universal_session_id = session_id;
@@ -74,15 +78,16 @@ void GameServer::GameServerWorker::OnSocketSessionConnected(SocketContext* conte
 
 void GameServer::GameServerWorker::OnSocketSessionAccepted(SocketContext* context) 
 {
-	uint64_t session_id = _server->_current_universal_session_id;
+	bool is_client = context->session->GetNetworkEngine() == _server->_user_network_engine;
+	uint64_t session_id = UidGenerator::GetInstance()->Generate(is_client ? UidType::User : UidType::Session);
 
-	UniversalSessionInfo& session_info = _server->_active_sessions[_server->_current_universal_session_id++];
+	UniversalSessionInfo& session_info = _server->_active_sessions[session_id];
 	session_info.session = context->session;
 	session_info.universal_session_id = session_id;
 
 	context->session->SetUserData(UNIVERSAL_SESSION_INFO_KEY, &session_info);
 
-	if (context->session->GetNetworkEngine() == _server->_user_network_engine)
+	if (is_client)
 	{
 		if (!_server->_service_ready)
 		{
@@ -116,12 +121,15 @@ void GameServer::GameServerWorker::OnSocketSessionClosed(SocketContext* context)
 		return;
 	}
 
+	// resume every pending call on this link before the server is unset
+	_server->_call_manager->OnSessionClosed(context->session->GetSessionId());
+
 	IntraServerInfo* server_session = GetServerSession(session_info->session->GetUserData<uint64_t, uint64_t>(SERVER_ID_KEY));
 
 	if (server_session == nullptr)
 		return;
 
-	_server->_sector_posting_manager->UnsetAll(server_session->server_info.server_id);
+	_server->UnsetServer(server_session->server_info.server_id);
 
 	if (server_session->server_info.server_type == ServerType::Supervisor)
 	{
@@ -173,7 +181,7 @@ void GameServer::GameServerWorker::OnSocketSessionData(SocketContext* context)
 			return;
 		}
 
-		_server->OnClientData(session_info, context->header, context->buffer);
+		_server->DispatchClientData(session_info, context->header, context->buffer);
 		return;
 	}
 
@@ -212,7 +220,7 @@ void GameServer::GameServerWorker::OnSocketSessionData(SocketContext* context)
 		session_info->is_authorized = true;
 		server_session->is_authorized = true;
 
-		_server->_sector_posting_manager->LinkSession(packet.server_id, context->session);
+		_server->LinkServerSession(packet.server_id, context->session);
 
 		context->session->SetUserData(SERVER_ID_KEY, packet.server_id);
 		ListenSector(server_session->server_info.server_type, packet.server_id);
@@ -266,7 +274,7 @@ void GameServer::GameServerWorker::OnSocketSessionData(SocketContext* context)
 
 		context->session->SetUserData(SERVER_ID_KEY, packet.server_id);
 
-		_server->_sector_posting_manager->LinkSession(packet.server_id, context->session);
+		_server->LinkServerSession(packet.server_id, context->session);
 
 		ListenSector(server_session->server_info.server_type, packet.server_id);
 
@@ -286,10 +294,12 @@ void GameServer::GameServerWorker::OnSocketSessionData(SocketContext* context)
 		_server->_my_server_info = packet.server_info;
 		_server->_loopback_session->server_info = packet.server_info;
 
+		// loopback session is not thread safe, it is not mirrored to client shards
 		_server->_sector_posting_manager->LinkSession(packet.server_info.server_id, _server->_loopback_session->session);
-		_server->_current_universal_session_id = packet.server_info.server_id * 1000000000000000 + 100000000000001;
+		UidGenerator::GetInstance()->Initialize(packet.server_info.server_id);
 
-		_server->_service_ready = true;
+		// worker is not blocked while restarted server waits for uid time, see CompleteRegistration
+		_server->_uid_pending = true;
 		return;
 	}
 	case PacketType::packet_recovery_minion_server_rs:
@@ -332,7 +342,7 @@ void GameServer::GameServerWorker::OnSocketSessionData(SocketContext* context)
 
 			_server->_server_sessions.erase(leaved_server.server_id);
 
-			_server->_sector_posting_manager->UnsetAll(leaved_server.server_id);
+			_server->UnsetServer(leaved_server.server_id);
 		}
 
 		for (const ServerInfo& joined_server : packet.joined_server_info)
@@ -374,7 +384,7 @@ void GameServer::GameServerWorker::OnSocketSessionData(SocketContext* context)
 
 		for (const SectorAllocationInfo& info : packet.allocation_info)
 		{
-			_server->_sector_posting_manager->AllocateSector(info.sector_id, info.server_info.server_id);
+			_server->AllocateSector(info.sector_id, info.server_info.server_id);
 		}
 		
 		_server->OnSupervisorSectorAllocation(packet);
@@ -399,7 +409,36 @@ void GameServer::GameServerWorker::OnSocketSessionData(SocketContext* context)
 		return;
 	}
 
-	_server->OnIntraServerData(server_session, context->header, context->buffer);
+	if (_server->_call_manager->OnResponse(context->header, context->buffer.Data()))
+		return;
+
+	_server->DispatchIntraServerData(server_session, context->header, context->buffer);
+}
+
+void GameServer::DispatchClientData(UniversalSessionInfo* const client_session, const PacketHeader& header, const DynamicBufferCursor<SocketBuffer>& buffer)
+{
+	switch (_client_packet_dispatcher.Dispatch(client_session, header, buffer))
+	{
+	case PacketDispatchResult::Unregistered:
+		OnClientData(client_session, header, buffer);
+		break;
+	case PacketDispatchResult::DeserializeFailed:
+		HandlePacketDeserializeError(client_session, header.packet_type);
+		break;
+	}
+}
+
+void GameServer::DispatchIntraServerData(IntraServerInfo* const server_session, const PacketHeader& header, const DynamicBufferCursor<SocketBuffer>& buffer)
+{
+	switch (_intra_server_packet_dispatcher.Dispatch(server_session, header, buffer))
+	{
+	case PacketDispatchResult::Unregistered:
+		OnIntraServerData(server_session, header, buffer);
+		break;
+	case PacketDispatchResult::DeserializeFailed:
+		HandlePacketDeserializeError(server_session, header.packet_type);
+		break;
+	}
 }
 
 bool GameServer::Initialize(const ServerType my_server_type, const SocketAddress& my_intra_server_address, NetworkEngine* const intra_network_engine, NetworkEngine* const user_network_engine, const std::vector<IntraServerConfig>& intra_server_config, const SocketAddress& supervisor_address, const GameConfig& game_config)
@@ -412,6 +451,8 @@ bool GameServer::Initialize(const ServerType my_server_type, const SocketAddress
 
 	_packet_throttler = new PacketThrottler(utility::Milliseconds(game_config.packet_batch_process_time_ms));
 	_sector_posting_manager = new SectorPostingManager(_packet_throttler);
+	_call_manager = new IntraCallManager();
+	_packet_frame_pool = new SharedObjectPool<SharedPacketFrame>(PACKET_FRAME_POOL_SIZE, 64, 0, 1, 64);
 
 	_user_network_engine = user_network_engine;
 	_intra_network_engine = intra_network_engine;
@@ -450,15 +491,34 @@ void GameServer::GameServerWorker::ProcessLoopbackData(SocketBuffer* const buffe
 
 	while (cursor.RemainBytes() >= PACKET_HEADER_SIZE)
 	{
+		PacketLengthType packet_length;
+		std::memcpy(&packet_length, cursor.Data(), PACKET_LENGTH_SIZE);
+
 		cursor.Seek(PACKET_LENGTH_SIZE);
 
 		PacketHeader header = DeserializePacketHeader(cursor.Data(), buffer->capacity - cursor.Cursor());
 
 		cursor.Seek(PACKET_HEADER_SIZE);
 
-		_server->OnIntraServerData(_server->_loopback_session, header, cursor);
+		// loopback frames are written by this process
+		if (!ReadPacketExtensions(header, cursor.Data() + header.body_size, packet_length - PACKET_HEADER_SIZE - header.body_size))
+			assert(false);
+
+		if (header.packet_type == PacketType::packet_chunk_ps)
+		{
+			PacketHeader message_header;
+			DynamicBufferCursor<SocketBuffer> message(nullptr);
+
+			PacketChunkResult result = _chunk_assembler.Append(_server->_loopback_session->session->GetSessionId(), cursor.Data(), header.body_size, message_header, message);
+			assert(result != PacketChunkResult::Corrupted);
 
-		cursor.Seek(header.body_size);
+			if (result == PacketChunkResult::Completed && !_server->_call_manager->OnResponse(message_header, message.Data()))
+				_server->DispatchIntraServerData(_server->_loopback_session, message_header, message);
+		}
+		else if (!_server->_call_manager->OnResponse(header, cursor.Data()))
+			_server->DispatchIntraServerData(_server->_loopback_session, header, cursor);
+
+		cursor.Seek(packet_length - PACKET_HEADER_SIZE);
 	}
 
 	assert(cursor.RemainBytes() == 0);
@@ -473,7 +533,7 @@ void GameServer::Reset()
 		if (pair.second.socket_connector_id > 0)
 			_intra_network_engine->UnregisterConnectorSocket(pair.second.socket_connector_id);
 
-		_sector_posting_manager->UnsetAll(pair.second.server_info.server_id);
+		UnsetServer(pair.second.server_info.server_id);
 	}
 
 	for (const auto& pair : _active_sessions)
@@ -481,14 +541,231 @@ void GameServer::Reset()
 		pair.second.session->CloseSession();
 	}
 
+	PostToClientShards([](ClientShard* const shard) {
+		shard->CloseAll();
+		shard->_server_info = {};
+	});
+
 	_active_sessions.clear();
 	_server_sessions.clear();
 
 	_sector_posting_manager->UnsetAll(_my_server_info.server_id);
 	
 	_service_ready = false;
+	_uid_pending = false;
 
 	OnSupervisorResetMinionServer();
 
 	_server_sessions[SUPERVISOR_SERVER_ID] = _supervisor_server_info;
+}
+
+void GameServer::TryCompleteRegistration()
+{
+	if (!_uid_pending || !UidGenerator::GetInstance()->IsReady())
+		return;
+
+	_uid_pending = false;
+
+	// shards read their own copy, server info of game worker is rewritten on reset
+	PostToClientShards([server_info = _my_server_info](ClientShard* const shard) {
+		shard->_server_info = server_info;
+	});
+
+	_service_ready = true;
+}
+
+void GameServer::LinkServerSession(const uint64_t server_id, const SocketSessionPtr& session)
+{
+	_sector_posting_manager->LinkSession(server_id, session);
+
+	PostToClientShards([server_id, session](ClientShard* const shard) {
+		shard->GetSectorPostingManager()->LinkSession(server_id, session);
+	});
+}
+
+void GameServer::UnsetServer(const uint64_t server_id)
+{
+	_sector_posting_manager->UnsetAll(server_id);
+
+	PostToClientShards([server_id](ClientShard* const shard) {
+		shard->GetSectorPostingManager()->UnsetAll(server_id);
+	});
+}
+
+void GameServer::AllocateSector(const uint64_t sector_id, const uint64_t server_id)
+{
+	_sector_posting_manager->AllocateSector(sector_id, server_id);
+
+	PostToClientShards([sector_id, server_id](ClientShard* const shard) {
+		shard->GetSectorPostingManager()->AllocateSector(sector_id, server_id);
+	});
+}
+
+void GameServer::ProcessMailbox()
+{
+	_mailbox.Drain(_tasks);
+
+	for (std::function<void()>& task : _tasks)
+		task();
+
+	_tasks.clear();
+}
+
+std::vector<NetworkEngineWorker*> GameServer::CreateClientShards(const uint32_t shard_count, const utility::Milliseconds packet_batch_process_time)
+{
+	std::vector<NetworkEngineWorker*> workers;
+
+	if (!_client_shards.empty())
+		return workers;
+
+	// shard index is lane of its client session ids, so a shard is found again from id
+	UidGenerator::GetInstance()->ReserveLanes(shard_count);
+
+	for (uint32_t shard_index = 0; shard_index < shard_count; shard_index++)
+	{
+		ClientShard* shard = new ClientShard(this, shard_index, packet_batch_process_time);
+
+		_client_shards.push_back(shard);
+		workers.push_back(shard);
+	}
+
+	return workers;
+}
+
+ClientShard* GameServer::GetClientShard(const uint64_t universal_session_id)
+{
+	if (_client_shards.empty())
+		return nullptr;
+
+	return _client_shards[UidGenerator::Decode(universal_session_id).lane % _client_shards.size()];
+}
+
+void GameServer::PostToClientShard(const uint64_t universal_session_id, ClientShard::Task&& task)
+{
+	ClientShard* shard = GetClientShard(universal_session_id);
+	if (shard == nullptr)
+	{
+		LOG(LogLevel::Warn, "client shard not found %llu", universal_session_id);
+		return;
+	}
+
+	shard->Post(std::move(task));
+}
+
+void GameServer::PostToClientShards(const ClientShard::Task& task)
+{
+	for (ClientShard* const shard : _client_shards)
+		shard->Post(ClientShard::Task(task));
+}
+
+void GameServer::PostToGameServer(std::function<void()>&& task)
+{
+	_mailbox.Post(std::move(task));
+}
+
+PacketFrame GameServer::AcquirePacketFrame()
+{
+	PacketFrame frame = _packet_frame_pool->Pop();
+	if (frame.Valid())
+		return frame;
+
+	// pool is exhausted only by a stalled shard, the frame is freed instead of pooled
+	return PacketFrame(new SharedPacketFrame(), [](SharedPacketFrame* const ptr) { delete ptr; });
+}
+
+ClientShard::ClientShard(GameServer* const server, const uint32_t shard_index, const utility::Milliseconds packet_batch_process_time)
+	: _server(server), _shard_index(shard_index)
+{
+	_packet_throttler = new PacketThrottler(packet_batch_process_time);
+	_sector_posting_manager = new SectorPostingManager(_packet_throttler);
+	_snapshot_replicator = new SnapshotReplicator(_sector_posting_manager, _packet_throttler);
+}
+
+void ClientShard::ProcessMailbox()
+{
+	_mailbox.Drain(_tasks);
+
+	for (Task& task : _tasks)
+		task(this);
+
+	_tasks.clear();
+}
+
+void ClientShard::CloseAll()
+{
+	for (const auto& pair : _active_sessions)
+		pair.second.session->CloseSession();
+}
+
+void ClientShard::OnSocketSessionAccepted(SocketContext* context)
+{
+	if (!_server->_service_ready || _server_info.server_id == 0)
+	{
+		context->session->CloseSession();
+		return;
+	}
+
+	uint64_t session_id = UidGenerator::GetInstance()->Generate(UidType::User, _shard_index);
+
+	UniversalSessionInfo& session_info = _active_sessions[session_id];
+	session_info.session = context->session;
+	session_info.universal_session_id = session_id;
+	session_info.shard = this;
+	session_info.is_client = true;
+
+	context->session->SetUserData(UNIVERSAL_SESSION_INFO_KEY, &session_info);
+	context->session->SetCoalescingProfile(CoalescingProfile::LowLatency);
+
+	_server->OnClientAccepted(&session_info);
+}
+
+void ClientShard::OnSocketSessionClosed(SocketContext* context)
+{
+	UniversalSessionInfo* session_info = context->session->GetUserData<uint64_t, UniversalSessionInfo*>(UNIVERSAL_SESSION_INFO_KEY);
+
+	if (session_info == nullptr)
+		return;
+
+	_packet_throttler->CleanUp(context->session);
+
+	DEFER({ _active_sessions.erase(session_info->universal_session_id); });
+
+	_sector_posting_manager->UnsetAll(session_info->universal_session_id);
+	_snapshot_replicator->RemoveClient(session_info->universal_session_id);
+
+	_server->OnClientClosed(session_info);
+}
+
+void ClientShard::OnSocketSessionAbandoned(SocketContext* context)
+{
+	UniversalSessionInfo* session_info = context->session->GetUserData<uint64_t, UniversalSessionInfo*>(UNIVERSAL_SESSION_INFO_KEY);
+
+	if (session_info == nullptr)
+		return;
+
+	_server->OnClientAbandoned(session_info);
+}
+
+void ClientShard::OnSocketSessionAlived(SocketContext* context)
+{
+	UniversalSessionInfo* session_info = context->session->GetUserData<uint64_t, UniversalSessionInfo*>(UNIVERSAL_SESSION_INFO_KEY);
+
+	if (session_info == nullptr)
+		return;
+
+	_server->OnClientAlived(session_info);
+}
+
+void ClientShard::OnSocketSessionData(SocketContext* context)
+{
+	UniversalSessionInfo* session_info = context->session->GetUserData<uint64_t, UniversalSessionInfo*>(UNIVERSAL_SESSION_INFO_KEY);
+
+	// session closed on accept has no info, shard is ready once its own server info arrived
+	if (session_info == nullptr || _server_info.server_id == 0)
+	{
+		context->session->CloseSession();
+		return;
+	}
+
+	_server->DispatchClientData(session_info, context->header, context->buffer);
 }
\ No newline at end of file
@@ -2,9 +2,17 @@
 
 #include "../engine/NetworkEngine.h"
 #include "SectorPostingManager.h"
+#include "SectorSnapshot.h"
+#include "../engine/IntraCall.h"
+#include "../engine/PacketDispatcher.h"
+#include "../concurrent/Mailbox.h"
+#include <functional>
 
 constexpr uint64_t SUPERVISOR_SERVER_ID = 1;
 
+// broadcast frames alive at once, a frame lives until every shard has stored it
+constexpr uint32_t PACKET_FRAME_POOL_SIZE = 4096;
+
 enum class IntraServerConnectionPolicy
 {
 	All,
@@ -26,11 +34,17 @@ struct IntraServerConfig
 	IntraServerSectorListeningPolicy sector_listening_policy;
 };
 
+class GameServer;
+class ClientShard;
+
 struct UniversalSessionInfo
 {
 	uint64_t universal_session_id = 0;
 	SocketSessionPtr session = SocketSessionPtr(nullptr);
 
+	// owner shard of client session, nullptr if handled by game worker
+	ClientShard* shard = nullptr;
+
 	bool is_authorized = false;
 	bool is_client = false;
 
@@ -44,6 +58,101 @@ struct IntraServerInfo : public UniversalSessionInfo
 	bool is_connector = false;
 };
 
+// client session logic shard
+// client session is hashed to one shard by network engine and only touched by that shard thread,
+// intra server state is owned by game worker and reaches shards through mailbox
+class ClientShard : public NetworkEngineWorker
+{
+public:
+	using Task = std::function<void(ClientShard* const)>;
+
+private:
+	GameServer* _server;
+	uint32_t _shard_index;
+
+	// copy of registered server info, written through mailbox only, server id 0 until registered
+	ServerInfo _server_info = {};
+
+	// key: universal session id
+	std::unordered_map<uint64_t, UniversalSessionInfo> _active_sessions;
+
+	PacketThrottler* _packet_throttler;
+
+	// client listeners of this shard and mirrored sector ownership
+	SectorPostingManager* _sector_posting_manager;
+
+	// per client snapshot baselines of sector listeners
+	SnapshotReplicator* _snapshot_replicator;
+
+	Mailbox<Task> _mailbox;
+	std::vector<Task> _tasks;
+
+	void ProcessMailbox();
+
+public:
+	ClientShard(GameServer* const server, const uint32_t shard_index, const utility::Milliseconds packet_batch_process_time);
+
+	void Post(Task&& task)
+	{
+		_mailbox.Post(std::move(task));
+	}
+
+	uint32_t GetShardIndex() const
+	{
+		return _shard_index;
+	}
+
+	const ServerInfo& GetServerInfo() const
+	{
+		return _server_info;
+	}
+
+	PacketThrottler* GetPacketThrottler()
+	{
+		return _packet_throttler;
+	}
+
+	SectorPostingManager* GetSectorPostingManager()
+	{
+		return _sector_posting_manager;
+	}
+
+	SnapshotReplicator* GetSnapshotReplicator()
+	{
+		return _snapshot_replicator;
+	}
+
+	UniversalSessionInfo* GetClientSession(const uint64_t universal_session_id)
+	{
+		auto iterator = _active_sessions.find(universal_session_id);
+
+		return iterator == _active_sessions.end() ? nullptr : &iterator->second;
+	}
+
+	void CloseAll();
+
+	virtual void OnSocketSessionAccepted(SocketContext* context) override;
+	virtual void OnSocketSessionAbandoned(SocketContext* context) override;
+	virtual void OnSocketSessionAlived(SocketContext* context) override;
+	virtual void OnSocketSessionClosed(SocketContext* context) override;
+	virtual void OnSocketSessionData(SocketContext* context) override;
+
+	virtual bool Update(const WorkerTimeUnit current_time, const WorkerTimeUnit delta_time) override
+	{
+		_packet_throttler->ForceFlushPacket();
+
+		return true;
+	}
+
+	virtual void UpdateEveryTick(const WorkerTimeUnit current_time) override
+	{
+		ProcessMailbox();
+		_packet_throttler->TryFlushPacket();
+	}
+
+	friend GameServer;
+};
+
 class GameServer
 {
 private:
@@ -114,7 +223,12 @@ private:
 
 		virtual void UpdateEveryTick(const WorkerTimeUnit current_time) override
 		{
-			_server->_current_epoch_timestamp = utility::CurrentTimeEpoch<utility::Milliseconds>();
+			_server->_current_epoch_timestamp = utility::CoarseTimeEpoch<utility::Milliseconds>();
+
+			_server->TryCompleteRegistration();
+
+			_server->ProcessMailbox();
+			_server->_call_manager->Update(current_time);
 			_server->UpdateEveryTick(current_time);
 			_server->_packet_throttler->TryFlushPacket();
 			static_cast<LoopbackSocketSession<GameServerWorker>*>(_server->_loopback_session->session._UnsafePtr())->ProcessLoopbackPacket();
@@ -123,12 +237,28 @@ private:
 
 	void Reset();
 
+	// apply to game worker and mirror to every client shard
+	void LinkServerSession(const uint64_t server_id, const SocketSessionPtr& session);
+	void UnsetServer(const uint64_t server_id);
+	void AllocateSector(const uint64_t sector_id, const uint64_t server_id);
+
+	void ProcessMailbox();
+
+	// registered handler first, OnClientData/OnIntraServerData for packet without handler
+	void DispatchClientData(UniversalSessionInfo* const client_session, const PacketHeader& header, const DynamicBufferCursor<SocketBuffer>& buffer);
+	void DispatchIntraServerData(IntraServerInfo* const server_session, const PacketHeader& header, const DynamicBufferCursor<SocketBuffer>& buffer);
+
 	IntraServerInfo* _loopback_session = nullptr;
 	uint64_t _loopback_session_id = 1;
 
-protected:
-	uint64_t _current_universal_session_id = 100;
+	std::vector<ClientShard*> _client_shards;
+
+	Mailbox<std::function<void()>> _mailbox;
+	std::vector<std::function<void()>> _tasks;
+
+	friend ClientShard;
 
+protected:
 	IntraServerInfo _supervisor_server_info;
 	ServerInfo _my_server_info;
 
@@ -148,11 +278,26 @@ protected:
 
 	SectorPostingManager* _sector_posting_manager = nullptr;
 
+	// broadcast frames shared by client shards, returned to pool by last shard
+	SharedObjectPool<SharedPacketFrame>* _packet_frame_pool = nullptr;
+
+	// intra server request/response, game worker only
+	IntraCallManager* _call_manager = nullptr;
+
+	// register handlers before network engines start, client handlers run on client shard threads
+	PacketDispatcher<UniversalSessionInfo*> _client_packet_dispatcher;
+	PacketDispatcher<IntraServerInfo*> _intra_server_packet_dispatcher;
+
 	GameConfig _game_config;
 
 	utility::Milliseconds _current_epoch_timestamp;
 
-	bool _service_ready = false;
+	std::atomic<bool> _service_ready = false;
+
+	// registered, service is ready once uid generator is, checked every tick by game worker
+	bool _uid_pending = false;
+
+	void TryCompleteRegistration();
 public:
 
 	GameServer();
@@ -174,6 +319,29 @@ public:
 		return _worker;
 	}
 
+	// call before user network engine is initialized, returned workers are passed to the engine
+	std::vector<NetworkEngineWorker*> CreateClientShards(const uint32_t shard_count, const utility::Milliseconds packet_batch_process_time);
+
+	ClientShard* GetClientShard(const uint64_t universal_session_id);
+
+	void PostToClientShard(const uint64_t universal_session_id, ClientShard::Task&& task);
+	void PostToClientShards(const ClientShard::Task& task);
+	void PostToGameServer(std::function<void()>&& task);
+
+	PacketFrame AcquirePacketFrame();
+
+	// serialize once in caller thread and post to sector listeners of every client shard
+	template <NetworkPacketConcept Packet>
+	void BroadcastToClientSector(const Packet& packet, const uint64_t sector_id, const uint64_t ignored_target = 0)
+	{
+		PacketFrame frame = AcquirePacketFrame();
+		SerializePacketFrame(packet, ErrorCode::None, frame->data);
+
+		PostToClientShards([frame, sector_id, ignored_target](ClientShard* const shard) {
+			shard->GetSectorPostingManager()->SendFrameToSector(frame, sector_id, ignored_target);
+		});
+	}
+
 	virtual void OnSupervisorRegisteredMinionServer(const ServerInfo& my_server_info) {}
 	virtual void OnSupervisorResetMinionServer() {}
 
@@ -198,28 +366,14 @@ public:
 	virtual void UpdateEveryTick(const WorkerTimeUnit current_time) {}
 };
 
-template <NetworkPacketConcept T>
-void HandlePacketDeserializeError(UniversalSessionInfo* const session_info)
+inline void HandlePacketDeserializeError(UniversalSessionInfo* const session_info, const PacketType packet_type)
 {
-	// constexpr std::string    Ÿ ڿ ȯ
-	// constexpr
-	std::string format_string = std::string("failed to deserialize ") + typeid(T).name() + " packet, session: %llu";
-
-	LOG(LogLevel::Warn, format_string.c_str(), session_info->universal_session_id);
+	LOG(LogLevel::Warn, "failed to deserialize %s packet, session: %llu", GetPacketTraits(packet_type).name.data(), session_info->universal_session_id);
 	session_info->session->CloseSession();
 }
 
-#pragma warning ( disable : 5103 )
-
-#define PACKET_CASE(session, packet_type, handler) \
-	case PacketType::##packet_type##:\
-	{\
-		packet_type packet;\
-		if (!DeserializePacketBody(buffer.Data(), header.body_size, packet))\
-		{\
-			HandlePacketDeserializeError<decltype(packet)>(session);\
-			return;\
-		}\
-		handler##(session, header, packet);\
-		break;\
-	}
\ No newline at end of file
+template <NetworkPacketConcept T>
+void HandlePacketDeserializeError(UniversalSessionInfo* const session_info)
+{
+	HandlePacketDeserializeError(session_info, T::PACKET_TYPE);
+}
\ No newline at end of file
@@ -1,79 +1,161 @@
 #include "SectorPostingManager.h"
 
+void SectorPostingManager::PostFrameToSector(const uint8_t* const frame, const uint32_t frame_size, const uint64_t sector_id, const uint64_t ignored_target, const bool with_owner)
+{
+	auto sector_iterator = _sectors.find(sector_id);
+	if (sector_iterator == _sectors.end())
+		return;
+
+	for (const SectorListener& listener : sector_iterator->second.listening_sessions)
+	{
+		if (listener.target_id == ignored_target)
+			continue;
+
+		NetworkSessionInfo* session_info = _sessions.Find(listener.session_handle);
+		if (session_info != nullptr && session_info->session.Valid())
+			_packet_throttler->PostSerializedPacket(session_info->session, frame, frame_size, PacketPostingPolicy::Throttle);
+	}
+
+	if (!with_owner)
+		return;
+
+	NetworkSessionInfo* session_info = FindSession(sector_iterator->second.owner_id);
+	if (session_info != nullptr && session_info->session.Valid())
+		_packet_throttler->PostSerializedPacket(session_info->session, frame, frame_size, PacketPostingPolicy::Throttle);
+}
+
+utility::SlotHandle SectorPostingManager::AcquireSession(const uint64_t target_id)
+{
+	auto handle_iterator = _session_handles.find(target_id);
+	if (handle_iterator != _session_handles.end())
+		return handle_iterator->second;
+
+	utility::SlotHandle handle = _sessions.Emplace();
+	_session_handles[target_id] = handle;
+
+	return handle;
+}
+
+static void EraseListener(NetworkSectorInfo* const sector_info, const uint64_t target_id)
+{
+	std::vector<SectorListener>& listeners = sector_info->listening_sessions;
+
+	for (std::size_t index = 0; index < listeners.size(); index++)
+	{
+		if (listeners[index].target_id != target_id)
+			continue;
+
+		listeners[index] = listeners.back();
+		listeners.pop_back();
+
+		return;
+	}
+}
+
 void SectorPostingManager::AllocateSector(const uint64_t sector_id, const uint64_t target_id)
 {
 	NetworkSectorInfo& sector_info = _sectors[sector_id];
 
 	if (sector_info.owner_id != 0)
-		_sessions[sector_info.owner_id].related_sectors.erase(sector_id);
+	{
+		NetworkSessionInfo* owner_info = FindSession(sector_info.owner_id);
+		if (owner_info != nullptr)
+			owner_info->related_sectors.erase(sector_id);
+	}
 
-	NetworkSessionInfo& session_info = _sessions[target_id];
+	NetworkSessionInfo* session_info = _sessions.Find(AcquireSession(target_id));
 
-	session_info.related_sectors[sector_id] = &sector_info;
+	session_info->related_sectors[sector_id] = &sector_info;
 	sector_info.owner_id = target_id;
 }
 
 void SectorPostingManager::LinkSession(const uint64_t target_id, const SocketSessionPtr& session)
 {
-	_sessions[target_id].session = session;
+	_sessions.Find(AcquireSession(target_id))->session = session;
 }
 
 void SectorPostingManager::UnlinkSession(const uint64_t target_id)
 {
-	NetworkSessionInfo& session_info = _sessions[target_id];
+	NetworkSessionInfo* session_info = FindSession(target_id);
 
-	if (!session_info.session.Valid())
+	if (session_info == nullptr || !session_info->session.Valid())
 		return;
 
-	_packet_throttler->CleanUp(session_info.session);
-	session_info.session.Release();
+	_packet_throttler->CleanUp(session_info->session);
+	session_info->session.Release();
 }
 
 void SectorPostingManager::AddSectorListener(const uint64_t sector_id, const uint64_t target_id)
 {
 	NetworkSectorInfo& sector_info = _sectors[sector_id];
 
-	NetworkSessionInfo& session_info = _sessions[target_id];
+	utility::SlotHandle session_handle = AcquireSession(target_id);
 
-	session_info.related_sectors[sector_id] = &sector_info;
+	_sessions.Find(session_handle)->related_sectors[sector_id] = &sector_info;
 
-	sector_info.listening_sessions[target_id] = &session_info;
+	for (SectorListener& listener : sector_info.listening_sessions)
+	{
+		if (listener.target_id == target_id)
+		{
+			listener.session_handle = session_handle;
+			return;
+		}
+	}
+
+	sector_info.listening_sessions.push_back({ target_id, session_handle });
 }
 
 void SectorPostingManager::RemoveSectorListener(const uint64_t sector_id, const uint64_t target_id)
 {
-	NetworkSessionInfo& session_info = _sessions[target_id];
+	NetworkSessionInfo* session_info = FindSession(target_id);
+	if (session_info == nullptr)
+		return;
 
-	for (auto& sector_pair : session_info.related_sectors)
-		sector_pair.second->listening_sessions.erase(target_id);
+	for (auto& sector_pair : session_info->related_sectors)
+		EraseListener(sector_pair.second, target_id);
 }
 
 void SectorPostingManager::UnsetAll(const uint64_t target_id)
 {
-	NetworkSessionInfo& session_info = _sessions[target_id];
+	auto handle_iterator = _session_handles.find(target_id);
+	if (handle_iterator == _session_handles.end())
+		return;
 
-	for (auto& sector_pair : session_info.related_sectors)
+	NetworkSessionInfo* session_info = _sessions.Find(handle_iterator->second);
+
+	for (auto& sector_pair : session_info->related_sectors)
 	{
-		sector_pair.second->listening_sessions.erase(target_id);
+		EraseListener(sector_pair.second, target_id);
 		if (sector_pair.second->owner_id == target_id)
 			sector_pair.second->owner_id = 0;
 	}
 
-	session_info.related_sectors.clear();
+	if (session_info->session.Valid())
+		_packet_throttler->CleanUp(session_info->session);
 
-	UnlinkSession(target_id);
+	// handles still held elsewhere become stale
+	_sessions.Erase(handle_iterator->second);
+	_session_handles.erase(handle_iterator);
 }
 
 const SocketSessionPtr& SectorPostingManager::GetSectorOwnerSession(const uint64_t sector_id)
 {
-	NetworkSectorInfo& sector_info = _sectors[sector_id];
-	NetworkSessionInfo& session_info = _sessions[sector_info.owner_id];
+	static const SocketSessionPtr empty_session = SocketSessionPtr(nullptr);
 
-	return session_info.session;
+	auto sector_iterator = _sectors.find(sector_id);
+	if (sector_iterator == _sectors.end())
+		return empty_session;
+
+	NetworkSessionInfo* session_info = FindSession(sector_iterator->second.owner_id);
+
+	return session_info == nullptr ? empty_session : session_info->session;
 }
 
 const std::unordered_map<uint64_t, NetworkSectorInfo*>& SectorPostingManager::GetOwnershipSectors(const uint64_t target_id)
 {
-	NetworkSessionInfo& session_info = _sessions[target_id];
-	return session_info.related_sectors;
+	static const std::unordered_map<uint64_t, NetworkSectorInfo*> empty_sectors;
+
+	NetworkSessionInfo* session_info = FindSession(target_id);
+
+	return session_info == nullptr ? empty_sectors : session_info->related_sectors;
 }
\ No newline at end of file
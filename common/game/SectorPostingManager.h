@@ -3,15 +3,26 @@
 #include "coordinate/SectorGrid.h"
 #include "../engine/PacketThrottler.h"
 #include "../engine/SocketSession.h"
+#include "../utility/SlotMap.h"
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
+#include <cassert>
 
-struct NetworkSessionInfo;
+struct SectorListener
+{
+	uint64_t target_id;
+
+	// stale once target is unset, fan-out skips it
+	utility::SlotHandle session_handle;
+};
 
 struct NetworkSectorInfo
 {
 	uint64_t owner_id = 0;
-	std::unordered_map<uint64_t, NetworkSessionInfo*> listening_sessions;
+
+	// contiguous for broadcast fan-out, unordered (swap and pop on remove)
+	std::vector<SectorListener> listening_sessions;
 };
 
 struct NetworkSessionInfo
@@ -25,10 +36,49 @@ class SectorPostingManager
 private:
 	std::unordered_map<uint64_t, NetworkSectorInfo> _sectors;
 
-	std::unordered_map<uint64_t, NetworkSessionInfo> _sessions;
+	// dense session infos, listeners reach them by handle without hashing target id
+	utility::SlotMap<NetworkSessionInfo> _sessions;
+	std::unordered_map<uint64_t, utility::SlotHandle> _session_handles;
 
 	PacketThrottler* _packet_throttler;
 
+	// broadcast packet is serialized once here and copied to every listener batch
+	std::vector<uint8_t> _frame_buffer;
+
+	template <NetworkPacketConcept Packet>
+	uint32_t SerializeFrame(const Packet& packet)
+	{
+		uint32_t needed_size = PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE + GetPacketBodySize(packet) + MAX_PACKET_EXTENSION_SIZE;
+		if (_frame_buffer.size() < needed_size)
+			_frame_buffer.resize(needed_size);
+
+		uint32_t frame_size = 0;
+		if (!SerializePacket(packet, ErrorCode::None, _frame_buffer.data(), needed_size, frame_size))
+			assert(false);
+
+		return frame_size;
+	}
+
+	bool HasListener(const uint64_t sector_id, const bool with_owner)
+	{
+		auto sector_iterator = _sectors.find(sector_id);
+		if (sector_iterator == _sectors.end())
+			return false;
+
+		return !sector_iterator->second.listening_sessions.empty() || (with_owner && sector_iterator->second.owner_id != 0);
+	}
+
+	void PostFrameToSector(const uint8_t* const frame, const uint32_t frame_size, const uint64_t sector_id, const uint64_t ignored_target, const bool with_owner);
+
+	NetworkSessionInfo* FindSession(const uint64_t target_id)
+	{
+		auto handle_iterator = _session_handles.find(target_id);
+
+		return handle_iterator == _session_handles.end() ? nullptr : _sessions.Find(handle_iterator->second);
+	}
+
+	utility::SlotHandle AcquireSession(const uint64_t target_id);
+
 public:
 	SectorPostingManager(PacketThrottler* const packet_throttler) : _packet_throttler(packet_throttler) {}
 
@@ -37,50 +87,44 @@ public:
 	{
 		std::array<uint64_t, 3> sectors = GetNearSectors(sector_id, direction);
 
+		uint32_t frame_size = 0;
+
 		for (const uint64_t near_sector_id : sectors)
 		{
 			if (near_sector_id == INVALID_SECTOR)
 				break;
 
-			SendToSector(packet, near_sector_id, with_owner);
+			if (!HasListener(near_sector_id, with_owner))
+				continue;
+
+			if (frame_size == 0)
+				frame_size = SerializeFrame(packet);
+
+			PostFrameToSector(_frame_buffer.data(), frame_size, near_sector_id, 0, with_owner);
 		}
 	}
 
 	template <NetworkPacketConcept Packet>
 	void SendToSector(const Packet& packet, const uint64_t sector_id, bool with_owner = false)
 	{
-		auto sector_iterator = _sectors.find(sector_id);
-		if (sector_iterator == _sectors.end())
+		if (!HasListener(sector_id, with_owner))
 			return;
 
-		for (auto& session_pair : sector_iterator->second.listening_sessions)
-		{
-			if (session_pair.second->session.Valid())
-				_packet_throttler->PostPacket(session_pair.second->session, packet, PacketPostingPolicy::Throttle);
-		}
-
-		if (with_owner)
-			SendToSectorOwner(packet, sector_id);
+		PostFrameToSector(_frame_buffer.data(), SerializeFrame(packet), sector_id, 0, with_owner);
 	}
 
 	template <NetworkPacketConcept Packet>
 	void SendToSectorWithout(const uint64_t ignored_target, const Packet& packet, const uint64_t sector_id, bool with_owner = false)
 	{
-		auto sector_iterator = _sectors.find(sector_id);
-		if (sector_iterator == _sectors.end())
+		if (!HasListener(sector_id, with_owner))
 			return;
 
-		for (auto& session_pair : sector_iterator->second.listening_sessions)
-		{
-			if (session_pair.first == ignored_target)
-				continue;
-
-			if (session_pair.second->session.Valid())
-				_packet_throttler->PostPacket(session_pair.second->session, packet, PacketPostingPolicy::Throttle);
-		}
+		PostFrameToSector(_frame_buffer.data(), SerializeFrame(packet), sector_id, ignored_target, with_owner);
+	}
 
-		if (with_owner)
-			SendToSectorOwner(packet, sector_id);
+	void SendFrameToSector(const PacketFrame& frame, const uint64_t sector_id, const uint64_t ignored_target = 0)
+	{
+		PostFrameToSector(frame->data.data(), static_cast<uint32_t>(frame->data.size()), sector_id, ignored_target, false);
 	}
 
 	template <NetworkPacketConcept Packet>
@@ -90,17 +134,17 @@ public:
 		if (sector_iterator == _sectors.end())
 			return;
 
-		auto session_iterator = _sessions.find(sector_iterator->second.owner_id);
-		if (session_iterator != _sessions.end() && session_iterator->second.session.Valid())
-			_packet_throttler->PostPacket(session_iterator->second.session, packet, PacketPostingPolicy::Throttle);
+		NetworkSessionInfo* session_info = FindSession(sector_iterator->second.owner_id);
+		if (session_info != nullptr && session_info->session.Valid())
+			_packet_throttler->PostPacket(session_info->session, packet, PacketPostingPolicy::Throttle);
 	}
 
 	template <NetworkPacketConcept Packet>
-	void SendTo(const uint64_t target_id, const Packet& packet)
+	void SendTo(const uint64_t target_id, const Packet& packet, const ErrorCode error = ErrorCode::None, const uint32_t correlation_id = 0)
 	{
-		auto session_iterator = _sessions.find(target_id);
-		if (session_iterator != _sessions.end() && session_iterator->second.session.Valid())
-			_packet_throttler->PostPacket(session_iterator->second.session, packet, PacketPostingPolicy::Throttle);
+		NetworkSessionInfo* session_info = FindSession(target_id);
+		if (session_info != nullptr && session_info->session.Valid())
+			_packet_throttler->PostPacket(session_info->session, packet, PacketPostingPolicy::Throttle, error, correlation_id);
 	}
 
 
@@ -117,6 +161,20 @@ public:
 
 	const SocketSessionPtr& GetSectorOwnerSession(const uint64_t sector_id);
 
+	// nullptr if sector has no listener
+	const std::vector<SectorListener>* GetSectorListeners(const uint64_t sector_id) const
+	{
+		auto sector_iterator = _sectors.find(sector_id);
+
+		return sector_iterator == _sectors.end() || sector_iterator->second.listening_sessions.empty() ? nullptr : &sector_iterator->second.listening_sessions;
+	}
+
+	// nullptr if handle of listener is stale
+	const NetworkSessionInfo* GetListenerSession(const SectorListener& listener) const
+	{
+		return _sessions.Find(listener.session_handle);
+	}
+
 	const std::unordered_map<uint64_t, NetworkSectorInfo*>& GetOwnershipSectors(const uint64_t target_id);
 
 };
\ No newline at end of file
@@ -0,0 +1,227 @@
+#include "SectorSnapshot.h"
+
+void MakeSectorSnapshotPacket(const SectorSnapshot* const baseline, const SectorSnapshot& current, packet_sector_snapshot_ps& packet)
+{
+	packet.sector_id = current.sector_id;
+	packet.sequence = current.sequence;
+	packet.baseline_sequence = baseline == nullptr ? 0 : baseline->sequence;
+	packet.removed_object_ids.clear();
+
+	std::vector<PacketObjectInfo> changed_objects;
+
+	if (baseline == nullptr)
+	{
+		changed_objects = current.objects;
+	}
+	else
+	{
+		// both lists are sorted by object id
+		auto base = baseline->objects.begin();
+		auto now = current.objects.begin();
+
+		while (base != baseline->objects.end() || now != current.objects.end())
+		{
+			if (now == current.objects.end() || (base != baseline->objects.end() && base->object_id < now->object_id))
+			{
+				packet.removed_object_ids.push_back(base->object_id);
+				++base;
+			}
+			else if (base == baseline->objects.end() || now->object_id < base->object_id)
+			{
+				changed_objects.push_back(*now);
+				++now;
+			}
+			else
+			{
+				if (!IsSameReplicatedState(*base, *now))
+					changed_objects.push_back(*now);
+
+				++base;
+				++now;
+			}
+		}
+	}
+
+	// objects copied from older snapshot keep elapsed time of it
+	for (PacketObjectInfo& object : changed_objects)
+	{
+		if (object.fixture.direction != Direction::Max)
+			object.fixture.personal_delta_time = static_cast<uint16_t>(current.timestamp - object.fixture.last_transform_time);
+	}
+
+	EncodeCompactObjectBlock(current.sector_id, changed_objects, packet.objects);
+}
+
+bool ApplySectorSnapshotPacket(const std::vector<PacketObjectInfo>& baseline, const packet_sector_snapshot_ps& packet, std::vector<PacketObjectInfo>& result)
+{
+	std::vector<PacketObjectInfo> changed_objects;
+	if (!DecodeCompactObjectBlock(packet.sector_id, packet.objects, changed_objects))
+		return false;
+
+	result.clear();
+
+	if (packet.baseline_sequence == 0)
+	{
+		result = std::move(changed_objects);
+		return true;
+	}
+
+	result.reserve(baseline.size() + changed_objects.size());
+
+	auto base = baseline.begin();
+	auto changed = changed_objects.begin();
+	auto removed = packet.removed_object_ids.begin();
+
+	while (base != baseline.end() || changed != changed_objects.end())
+	{
+		if (changed == changed_objects.end() || (base != baseline.end() && base->object_id < changed->object_id))
+		{
+			while (removed != packet.removed_object_ids.end() && *removed < base->object_id)
+				++removed;
+
+			if (removed == packet.removed_object_ids.end() || *removed != base->object_id)
+				result.push_back(*base);
+
+			++base;
+		}
+		else
+		{
+			if (base != baseline.end() && base->object_id == changed->object_id)
+				++base;
+
+			result.push_back(*changed);
+			++changed;
+		}
+	}
+
+	return true;
+}
+
+const SectorSnapshot* SnapshotReplicator::FindSnapshot(const uint64_t sector_id, const uint32_t sequence) const
+{
+	auto history_iterator = _history.find(sector_id);
+	if (history_iterator == _history.end())
+		return nullptr;
+
+	for (const SectorSnapshotPtr& snapshot : history_iterator->second)
+	{
+		if (snapshot->sequence == sequence)
+			return snapshot.get();
+	}
+
+	return nullptr;
+}
+
+const std::vector<uint8_t>& SnapshotReplicator::GetFrame(const SectorSnapshot* const baseline, const SectorSnapshot& current)
+{
+	auto [frame_iterator, inserted] = _frames.try_emplace(baseline == nullptr ? 0 : baseline->sequence);
+
+	std::vector<uint8_t>& frame = frame_iterator->second;
+	if (!inserted)
+		return frame;
+
+	packet_sector_snapshot_ps packet;
+	MakeSectorSnapshotPacket(baseline, current, packet);
+
+	frame.resize(PACKET_LENGTH_SIZE + PACKET_HEADER_SIZE + GetPacketBodySize(packet) + MAX_PACKET_EXTENSION_SIZE);
+
+	uint32_t frame_size = 0;
+	if (!SerializePacket(packet, ErrorCode::None, frame.data(), static_cast<uint32_t>(frame.size()), frame_size))
+		assert(false);
+
+	frame.resize(frame_size);
+
+	return frame;
+}
+
+void SnapshotReplicator::Publish(const SectorSnapshotPtr& snapshot)
+{
+	std::deque<SectorSnapshotPtr>& history = _history[snapshot->sector_id];
+
+	history.push_back(snapshot);
+	while (history.size() > _history_size)
+		history.pop_front();
+
+	const std::vector<SectorListener>* listeners = _sector_posting_manager->GetSectorListeners(snapshot->sector_id);
+	if (listeners == nullptr)
+		return;
+
+	// listeners acknowledged same baseline share one frame
+	_frames.clear();
+
+	for (const SectorListener& listener : *listeners)
+	{
+		const NetworkSessionInfo* session_info = _sector_posting_manager->GetListenerSession(listener);
+		if (session_info == nullptr || !session_info->session.Valid())
+			continue;
+
+		ClientBaseline& client = _clients[listener.target_id];
+
+		// sector is changed, baseline of previous sector is useless
+		if (client.sector_id != snapshot->sector_id)
+			client = ClientBaseline{ snapshot->sector_id, 0, 0 };
+
+		const SectorSnapshot* baseline = nullptr;
+		if (client.acked_sequence != 0 && client.sent_sequence - client.acked_sequence <= _max_unacked_snapshot_count)
+			baseline = FindSnapshot(snapshot->sector_id, client.acked_sequence);
+
+		const std::vector<uint8_t>& frame = GetFrame(baseline, *snapshot);
+
+		_packet_throttler->PostSerializedPacket(session_info->session, frame.data(), static_cast<uint32_t>(frame.size()), PacketPostingPolicy::Throttle);
+
+		client.sent_sequence = snapshot->sequence;
+
+		if (baseline == nullptr)
+		{
+			_metrics.full_snapshots->Add();
+			_metrics.full_snapshot_bytes->Add(frame.size());
+		}
+		else
+		{
+			_metrics.delta_snapshots->Add();
+			_metrics.delta_snapshot_bytes->Add(frame.size());
+		}
+	}
+}
+
+void SnapshotReplicator::AddClient(const uint64_t target_id, const SocketSessionPtr& session, const uint64_t sector_id)
+{
+	ClientBaseline& client = _clients[target_id];
+	client = ClientBaseline{ sector_id, 0, 0 };
+
+	auto history_iterator = _history.find(sector_id);
+	if (history_iterator == _history.end() || history_iterator->second.empty() || !session.Valid())
+		return;
+
+	const SectorSnapshot& latest = *history_iterator->second.back();
+
+	_frames.clear();
+	const std::vector<uint8_t>& frame = GetFrame(nullptr, latest);
+
+	_packet_throttler->PostSerializedPacket(session, frame.data(), static_cast<uint32_t>(frame.size()), PacketPostingPolicy::Throttle);
+
+	client.sent_sequence = latest.sequence;
+
+	_metrics.full_snapshots->Add();
+	_metrics.full_snapshot_bytes->Add(frame.size());
+}
+
+void SnapshotReplicator::RemoveClient(const uint64_t target_id)
+{
+	_clients.erase(target_id);
+}
+
+void SnapshotReplicator::Acknowledge(const uint64_t target_id, const uint64_t sector_id, const uint32_t sequence)
+{
+	auto client_iterator = _clients.find(target_id);
+	if (client_iterator == _clients.end())
+		return;
+
+	ClientBaseline& client = client_iterator->second;
+
+	// stale ack of previous sector or ack of snapshot never sent
+	if (client.sector_id != sector_id || sequence <= client.acked_sequence || sequence > client.sent_sequence)
+		return;
+
+	client.acked_sequence = sequence;
+}
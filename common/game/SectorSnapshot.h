@@ -0,0 +1,110 @@
+#pragma once
+
+#include "SectorPostingManager.h"
+#include "../engine/protocol/CompactObject.h"
+#include "../utility/Metrics.h"
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// immutable replicated state of one sector, shared by every client shard
+struct SectorSnapshot
+{
+	uint64_t sector_id = 0;
+	uint32_t sequence = 0;
+
+	// publish time (epoch milliseconds), elapsed time of moving objects is measured at it
+	int64_t timestamp = 0;
+
+	// sorted by object id
+	std::vector<PacketObjectInfo> objects;
+};
+
+using SectorSnapshotPtr = std::shared_ptr<const SectorSnapshot>;
+
+// elapsed time is derived from last transform time, so it is not compared
+inline bool IsSameReplicatedState(const PacketObjectInfo& left, const PacketObjectInfo& right)
+{
+	const Fixture& l = left.fixture;
+	const Fixture& r = right.fixture;
+
+	return left.type == right.type
+		&& l.position.x == r.position.x && l.position.y == r.position.y
+		&& l.size.x == r.size.x && l.size.y == r.size.y
+		&& l.force == r.force && l.direction == r.direction && l.location == r.location && l.phase == r.phase
+		&& l.last_transform_time == r.last_transform_time
+		&& left.vital.hp == right.vital.hp && left.vital.speed == right.vital.speed && left.vital.damage == right.vital.damage;
+}
+
+// baseline nullptr = full snapshot
+void MakeSectorSnapshotPacket(const SectorSnapshot* const baseline, const SectorSnapshot& current, packet_sector_snapshot_ps& packet);
+
+// client side, baseline is object list of packet.baseline_sequence (ignored for full snapshot)
+bool ApplySectorSnapshotPacket(const std::vector<PacketObjectInfo>& baseline, const packet_sector_snapshot_ps& packet, std::vector<PacketObjectInfo>& result);
+
+// registry instruments, shared by every client shard
+struct SnapshotReplicationMetrics
+{
+	utility::MetricCounter* full_snapshots;
+	utility::MetricCounter* delta_snapshots;
+
+	utility::MetricCounter* full_snapshot_bytes;
+	utility::MetricCounter* delta_snapshot_bytes;
+};
+
+// "Thread Unsafe", one per client shard
+// keeps recent snapshots of every sector and acknowledged baseline of every client listener
+class SnapshotReplicator
+{
+private:
+	struct ClientBaseline
+	{
+		uint64_t sector_id = INVALID_SECTOR;
+		uint32_t acked_sequence = 0;
+		uint32_t sent_sequence = 0;
+	};
+
+	SectorPostingManager* _sector_posting_manager;
+	PacketThrottler* _packet_throttler;
+
+	uint32_t _history_size;
+	uint32_t _max_unacked_snapshot_count;
+
+	// key: sector id
+	std::unordered_map<uint64_t, std::deque<SectorSnapshotPtr>> _history;
+
+	// key: target id of sector listener
+	std::unordered_map<uint64_t, ClientBaseline> _clients;
+
+	// frames of current publish, key: baseline sequence
+	std::unordered_map<uint32_t, std::vector<uint8_t>> _frames;
+
+	SnapshotReplicationMetrics _metrics;
+
+	const SectorSnapshot* FindSnapshot(const uint64_t sector_id, const uint32_t sequence) const;
+
+	const std::vector<uint8_t>& GetFrame(const SectorSnapshot* const baseline, const SectorSnapshot& current);
+
+public:
+	SnapshotReplicator(SectorPostingManager* const sector_posting_manager, PacketThrottler* const packet_throttler, const uint32_t history_size = 32, const uint32_t max_unacked_snapshot_count = 16)
+		: _sector_posting_manager(sector_posting_manager), _packet_throttler(packet_throttler), _history_size(history_size), _max_unacked_snapshot_count(max_unacked_snapshot_count)
+	{
+		utility::MetricRegistry* registry = utility::MetricRegistry::GetInstance();
+
+		_metrics.full_snapshots = registry->Counter("snapshot_replication_snapshots_total", "snapshots sent to clients", "kind=\"full\"");
+		_metrics.delta_snapshots = registry->Counter("snapshot_replication_snapshots_total", "snapshots sent to clients", "kind=\"delta\"");
+		_metrics.full_snapshot_bytes = registry->Counter("snapshot_replication_bytes_total", "frame bytes of snapshots sent to clients", "kind=\"full\"");
+		_metrics.delta_snapshot_bytes = registry->Counter("snapshot_replication_bytes_total", "frame bytes of snapshots sent to clients", "kind=\"delta\"");
+	}
+	NONCOPYABLE(SnapshotReplicator)
+
+	// send snapshot to every listener of its sector, delta against acknowledged baseline if still in history
+	void Publish(const SectorSnapshotPtr& snapshot);
+
+	// new listener of sector, latest snapshot is sent in full
+	void AddClient(const uint64_t target_id, const SocketSessionPtr& session, const uint64_t sector_id);
+	void RemoveClient(const uint64_t target_id);
+
+	void Acknowledge(const uint64_t target_id, const uint64_t sector_id, const uint32_t sequence);
+};
@@ -1,15 +1,22 @@
 #include "World.h"
-#include "../utility/Time.h"
+#include "../engine/IntraCall.h"
+#include "../engine/EngineMetrics.h"
+#include "../utility/Clock.h"
 #include "../utility/Logger.h"
+#include "../utility/Profiler.h"
+#include <algorithm>
 
-void World::AddSector(const uint64_t server_id, const uint64_t sector_id)
+void World::AddSector(const uint64_t sector_id)
 {
 	SectorSystem*& sector = _sectors[sector_id];
 	if (sector != nullptr)
 		throw std::exception("duplicate sector");
 
-	sector = new SectorSystem(server_id, sector_id, GetSectorFixtureRectangle(sector_id).LeftDown(), SectorSize, ChunkSize, SectorGrayZoneChunk, this);
+	sector = new SectorSystem(sector_id, GetSectorFixtureRectangle(sector_id).LeftDown(), SectorSize, ChunkSize, SectorGrayZoneChunk, this);
 
+	_outboxes[sector_id];
+
+	RebuildSectorList();
 }
 
 void World::RemoveSector(const uint64_t sector_id)
@@ -23,6 +30,9 @@ void World::RemoveSector(const uint64_t sector_id)
 
 	delete sector;
 	_sectors.erase(sector_id);
+	_outboxes.erase(sector_id);
+
+	RebuildSectorList();
 }
 
 void World::ClearSector()
@@ -32,19 +42,39 @@ void World::ClearSector()
 		delete pair.second;
 		pair.second = nullptr;
 	}
+
+	_outboxes.clear();
+	_sector_list.clear();
+}
+
+void World::RebuildSectorList()
+{
+	_sector_list.clear();
+
+	for (const auto& pair : _sectors)
+	{
+		if (pair.second != nullptr)
+			_sector_list.push_back(pair.second);
+	}
+
+	std::sort(_sector_list.begin(), _sector_list.end(), [](SectorSystem* const left, SectorSystem* const right) {
+		return left->SectorId() < right->SectorId();
+	});
 }
 
-void World::SpawnCharacter(const SocketSessionPtr& request_session, const uint64_t request_server_id, const packet_spawn_character_rq& packet)
+void World::SpawnCharacter(const SocketSessionPtr& request_session, const uint64_t request_server_id, const packet_spawn_character_rq& packet, const uint32_t correlation_id)
 {
 	packet_spawn_character_rs response;
 	response.user_id = packet.user_id;
 
+	uint32_t response_correlation_id = ToResponseCorrelationId(correlation_id);
+
 	SectorSystem* & sector = _sectors[packet.object_info.sector_id];
 
 	if (sector == nullptr)
 	{
 		LOG(LogLevel::Warn, "sector not found %llu", packet.object_info.sector_id);
-		request_session->Send(response, ErrorCode::SectorNotFound);
+		request_session->Send(response, ErrorCode::SectorNotFound, false, response_correlation_id);
 		return;
 	}
 	Fixture* fixture = sector->CreateFixture(packet.object_info.fixture.position, packet.object_info.fixture.size);
@@ -52,9 +82,9 @@ void World::SpawnCharacter(const SocketSessionPtr& request_session, const uint64
 	// Object* object = new Object(fixture->id, sector->SectorId(), ObjectType::Character, ObjectState::Stop, {}, *fixture);
 
 	// fixture->user_data = reinterpret_cast<uint64_t>(object);
-	fixture->last_transform_time = utility::CurrentTick<utility::Milliseconds>().count();
+	fixture->last_transform_time = utility::CoarseTick<utility::Milliseconds>().count();
 		
-	fixture->CreateTracingHistory(FixtureTracingEvent::Create, utility::CurrentTimeEpoch<utility::Milliseconds>().count());
+	fixture->CreateTracingHistory(FixtureTracingEvent::Create, utility::CoarseTimeEpoch<utility::Milliseconds>().count());
 
 	response.object_info.fixture = *fixture;
 	response.object_info.object_id = fixture->id;
@@ -63,7 +93,7 @@ void World::SpawnCharacter(const SocketSessionPtr& request_session, const uint64
 	packet_create_object_ps broadcast;
 	broadcast.object_info = response.object_info;
 
-	_posting_manager->SendTo(request_server_id, response);
+	_posting_manager->SendTo(request_server_id, response, ErrorCode::None, response_correlation_id);
 	_posting_manager->SendToSectorWithout(request_server_id, broadcast, packet.object_info.sector_id);
 }
 
@@ -167,7 +197,7 @@ void World::CreateObservingObject(const packet_create_observing_object_rq& packe
 	
 	fixture->is_observing_fixture = true;
 	fixture->phase = sector->CalculateCurrentPhase(fixture);
-	fixture->CreateTracingHistory(FixtureTracingEvent::CreateObservingObject, utility::CurrentTimeEpoch<utility::Milliseconds>().count());
+	fixture->CreateTracingHistory(FixtureTracingEvent::CreateObservingObject, utility::CoarseTimeEpoch<utility::Milliseconds>().count());
 }
 
 void World::RemoveObservingObject(const packet_remove_observing_object_rq& packet)
@@ -296,7 +326,7 @@ void World::MoveObject(const SocketSessionPtr& request_session, const uint64_t r
 	}
 }
 
-void World::SendRemoveObservingObject(Fixture* const fixture, const std::array<uint64_t, 4>& sectors, const uint64_t object_id)
+void World::SendRemoveObservingObject(const std::array<uint64_t, 4>& sectors, const uint64_t object_id)
 {
 	packet_remove_observing_object_rq remove_packet;
 	remove_packet.object_id = object_id;
@@ -320,7 +350,7 @@ void World::SendRemoveObservingObject(Fixture* const fixture, const std::array<u
 	}
 }
 
-void World::SendCreateObservingObject(Fixture* const fixture, const std::array<uint64_t, 3>& sectors, const uint64_t origin_sector_id, const PacketObjectInfo& object_info)
+void World::SendCreateObservingObject(const std::array<uint64_t, 3>& sectors, const uint64_t origin_sector_id, const PacketObjectInfo& object_info)
 {
 	packet_create_observing_object_rq create_packet;
 	create_packet.object_info = object_info;
@@ -345,8 +375,10 @@ void World::SendCreateObservingObject(Fixture* const fixture, const std::array<u
 	}
 }
 
-void World::ExchangeObservingObject(Fixture* const fixture, const PacketObjectInfo& object_info, const FixtureLocation location, const Direction phase, const uint64_t sector_id, const FixtureLocation new_location, const Direction new_phase, const uint64_t dest_sector_id)
+void World::ExchangeObservingObject(const PacketObjectInfo& object_info, const FixtureLocation location, const Direction phase, const uint64_t sector_id, const FixtureLocation new_location, const Direction new_phase, const uint64_t dest_sector_id)
 {
+	PROFILE_ZONE("World::ExchangeObservingObject");
+
 	if (sector_id == dest_sector_id && phase == new_phase && new_location == FixtureLocation::Leave)
 		return;
 
@@ -400,10 +432,10 @@ void World::ExchangeObservingObject(Fixture* const fixture, const PacketObjectIn
 	}
 
 	if (phase != Direction::Max)
-		SendRemoveObservingObject(fixture, prev_near_sectors, object_info.object_id);
+		SendRemoveObservingObject(prev_near_sectors, object_info.object_id);
 
 	if (new_phase != Direction::Max)
-		SendCreateObservingObject(fixture, new_near_sectors, sector_id, object_info);
+		SendCreateObservingObject(new_near_sectors, sector_id, object_info);
 }
 
 void World::PromoteObservingObject(const SocketSessionPtr& request_session, const uint64_t request_server_id, const packet_promote_object_rq& packet)
@@ -426,7 +458,7 @@ void World::PromoteObservingObject(const SocketSessionPtr& request_session, cons
 
 	*promoted_fixture = packet.object_info.fixture;
 	promoted_fixture->is_observing_fixture = false;
-	promoted_fixture->last_transform_time = static_cast<uint32_t>(utility::CurrentTick<utility::Milliseconds>().count());
+	promoted_fixture->last_transform_time = static_cast<uint32_t>(utility::CoarseTick<utility::Milliseconds>().count());
 
 	FixtureLocation origin_location = promoted_fixture->location;
 	FixtureLocation dest_location = sector->CalculateCurrentLocation(promoted_fixture);
@@ -439,7 +471,7 @@ void World::PromoteObservingObject(const SocketSessionPtr& request_session, cons
 	// Ͽ
 	promoted_fixture->phase = dest_phase;
 	promoted_fixture->location = dest_location;
-	promoted_fixture->CreateTracingHistory(FixtureTracingEvent::PromoteObject, utility::CurrentTimeEpoch<utility::Milliseconds>().count());
+	promoted_fixture->CreateTracingHistory(FixtureTracingEvent::PromoteObject, utility::CoarseTimeEpoch<utility::Milliseconds>().count());
 
 	// agency object ã ϴ 찡 ֱ   
 	_posting_manager->SendToSector(packet, packet.origin_sector_id);
@@ -451,7 +483,7 @@ void World::PromoteObservingObject(const SocketSessionPtr& request_session, cons
 	// Zone  Ű ʰ ڷƮؼ ǳʰ 
 	else if (!IsNearPhase(packet.origin_sector_id, origin_phase, promoted_fixture->sector_id, dest_phase))
 	{
-		ExchangeObservingObject(promoted_fixture, packet.object_info, origin_location, origin_phase, packet.origin_sector_id, dest_location, dest_phase, promoted_fixture->sector_id);
+		ExchangeObservingObject(packet.object_info, origin_location, origin_phase, packet.origin_sector_id, dest_location, dest_phase, promoted_fixture->sector_id);
 	}
 }
 
@@ -459,6 +491,10 @@ thread_local std::vector<uint64_t> untracked_objects;
 
 void World::Update(const utility::Milliseconds current_time, const utility::Milliseconds delta_time)
 {
+	PROFILE_ZONE("World::Update");
+
+	utility::Nanoseconds update_start = utility::FineTick();
+
 	for (const auto& pair : _promoted_object_list)
 	{
 		if (pair.second.tracking_timer)
@@ -470,46 +506,87 @@ void World::Update(const utility::Milliseconds current_time, const utility::Mill
 
 	untracked_objects.clear();
 
-	for (std::pair<const uint64_t, SectorSystem*>& pair : _sectors)
+	// sectors do not share fixtures, callbacks only touch its own fixture and outbox
+	if (_job_pool != nullptr)
+	{
+		_job_pool->ParallelFor(_sector_list.size(), [&](const uint64_t index) {
+			_sector_list[index]->Update(current_time, delta_time);
+		});
+	}
+	else
+	{
+		for (SectorSystem* const sector : _sector_list)
+			sector->Update(current_time, delta_time);
+	}
+
+	for (SectorSystem* const sector : _sector_list)
 	{
-		assert(pair.second != nullptr);
+		std::vector<SectorOutboxMessage>& outbox = _outboxes[sector->SectorId()];
+
+		for (const SectorOutboxMessage& message : outbox)
+		{
+			switch (message.type)
+			{
+			case SectorOutboxMessage::Type::ChangePhase:
+				ProcessChangeFixturePhase(message);
+				break;
+			case SectorOutboxMessage::Type::ChangeLocation:
+				ProcessChangeFixtureLocation(message);
+				break;
+			}
+		}
 
-		pair.second->Update(current_time, delta_time);
+		outbox.clear();
 
 		for (const uint64_t fixture_id : _removing_fixtures)
-			pair.second->RemoveFixture(fixture_id);
+			sector->RemoveFixture(fixture_id);
 		
 		_removing_fixtures.clear();
 	}
 
+	EngineMetrics::WorldUpdateTime()->Record(static_cast<uint64_t>(utility::TimeCast<utility::Microseconds>(utility::FineTick() - update_start).count()));
 }
 
 void World::OnChangeFixturePhase(const uint64_t sector_id, Fixture* const fixture, const Direction phase)
 {
 	assert(fixture->location == FixtureLocation::Gray);
 
-	PacketObjectInfo object_info;
+	auto outbox_iterator = _outboxes.find(sector_id);
+	if (outbox_iterator == _outboxes.end())
+		return;
 
-	object_info.object_id = fixture->id;
-	object_info.sector_id = sector_id;
-	object_info.fixture = *fixture;
+	SectorOutboxMessage message;
+	message.type = SectorOutboxMessage::Type::ChangePhase;
+	message.sector_id = sector_id;
+	message.object_info.object_id = fixture->id;
+	message.object_info.sector_id = sector_id;
+	message.object_info.fixture = *fixture;
+	message.new_location = fixture->location;
+	message.new_phase = phase;
 	
 #ifdef _DEBUG
 	Direction prev_phase = fixture->phase;
 	fixture->phase = phase;
 
-	fixture->CreateTracingHistory(FixtureTracingEvent::ChangePhase, utility::CurrentTimeEpoch<utility::Milliseconds>().count());
+	fixture->CreateTracingHistory(FixtureTracingEvent::ChangePhase, utility::CoarseTimeEpoch<utility::Milliseconds>().count());
 
 	fixture->phase = prev_phase;
 #endif
 
-	ExchangeObservingObject(fixture, object_info, fixture->location, fixture->phase, fixture->sector_id, fixture->location, phase, sector_id);
+	outbox_iterator->second.push_back(message);
+}
+
+void World::ProcessChangeFixturePhase(const SectorOutboxMessage& message)
+{
+	const Fixture& fixture = message.object_info.fixture;
+
+	ExchangeObservingObject(message.object_info, fixture.location, fixture.phase, fixture.sector_id, fixture.location, message.new_phase, message.sector_id);
 }
 
 void World::OnChangeFixtureLocation(const uint64_t sector_id, Fixture* const fixture, const FixtureLocation location, const Direction phase)
 {
-	auto sector_iterator = _sectors.find(sector_id);
-	if (sector_iterator == _sectors.end())
+	auto outbox_iterator = _outboxes.find(sector_id);
+	if (outbox_iterator == _outboxes.end())
 		return;
 
 #ifdef _DEBUG
@@ -518,27 +595,46 @@ void World::OnChangeFixtureLocation(const uint64_t sector_id, Fixture* const fix
 
 	fixture->location = location;
 	fixture->phase = phase;
-	fixture->CreateTracingHistory(FixtureTracingEvent::ChangeLocation, utility::CurrentTimeEpoch<utility::Milliseconds>().count());
+	fixture->CreateTracingHistory(FixtureTracingEvent::ChangeLocation, utility::CoarseTimeEpoch<utility::Milliseconds>().count());
 
 	fixture->location = prev_location;
 	fixture->phase = prev_phase;
 #endif
 
-	fixture->last_transform_time = utility::CurrentTick<utility::Milliseconds>().count();
+	fixture->last_transform_time = utility::CoarseTick<utility::Milliseconds>().count();
+
+	SectorOutboxMessage message;
+	message.type = SectorOutboxMessage::Type::ChangeLocation;
+	message.sector_id = sector_id;
+	message.object_info.object_id = fixture->id;
+	message.object_info.sector_id = sector_id;
+	message.object_info.fixture = *fixture;
+	message.new_location = location;
+	message.new_phase = phase;
+
+	// leaving fixture must be observing from this update, its owner changes after merge
+	if (location == FixtureLocation::Leave)
+		fixture->is_observing_fixture = true;
 
-	PacketObjectInfo object_info;
-	object_info.object_id = fixture->id;
-	object_info.sector_id = sector_id;
-	object_info.fixture = *fixture;
+	outbox_iterator->second.push_back(message);
+}
+
+void World::ProcessChangeFixtureLocation(const SectorOutboxMessage& message)
+{
+	const uint64_t sector_id = message.sector_id;
+	const FixtureLocation location = message.new_location;
+	const Direction phase = message.new_phase;
+
+	PacketObjectInfo object_info = message.object_info;
 	
-	ExchangeObservingObject(fixture, object_info, fixture->location, fixture->phase, sector_id, location, phase, sector_id);
+	ExchangeObservingObject(object_info, object_info.fixture.location, object_info.fixture.phase, sector_id, location, phase, sector_id);
 
 	if (location != FixtureLocation::Leave)
 		return;
 
 	auto near_sectors = GetNearSectors(sector_id, phase);
 
-	uint64_t dest_sector_id = GetSectorByPosition(fixture->position);
+	uint64_t dest_sector_id = GetSectorByPosition(object_info.fixture.position);
 
 	bool find_in_near_sector = false;
 	for (const uint64_t near_sector_id : near_sectors)
@@ -552,11 +648,10 @@ void World::OnChangeFixtureLocation(const uint64_t sector_id, Fixture* const fix
 
 	if (!find_in_near_sector)
 	{
-		SendCreateObservingObject(fixture, { dest_sector_id, INVALID_SECTOR, INVALID_SECTOR }, sector_id, object_info);
+		SendCreateObservingObject({ dest_sector_id, INVALID_SECTOR, INVALID_SECTOR }, sector_id, object_info);
 	}
 	object_info.fixture.location = location;
 	object_info.fixture.phase = phase;
-	fixture->is_observing_fixture = true;
 
 	packet_promote_object_rq packet;
 	packet.origin_sector_id = sector_id;
@@ -568,11 +663,11 @@ void World::OnChangeFixtureLocation(const uint64_t sector_id, Fixture* const fix
 	packet.object_info.fixture.sector_id = dest_sector_id;
 
 	PromotedObjectInfo promoted_object;
-	promoted_object.object_id = fixture->id;
+	promoted_object.object_id = object_info.object_id;
 	promoted_object.promoted_sector_id = packet.object_info.sector_id;
 	promoted_object.tracking_timer = utility::Countdown<utility::Milliseconds>(utility::Milliseconds(TransformCooltime * 4));
 		
-	_promoted_object_list[fixture->id] = promoted_object;
+	_promoted_object_list[object_info.object_id] = promoted_object;
 
 	_posting_manager->SendToSectorOwner(packet, packet.object_info.sector_id);
 }
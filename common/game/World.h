@@ -6,6 +6,8 @@
 #include "../engine/protocol/Packet.h"
 #include "../utility/MultiDimensionMap.h"
 #include "object/Object.h"
+#include "../concurrent/JobPool.h"
+#include <memory>
 
 struct PromotedObjectInfo
 {
@@ -15,6 +17,25 @@ struct PromotedObjectInfo
 	utility::Countdown<utility::Milliseconds> tracking_timer;
 };
 
+// SectorSystem callback side effect, recorded during parallel sector update and merged in sector id order
+struct SectorOutboxMessage
+{
+	enum class Type : uint8_t
+	{
+		ChangePhase,
+		ChangeLocation,
+	};
+
+	Type type;
+	uint64_t sector_id;
+
+	// fixture snapshot before the change
+	PacketObjectInfo object_info;
+
+	FixtureLocation new_location;
+	Direction new_phase;
+};
+
 class World : public SectorSystem::Callback
 {
 private:
@@ -24,6 +45,12 @@ private:
 
 	std::unordered_map<uint64_t, SectorSystem*> _sectors;
 
+	// sorted by sector id, read only while sectors are updated in parallel
+	std::vector<SectorSystem*> _sector_list;
+	std::unordered_map<uint64_t, std::vector<SectorOutboxMessage>> _outboxes;
+
+	std::unique_ptr<JobPool> _job_pool;
+
 	std::unordered_map<uint64_t, PromotedObjectInfo> _promoted_object_list;
 
 	std::vector<uint64_t> _removing_fixtures;
@@ -32,14 +59,30 @@ private:
 
 	uint32_t _remove_count = 0;
 
-	void SendRemoveObservingObject(Fixture* const fixture, const std::array<uint64_t, 4>& sectors, const uint64_t object_id);
-	void SendCreateObservingObject(Fixture* const fixture, const std::array<uint64_t, 3>& sectors, const uint64_t origin_sector_id, const PacketObjectInfo& object_info);
-	void ExchangeObservingObject(Fixture* const fixture, const PacketObjectInfo& object_info, const FixtureLocation location, const Direction phase, const uint64_t sector_id, const FixtureLocation new_location, const Direction new_phase, const uint64_t dest_sector_id);
+	void SendRemoveObservingObject(const std::array<uint64_t, 4>& sectors, const uint64_t object_id);
+	void SendCreateObservingObject(const std::array<uint64_t, 3>& sectors, const uint64_t origin_sector_id, const PacketObjectInfo& object_info);
+	void ExchangeObservingObject(const PacketObjectInfo& object_info, const FixtureLocation location, const Direction phase, const uint64_t sector_id, const FixtureLocation new_location, const Direction new_phase, const uint64_t dest_sector_id);
+
+	void RebuildSectorList();
+
+	void ProcessChangeFixturePhase(const SectorOutboxMessage& message);
+	void ProcessChangeFixtureLocation(const SectorOutboxMessage& message);
 public:
 
-	World(SectorPostingManager* const posting_manager, const utility::Milliseconds fixture_transform_cooltime) : _posting_manager(posting_manager), _fixture_transform_cooltime(fixture_transform_cooltime) {}
+	// update_concurrency: thread count updating sectors in parallel including game worker, 0 or 1 = serial
+	World(SectorPostingManager* const posting_manager, const utility::Milliseconds fixture_transform_cooltime, const uint32_t update_concurrency = 1) : _posting_manager(posting_manager), _fixture_transform_cooltime(fixture_transform_cooltime)
+	{
+		if (update_concurrency > 1)
+			_job_pool = std::make_unique<JobPool>(update_concurrency);
+	}
+
+	~World()
+	{
+		// job threads are joined before sectors they update go away
+		_job_pool.reset();
+	}
 
-	void AddSector(const uint64_t server_id, const uint64_t sector_id);
+	void AddSector(const uint64_t sector_id);
 	void RemoveSector(const uint64_t sector_id);
 
 	void ClearSector();
@@ -51,7 +94,7 @@ public:
 
 	///////////////////////////////////////////////////////////////////////
 
-	void SpawnCharacter(const SocketSessionPtr& request_session, const uint64_t request_server_id, const packet_spawn_character_rq& packet);
+	void SpawnCharacter(const SocketSessionPtr& request_session, const uint64_t request_server_id, const packet_spawn_character_rq& packet, const uint32_t correlation_id = 0);
 	void RemoveCharacter(const SocketSessionPtr& request_session, const uint64_t request_server_id, packet_remove_character_rq& packet);
 
 	void MoveObject(const SocketSessionPtr& request_session, const uint64_t request_server_id, packet_character_move_rq& packet);
@@ -1,10 +1,11 @@
 #include "SectorSystem.h"
 #include "SectorGrid.h"
+#include "../../utility/Profiler.h"
+#include "../../utility/Uid.h"
 
-SectorSystem::SectorSystem(const uint64_t server_id, const uint64_t sector_id, const Vector2 base_position, const Size sector_size, const CoordinateUnit chunk_size, const CoordinateUnit gray_zone_chunk, Callback* const callback)
+SectorSystem::SectorSystem(const uint64_t sector_id, const Vector2 base_position, const Size sector_size, const CoordinateUnit chunk_size, const CoordinateUnit gray_zone_chunk, Callback* const callback)
 	: _sector_id(sector_id), _size(sector_size), _chunk_size(chunk_size), _gray_zone_chunk(gray_zone_chunk), _base_position(base_position), _callback(callback)
 {
-	_current_fixture_id = server_id * 1000000000000000 + 200000000000000 + 100000000000 * sector_id + 1;
 	_direction_ratio = Size{ _size.x / 3, _size.y / 3 };
 	_inner_box = Size{ _size.x - _chunk_size * _gray_zone_chunk * 2, _size.y - _chunk_size * _gray_zone_chunk * 2 };
 	_inner_box_position = Vector2{_base_position.x + _chunk_size * _gray_zone_chunk, _base_position.y + _chunk_size * _gray_zone_chunk };
@@ -25,7 +26,7 @@ Fixture* SectorSystem::CreateFixture(const Fixture& origin)
 
 Fixture* SectorSystem::CreateFixture(const Vector2 position, const Size size)
 {
-	return CreateFixture(position, size, _current_fixture_id++);
+	return CreateFixture(position, size, UidGenerator::GetInstance()->Generate(UidType::Fixture));
 }
 
 Fixture* SectorSystem::CreateFixture(const Vector2 position, const Size size, uint64_t fixture_id)
@@ -99,6 +100,8 @@ Direction SectorSystem::CalculateCurrentPhase(Fixture* fixture)
 
 void SectorSystem::Update(const utility::Milliseconds current_time, const utility::Milliseconds delta_time)
 {
+	PROFILE_ZONE("SectorSystem::Update");
+
 	for (std::pair<const uint64_t, Fixture*>& pair : _fixtures)
 	{
 		Fixture* fixture = pair.second;
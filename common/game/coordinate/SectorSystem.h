@@ -21,8 +21,6 @@ private:
 	uint64_t _sector_id;
 	std::unordered_map<uint64_t, Fixture*> _fixtures;
 
-	uint64_t _current_fixture_id;
-
 	const Vector2 _base_position;
 	const Size _size;
 	const CoordinateUnit _chunk_size;
@@ -36,7 +34,7 @@ private:
 	Callback* _callback;
 public:
 
-	SectorSystem(const uint64_t server_id, const uint64_t sector_id, const Vector2 base_position, const Size sector_size, const CoordinateUnit chunk_size, const CoordinateUnit gray_zone_chunk, Callback* const callback);
+	SectorSystem(const uint64_t sector_id, const Vector2 base_position, const Size sector_size, const CoordinateUnit chunk_size, const CoordinateUnit gray_zone_chunk, Callback* const callback);
 
 	Fixture* CreateFixture(const Vector2 position, const Size size);
 	Fixture* CreateFixture(const Vector2 position, const Size size, uint64_t fixture_id);
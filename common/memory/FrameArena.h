@@ -0,0 +1,203 @@
+#pragma once
+
+#include "Allocator.h"
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// bump allocator of one logic thread, released all at once by Reset at the start of each worker iteration
+// blocks are kept across resets, so the thread stops allocating once the biggest frame has been seen
+class FrameArena
+{
+private:
+	struct Block
+	{
+		uint8_t* memory;
+		std::size_t size;
+	};
+
+	std::vector<Block> _blocks;
+	std::size_t _block_index = 0;
+	std::size_t _offset = 0;
+	std::size_t _block_size;
+
+	static FrameArena*& BoundArena()
+	{
+		static thread_local FrameArena* arena = nullptr;
+		return arena;
+	}
+
+#ifdef _DEBUG
+	static uint32_t& HeapScopeDepth()
+	{
+		static thread_local uint32_t depth = 0;
+		return depth;
+	}
+
+	friend class FrameHeapScope;
+#endif
+
+public:
+	FrameArena(const std::size_t block_size = 64 * 1024) : _block_size(block_size) {}
+	NONCOPYABLE(FrameArena)
+
+	~FrameArena()
+	{
+		for (const Block& block : _blocks)
+			CacheAlignedMemoryAllocator::deallocate(block.memory);
+	}
+
+	void* Allocate(const std::size_t size, const std::size_t alignment)
+	{
+		while (_block_index < _blocks.size())
+		{
+			const Block& block = _blocks[_block_index];
+
+			std::size_t offset = (_offset + alignment - 1) & ~(alignment - 1);
+			if (offset + size <= block.size)
+			{
+				_offset = offset + size;
+				return block.memory + offset;
+			}
+
+			// rest of a block too small for this request is left unused in this frame
+			_block_index++;
+			_offset = 0;
+		}
+
+		std::size_t block_size = std::max(_block_size, size);
+
+		_blocks.push_back(Block{ static_cast<uint8_t*>(CacheAlignedMemoryAllocator::allocate(block_size)), block_size });
+		_block_index = _blocks.size() - 1;
+		_offset = size;
+
+		return _blocks.back().memory;
+	}
+
+	void Reset()
+	{
+		_block_index = 0;
+		_offset = 0;
+	}
+
+	std::size_t Capacity() const
+	{
+		std::size_t capacity = 0;
+		for (const Block& block : _blocks)
+			capacity += block.size;
+
+		return capacity;
+	}
+
+	// arena used by frame containers of calling thread, nullptr = heap
+	static FrameArena* Current()
+	{
+		return BoundArena();
+	}
+
+	static void Bind(FrameArena* const arena)
+	{
+		BoundArena() = arena;
+	}
+
+#ifdef _DEBUG
+	// heap allocations of frame containers which were not opted in, made on a thread with bound arena
+	// checked by LinearWorker every iteration, copies and FrameHeapScope are not counted
+	static uint64_t& MissedAllocationCount()
+	{
+		static thread_local uint64_t count = 0;
+		return count;
+	}
+
+	static void OnHeapAllocation()
+	{
+		if (BoundArena() != nullptr && HeapScopeDepth() == 0)
+			MissedAllocationCount()++;
+	}
+#endif
+};
+
+// frame containers filled in this scope are heap backed on purpose, e.g. received packets
+class FrameHeapScope
+{
+public:
+#ifdef _DEBUG
+	FrameHeapScope() { FrameArena::HeapScopeDepth()++; }
+	~FrameHeapScope() { FrameArena::HeapScopeDepth()--; }
+#else
+	FrameHeapScope() {}
+#endif
+	NONCOPYABLE(FrameHeapScope)
+};
+
+// allocator of frame containers, without arena it falls back to heap
+// copies are heap backed so a container copied into a lambda or coroutine outlives the frame
+template <typename T>
+class FrameAllocator
+{
+private:
+	template <typename U>
+	friend class FrameAllocator;
+
+	FrameArena* _arena = nullptr;
+
+	// heap backed copy, not counted as missed arena allocation
+	bool _copied = false;
+
+public:
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::false_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	FrameAllocator() = default;
+	FrameAllocator(FrameArena* const arena) : _arena(arena) {}
+
+	template <typename U>
+	FrameAllocator(const FrameAllocator<U>& other) : _arena(other._arena), _copied(other._copied) {}
+
+	T* allocate(const std::size_t count)
+	{
+		if (_arena == nullptr)
+		{
+#ifdef _DEBUG
+			if (!_copied)
+				FrameArena::OnHeapAllocation();
+#endif
+			return static_cast<T*>(::operator new(count * sizeof(T)));
+		}
+
+		return static_cast<T*>(_arena->Allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* const ptr, const std::size_t count)
+	{
+		if (_arena == nullptr)
+			::operator delete(ptr);
+	}
+
+	FrameAllocator select_on_container_copy_construction() const
+	{
+		FrameAllocator allocator;
+		allocator._copied = true;
+
+		return allocator;
+	}
+
+	template <typename U>
+	bool operator==(const FrameAllocator<U>& other) const
+	{
+		return _arena == other._arena;
+	}
+};
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+// rebinds container to arena of calling thread, call before filling it
+template <typename Container>
+inline void UseFrameArena(Container& container)
+{
+	container = Container(typename Container::allocator_type(FrameArena::Current()));
+}
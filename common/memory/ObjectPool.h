@@ -4,6 +4,8 @@
 #include "Buffer.h"
 #include "ConcurrentStack.h"
 #include <atomic_queue/atomic_queue.h>
+#include <algorithm>
+#include <mutex>
 #include <vector>
 
 template <typename T, bool CONCURRENT = false,
@@ -72,11 +74,23 @@ private:
 	std::atomic<uint64_t> _object_sequence;
 	uint64_t _initializer_parameter;
 
+	// pooled objects grow by chunk up to pool size, heap objects of must_allocation take sequences after pool size
+	uint32_t _pool_size;
+	uint32_t _chunk_size;
+	uint64_t _chunk_sequence;
+	std::atomic<uint32_t> _allocated_size = 0;
+	std::mutex _growth_mutex;
+
+	// objects in pool, tracked for WarmUp of concurrent pool only
+	std::atomic<int64_t> _available_size = 0;
+
 private:
 	void PushObject(ObjectBlock* const object)
 	{
 		if constexpr (CONCURRENT)
 		{
+			_available_size.fetch_add(1, std::memory_order_relaxed);
+
 // #ifdef _DEBUG
 			_pool->push(object);
 /*
@@ -99,7 +113,11 @@ private:
 	{
 		if constexpr (CONCURRENT)
 		{
-			return _pool->try_pop(result);
+			if (!_pool->try_pop(result))
+				return false;
+
+			_available_size.fetch_sub(1, std::memory_order_relaxed);
+			return true;
 		}
 		else
 		{
@@ -116,9 +134,30 @@ private:
 		}
 	}
 
+	// allocates next chunk, false when pool has grown to pool size
+	bool Grow()
+	{
+		if (_allocated_size.load(std::memory_order_acquire) >= _pool_size)
+			return false;
+
+		std::lock_guard<std::mutex> guard(_growth_mutex);
+
+		uint32_t allocated_size = _allocated_size.load(std::memory_order_relaxed);
+		if (allocated_size >= _pool_size)
+			return false;
+
+		uint32_t allocation_size = std::min(_chunk_size, _pool_size - allocated_size);
+		AllocateChunk(_chunk_sequence, allocation_size, _initializer_parameter);
+
+		_allocated_size.store(allocated_size + allocation_size, std::memory_order_release);
+
+		return true;
+	}
+
 public:
-	ObjectPool(const uint32_t pool_size, const uint32_t chunk_size, const uint64_t initializer_param = 0, const uint64_t start_sequence = 1)
-		: _initializer_parameter(initializer_param)
+	// initial_size objects are allocated here, the others grow by chunk when pool runs dry or by WarmUp
+	ObjectPool(const uint32_t pool_size, const uint32_t chunk_size, const uint64_t initializer_param = 0, const uint64_t start_sequence = 1, const uint32_t initial_size = UINT32_MAX)
+		: _initializer_parameter(initializer_param), _pool_size(pool_size), _chunk_size(chunk_size), _chunk_sequence(start_sequence)
 	{
 		assert(chunk_size > 0);
 
@@ -132,17 +171,11 @@ public:
 			_pool = new std::remove_pointer_t<decltype(_pool)>;
 #endif
 */
-		uint64_t object_sequence = start_sequence;
-		for (uint32_t size = 0; size < pool_size; size += chunk_size)
-		{
-			uint32_t allocation_size = chunk_size;
-			if (size + chunk_size > pool_size)
-				allocation_size = pool_size - size;
-
-			AllocateChunk(object_sequence, allocation_size, _initializer_parameter);
-		}
+		_object_sequence = start_sequence + pool_size;
 
-		_object_sequence = object_sequence;
+		uint32_t target_size = std::min(initial_size, pool_size);
+		while (_allocated_size.load(std::memory_order_relaxed) < target_size)
+			Grow();
 	}
 
 	ObjectPool(const ObjectPool<T, CONCURRENT, Initializer, Destructor>&) = delete;
@@ -181,7 +214,12 @@ public:
 	T* Pop(bool must_allocation = false)
 	{
 		ObjectBlock* ret = nullptr;
-		if (PopObject(ret))
+
+		bool popped = PopObject(ret);
+		while (!popped && Grow())
+			popped = PopObject(ret);
+
+		if (popped)
 		{
 
 #ifdef _DEBUG
@@ -210,4 +248,18 @@ public:
 
 		return nullptr;
 	}
+
+	// grows one chunk ahead of demand when less than a chunk is left, called by PoolWarmer
+	bool WarmUp() requires CONCURRENT
+	{
+		if (_available_size.load(std::memory_order_relaxed) >= _chunk_size)
+			return false;
+
+		return Grow();
+	}
+
+	uint32_t AllocatedSize() const
+	{
+		return _allocated_size.load(std::memory_order_relaxed);
+	}
 };
\ No newline at end of file
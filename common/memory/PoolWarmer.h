@@ -0,0 +1,91 @@
+#pragma once
+
+#include "../common.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// grows registered pools ahead of demand on one background thread
+// pools start with a small initial size, so startup cost does not depend on configured maximums
+// a pool is grown only when less than a chunk is left, so pools are not filled to their maximum at startup
+// every pass grows each short pool by at most one chunk in turn, a pool never waits for another to finish
+class PoolWarmer
+{
+private:
+	std::vector<std::function<bool()>> _warm_ups;
+	std::mutex _mutex;
+
+	std::thread* _warmer_routine = nullptr;
+	std::atomic<bool> _stop = false;
+
+	void WarmerMain()
+	{
+		std::vector<std::function<bool()>> warm_ups;
+
+		while (!_stop.load(std::memory_order_relaxed))
+		{
+			{
+				std::lock_guard<std::mutex> guard(_mutex);
+				if (warm_ups.size() != _warm_ups.size())
+					warm_ups = _warm_ups;
+			}
+
+			bool grown = false;
+			for (const std::function<bool()>& warm_up : warm_ups)
+				grown |= warm_up();
+
+			if (!grown)
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+
+public:
+	PoolWarmer() = default;
+	NONCOPYABLE(PoolWarmer)
+
+	static PoolWarmer* GetInstance()
+	{
+		static PoolWarmer warmer;
+		return &warmer;
+	}
+
+	// pools are not grown after this, registered later are not warmed
+	void Stop()
+	{
+		std::thread* warmer_routine = nullptr;
+		{
+			std::lock_guard<std::mutex> guard(_mutex);
+
+			_stop.store(true, std::memory_order_relaxed);
+			std::swap(warmer_routine, _warmer_routine);
+		}
+
+		if (warmer_routine == nullptr)
+			return;
+
+		warmer_routine->join();
+		delete warmer_routine;
+	}
+
+	~PoolWarmer()
+	{
+		Stop();
+	}
+
+	// pool must live until process exit
+	template <typename Pool>
+	void Register(Pool* const pool)
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+
+		_warm_ups.push_back([pool]() {
+			return pool->WarmUp();
+		});
+
+		if (_warmer_routine == nullptr && !_stop.load(std::memory_order_relaxed))
+			_warmer_routine = new std::thread(&PoolWarmer::WarmerMain, this);
+	}
+};
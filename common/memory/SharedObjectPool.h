@@ -5,6 +5,8 @@
 #include "ConcurrentStack.h"
 #include "IntrusivePtr.h"
 #include <atomic_queue/atomic_queue.h>
+#include <algorithm>
+#include <mutex>
 
 template <typename T, ObjectInitializerConcept<T> Initializer = EmptyInitializer<T>>
 	requires std::constructible_from<T> && IntrusivePtrElement<T>
@@ -52,15 +54,51 @@ private:
 		}
 	}
 
+	uint64_t _initializer_parameter;
+
+	// pooled objects grow by chunk up to pool size
+	uint32_t _pool_size;
+	uint32_t _chunk_size;
+	uint64_t _chunk_sequence;
+	std::atomic<uint32_t> _allocated_size = 0;
+	std::mutex _growth_mutex;
+
+	std::atomic<int64_t> _available_size = 0;
+
 private:
 	void PushObject(ObjectBlock* const object)
 	{
+		_available_size.fetch_add(1, std::memory_order_relaxed);
 		_pool->push(object);
 	}
 
 	bool PopObject(ObjectBlock*& result)
 	{
-		return _pool->try_pop(result);
+		if (!_pool->try_pop(result))
+			return false;
+
+		_available_size.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// allocates next chunk, false when pool has grown to pool size
+	bool Grow()
+	{
+		if (_allocated_size.load(std::memory_order_acquire) >= _pool_size)
+			return false;
+
+		std::lock_guard<std::mutex> guard(_growth_mutex);
+
+		uint32_t allocated_size = _allocated_size.load(std::memory_order_relaxed);
+		if (allocated_size >= _pool_size)
+			return false;
+
+		uint32_t allocation_size = std::min(_chunk_size, _pool_size - allocated_size);
+		AllocateChunk(_chunk_sequence, allocation_size, _initializer_parameter);
+
+		_allocated_size.store(allocated_size + allocation_size, std::memory_order_release);
+
+		return true;
 	}
 
 	void Push(T* const object)
@@ -85,7 +123,9 @@ private:
 	}
 
 public:
-	SharedObjectPool(const uint32_t pool_size, const uint32_t chunk_size, const uint64_t initializer_param = 0, const uint32_t start_sequence = 1)
+	// initial_size objects are allocated here, the others grow by chunk when pool runs dry or by WarmUp
+	SharedObjectPool(const uint32_t pool_size, const uint32_t chunk_size, const uint64_t initializer_param = 0, const uint32_t start_sequence = 1, const uint32_t initial_size = UINT32_MAX)
+		: _initializer_parameter(initializer_param), _pool_size(pool_size), _chunk_size(chunk_size), _chunk_sequence(start_sequence)
 	{
 		assert(chunk_size > 0);
 
@@ -95,15 +135,9 @@ public:
 		_pool = new std::remove_pointer_t<decltype(_pool)>;
 #endif
 
-		uint64_t sequence = start_sequence;
-		for (uint32_t size = 0; size < pool_size; size += chunk_size)
-		{
-			uint32_t allocation_size = chunk_size;
-			if (size + chunk_size > pool_size)
-				allocation_size = pool_size - size;
-
-			AllocateChunk(sequence, allocation_size, initializer_param);
-		}
+		uint32_t target_size = std::min(initial_size, pool_size);
+		while (_allocated_size.load(std::memory_order_relaxed) < target_size)
+			Grow();
 	}
 
 	SharedObjectPool(const SharedObjectPool<T, Initializer>&) = delete;
@@ -112,9 +146,28 @@ public:
 	IntrusivePtr<T> Pop()
 	{
 		ObjectBlock* ret = nullptr;
-		if (PopObject(ret))
+
+		bool popped = PopObject(ret);
+		while (!popped && Grow())
+			popped = PopObject(ret);
+
+		if (popped)
 			return IntrusivePtr<T>(static_cast<T*>(ret), IntrusivePtrDeleter);
 
 		return IntrusivePtr<T>(nullptr);
 	}
+
+	// grows one chunk ahead of demand when less than a chunk is left, called by PoolWarmer
+	bool WarmUp()
+	{
+		if (_available_size.load(std::memory_order_relaxed) >= _chunk_size)
+			return false;
+
+		return Grow();
+	}
+
+	uint32_t AllocatedSize() const
+	{
+		return _allocated_size.load(std::memory_order_relaxed);
+	}
 };
\ No newline at end of file
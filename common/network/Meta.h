@@ -9,7 +9,6 @@
 
 struct SocketBuffer : public DynamicBuffer, RefCounter<false>
 {
-	std::array<unsigned char, 8192> reserved;
 };
 
 using SocketOptions = std::vector<std::pair<int32_t, int32_t>>;
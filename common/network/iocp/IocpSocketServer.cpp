@@ -2,9 +2,14 @@
 #include <exception>
 #include <iostream>
 #include "../../utility/Logger.h"
+#include "../../utility/Profiler.h"
+#include "../../memory/PoolWarmer.h"
 
 constexpr uint32_t CONNECTOR_SOCKET_START_ID = UINT32_MAX / 2;
 
+// sockets are created by chunk on demand or ahead of demand by PoolWarmer, never all of max socket count at startup
+constexpr uint32_t SOCKET_POOL_CHUNK_SIZE = 64;
+
 void SocketObjectDeleter(TransferStream* ptr)
 {
 	SocketObjectPool::PushDirect(static_cast<IocpConnectorStream*>(ptr));
@@ -169,6 +174,11 @@ void IocpSocketServer::IoMain(const uint32_t worker_index)
 	{
 		BOOL result = GetQueuedCompletionStatus(iocp_handle, &bytes_transferred, &completion_key, &overlapped, INFINITE);
 
+		// handlers of this completion read time of coarse clock
+		utility::CoarseClock::Refresh();
+
+		PROFILE_ZONE("IocpSocketServer::IoMain");
+
 		// OVERLAPPED IoContext 
 		IoContext* io_context = static_cast<IoContext*>(overlapped);
 
@@ -272,7 +282,8 @@ bool IocpSocketServer::Initialize(const SocketServerConfig& config)
 		_io_handles.push_back(iocp_handle);
 	}
 
-	_connector_socket_pool = new SocketObjectPool(_config.max_connectable_socket_count, _config.max_connectable_socket_count, reinterpret_cast<uint64_t>(this), CONNECTOR_SOCKET_START_ID);
+	_connector_socket_pool = new SocketObjectPool(_config.max_connectable_socket_count, SOCKET_POOL_CHUNK_SIZE, reinterpret_cast<uint64_t>(this), CONNECTOR_SOCKET_START_ID, SOCKET_POOL_CHUNK_SIZE);
+	PoolWarmer::GetInstance()->Register(_connector_socket_pool);
 
 	return true;
 }
@@ -282,7 +293,8 @@ bool IocpSocketServer::InitializeAcceptor(const SocketAddress& bind_address, con
 	if (_acceptor_stream != nullptr)
 		return false;
 
-	_acceptor_socket_pool = new SocketObjectPool(_config.max_acceptable_socket_count, _config.max_acceptable_socket_count, reinterpret_cast<uint64_t>(this));
+	_acceptor_socket_pool = new SocketObjectPool(_config.max_acceptable_socket_count, SOCKET_POOL_CHUNK_SIZE, reinterpret_cast<uint64_t>(this), 1, std::max(SOCKET_POOL_CHUNK_SIZE, _config.parallel_acceptor_count));
+	PoolWarmer::GetInstance()->Register(_acceptor_socket_pool);
 
 	Socket acceptor_socket = WSASocket(AF_INET, SOCK_STREAM, 0, NULL, 0, WSA_FLAG_OVERLAPPED);
 	if (acceptor_socket == INVALID_SOCKET)
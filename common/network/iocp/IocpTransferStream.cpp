@@ -1,6 +1,7 @@
 #include "IocpTransferStream.h"
 #include "IocpSocketServer.h"
 #include "IoContext.h"
+#include "../../engine/EngineMetrics.h"
 
 void IoContextInitializer::Initialize(IoContext* const context, const uint64_t id, const uint64_t param)
 {
@@ -94,6 +95,8 @@ SocketBuffer* IocpTransferStream::AllocateReadBuffer(bool must_allocation)
 	{
 		std::memset(buffer, 0, sizeof(OVERLAPPED) + sizeof(_IoContextStruct));
 		buffer->length = 0;
+
+		EngineMetrics::ReadBuffersInUse()->Add(1);
 		
 		return buffer;
 	}
@@ -109,6 +112,8 @@ void IocpTransferStream::ReleaseReadBuffer(SocketBuffer* const buffer)
 
 	io_context->operation_stream.Release();
 	_read_buffer_pool->Push(io_context);
+
+	EngineMetrics::ReadBuffersInUse()->Add(-1);
 }
 
 SocketBuffer* IocpTransferStream::AllocateWriteBuffer(bool must_allocation)
@@ -119,6 +124,9 @@ SocketBuffer* IocpTransferStream::AllocateWriteBuffer(bool must_allocation)
 		std::memset(buffer, 0, sizeof(OVERLAPPED) + sizeof(_IoContextStruct));
 		buffer->length = 0;
 		assert(buffer->Ref() == 0);
+
+		EngineMetrics::WriteBuffersInUse()->Add(1);
+
 		return buffer;
 	}
 
@@ -133,15 +141,18 @@ void IocpTransferStream::ReleaseWriteBuffer(SocketBuffer* const buffer)
 
 	io_context->operation_stream.Release();
 	_write_buffer_pool->Push(io_context);
+
+	EngineMetrics::WriteBuffersInUse()->Add(-1);
 }
 
 void IocpTransferStream::InitializeBufferPool(const uint32_t read_buffer_pool_size, const uint32_t read_buffer_size, const uint32_t write_buffer_pool_size, const uint32_t write_buffer_size)
 {
+	// one chunk per stream until the socket actually transfers, idle sockets keep a quarter of their buffers
 	if (_read_buffer_pool == nullptr)
-		_read_buffer_pool = new IoContextObjectPool(read_buffer_pool_size, read_buffer_pool_size / 4, read_buffer_size);
+		_read_buffer_pool = new IoContextObjectPool(read_buffer_pool_size, read_buffer_pool_size / 4, read_buffer_size, 1, read_buffer_pool_size / 4);
 
 	if (_write_buffer_pool == nullptr)
-		_write_buffer_pool = new IoContextObjectPool(write_buffer_pool_size, write_buffer_pool_size / 4, write_buffer_size);
+		_write_buffer_pool = new IoContextObjectPool(write_buffer_pool_size, write_buffer_pool_size / 4, write_buffer_size, 1, write_buffer_pool_size / 4);
 }
 
 void IocpTransferStream::SetIocpHandle(const HANDLE handle)
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Time.h"
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+
+/*
+	binary log record payload, arguments in call order
+
+	scalar	raw bytes of argument
+	string	uint16 length, bytes, '\0' (truncated to fit payload)
+*/
+namespace utility
+{
+	struct LogSite;
+
+	constexpr uint32_t BINARY_LOG_PAYLOAD_SIZE = 192;
+	constexpr uint32_t BINARY_LOG_STRING_OVERHEAD = sizeof(uint16_t) + 1;
+
+	template <typename T>
+	concept LogStringArgument = std::same_as<T, const char*> || std::same_as<T, char*>;
+
+	template <typename T>
+	concept LogScalarArgument = !LogStringArgument<T> && (std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>);
+
+	template <typename T>
+	concept LogArgument = LogStringArgument<T> || LogScalarArgument<T>;
+
+	// formats payload with printf format, returns snprintf result
+	using LogFormatter = int (*)(const char* const format, const uint8_t* const payload, char* const dest, const uint32_t dest_size);
+
+	// format id and raw arguments, formatted by logger thread
+	struct BinaryLogRecord
+	{
+		const LogSite* site = nullptr;
+		const char* format = nullptr;
+		LogFormatter formatter = nullptr;
+
+		Milliseconds time = Milliseconds(0);
+		uint32_t thread_index = 0;
+
+		// logs dropped by rate limit of site since previous record
+		uint32_t suppressed_count = 0;
+
+		uint8_t payload[BINARY_LOG_PAYLOAD_SIZE];
+	};
+
+	template <LogArgument T>
+	constexpr uint32_t LogArgumentReserve()
+	{
+		if constexpr (LogStringArgument<T>)
+			return BINARY_LOG_STRING_OVERHEAD;
+		else
+			return sizeof(T);
+	}
+
+	inline uint8_t* EncodeLogArguments(uint8_t* const dest, const uint8_t* const end)
+	{
+		return dest;
+	}
+
+	template <LogArgument T, LogArgument... Rest>
+	inline uint8_t* EncodeLogArguments(uint8_t* dest, const uint8_t* const end, const T value, const Rest... rest)
+	{
+		if constexpr (LogStringArgument<T>)
+		{
+			// keep room for following arguments
+			constexpr uint32_t reserve = (LogArgumentReserve<Rest>() + ... + 0);
+
+			std::size_t limit = static_cast<std::size_t>(end - dest) - BINARY_LOG_STRING_OVERHEAD - reserve;
+			uint16_t length = value == nullptr ? 0 : static_cast<uint16_t>(strnlen(value, limit));
+
+			std::memcpy(dest, &length, sizeof(length));
+			dest += sizeof(length);
+
+			if (length != 0)
+				std::memcpy(dest, value, length);
+
+			dest += length;
+			*dest++ = '\0';
+		}
+		else
+		{
+			std::memcpy(dest, &value, sizeof(T));
+			dest += sizeof(T);
+		}
+
+		return EncodeLogArguments(dest, end, rest...);
+	}
+
+	template <LogArgument T>
+	using LogDecodedArgument = std::conditional_t<LogStringArgument<T>, const char*, T>;
+
+	template <LogArgument T>
+	inline LogDecodedArgument<T> DecodeLogArgument(const uint8_t*& source)
+	{
+		if constexpr (LogStringArgument<T>)
+		{
+			uint16_t length;
+			std::memcpy(&length, source, sizeof(length));
+
+			const char* value = reinterpret_cast<const char*>(source + sizeof(length));
+			source += sizeof(length) + length + 1;
+
+			return value;
+		}
+		else
+		{
+			T value;
+			std::memcpy(&value, source, sizeof(T));
+			source += sizeof(T);
+
+			return value;
+		}
+	}
+
+	template <LogArgument... Args>
+	int FormatLogRecord(const char* const format, const uint8_t* const payload, char* const dest, const uint32_t dest_size)
+	{
+		const uint8_t* source = payload;
+
+		// braced initialization decodes in argument order
+		std::tuple<LogDecodedArgument<Args>...> arguments{ DecodeLogArgument<Args>(source)... };
+
+		return std::apply([&](const LogDecodedArgument<Args>&... values) {
+			return std::snprintf(dest, dest_size, format, values...);
+		}, arguments);
+	}
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "Time.h"
+#include <string>
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+namespace utility
+{
+	// per thread time taken once per loop iteration by Refresh, reading it is a load
+	// threads which never refresh read the real clocks
+	class CoarseClock
+	{
+	private:
+		struct ThreadTime
+		{
+			bool refreshed = false;
+			Nanoseconds tick = Nanoseconds(0);
+
+			// epoch is tick plus offset, offset is read again every second to follow system clock adjustment
+			Nanoseconds epoch_offset = Nanoseconds(0);
+			Nanoseconds epoch_offset_tick = Nanoseconds(0);
+		};
+
+		static ThreadTime& Current()
+		{
+			static thread_local ThreadTime thread_time;
+			return thread_time;
+		}
+
+	public:
+		static void Refresh()
+		{
+			ThreadTime& thread_time = Current();
+			thread_time.tick = CurrentTick();
+
+			if (!thread_time.refreshed || thread_time.tick - thread_time.epoch_offset_tick >= Seconds(1))
+			{
+				thread_time.epoch_offset = CurrentTimeEpoch() - thread_time.tick;
+				thread_time.epoch_offset_tick = thread_time.tick;
+			}
+
+			thread_time.refreshed = true;
+		}
+
+		// back to real clocks, for threads leaving their loop to block
+		static void Release()
+		{
+			Current().refreshed = false;
+		}
+
+		static Nanoseconds Tick()
+		{
+			const ThreadTime& thread_time = Current();
+			return thread_time.refreshed ? thread_time.tick : CurrentTick();
+		}
+
+		static Nanoseconds TimeEpoch()
+		{
+			const ThreadTime& thread_time = Current();
+			return thread_time.refreshed ? thread_time.tick + thread_time.epoch_offset : CurrentTimeEpoch();
+		}
+	};
+
+	template <TimeUnit T>
+	inline T CoarseTick()
+	{
+		return TimeCast<T>(CoarseClock::Tick());
+	}
+
+	template <TimeUnit T>
+	inline T CoarseTimeEpoch()
+	{
+		return TimeCast<T>(CoarseClock::TimeEpoch());
+	}
+
+	// invariant tsc scaled to CurrentTick, for measuring short intervals
+	// calibrated once on first use against CurrentTick, which costs 10ms of the calling thread
+	class FineClock
+	{
+	private:
+		struct Calibration
+		{
+			uint64_t base_cycle;
+			int64_t base_ns;
+			double ns_per_cycle;
+		};
+
+		static Calibration Calibrate()
+		{
+			Nanoseconds begin = CurrentTick();
+			uint64_t begin_cycle = __rdtsc();
+
+			Nanoseconds end;
+			uint64_t end_cycle;
+			do
+			{
+				end = CurrentTick();
+				end_cycle = __rdtsc();
+			} while (end - begin < Milliseconds(10));
+
+			return Calibration{ end_cycle, end.count(), static_cast<double>((end - begin).count()) / static_cast<double>(end_cycle - begin_cycle) };
+		}
+
+		static const Calibration& GetCalibration()
+		{
+			static const Calibration calibration = Calibrate();
+			return calibration;
+		}
+
+	public:
+		static Nanoseconds Now()
+		{
+			const Calibration& calibration = GetCalibration();
+
+			// signed, cycle counter of another core may be slightly behind the base
+			int64_t cycles = static_cast<int64_t>(__rdtsc() - calibration.base_cycle);
+
+			return Nanoseconds(calibration.base_ns + static_cast<int64_t>(static_cast<double>(cycles) * calibration.ns_per_cycle));
+		}
+	};
+
+	inline Nanoseconds FineTick()
+	{
+		return FineClock::Now();
+	}
+
+	// "YYYY-MM-DD hh:mm:ss" of epoch time in local timezone, formatted once per second of each thread
+	inline const std::string& CachedLocalDate(const Milliseconds epoch_time)
+	{
+		static thread_local int64_t cached_second = -1;
+		static thread_local std::string cached_date;
+
+		int64_t second = epoch_time.count() / 1000;
+		if (second != cached_second)
+		{
+			std::string date = DateTime(Milliseconds(second * 1000), LocalTimezone()).ToLocalDateString();
+
+			cached_second = second;
+			cached_date = date.substr(0, date.rfind('.'));
+		}
+
+		return cached_date;
+	}
+}
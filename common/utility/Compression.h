@@ -0,0 +1,216 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+// LZ4 block format, greedy single probe hash matcher without entropy stage
+namespace utility
+{
+	constexpr uint32_t LZ_MIN_MATCH = 4;
+	constexpr uint32_t LZ_HASH_BITS = 12;
+	constexpr uint32_t LZ_MAX_OFFSET = 65535;
+
+	// block ends with literals, match can not start in last 12 bytes
+	constexpr uint32_t LZ_LAST_LITERALS = 5;
+	constexpr uint32_t LZ_MATCH_FIND_LIMIT = 12;
+
+	inline constexpr uint32_t LzCompressBound(const uint32_t source_size)
+	{
+		return source_size + source_size / 255 + 16;
+	}
+
+	inline uint32_t LzRead32(const uint8_t* const ptr)
+	{
+		uint32_t value;
+		std::memcpy(&value, ptr, sizeof(value));
+
+		return value;
+	}
+
+	inline uint32_t LzHash(const uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+	}
+
+	inline uint8_t* LzWriteLength(uint8_t* dest, uint32_t length)
+	{
+		while (length >= 255)
+		{
+			*dest++ = 255;
+			length -= 255;
+		}
+
+		*dest++ = static_cast<uint8_t>(length);
+
+		return dest;
+	}
+
+	// compressed size, 0 if dest capacity is not enough
+	inline uint32_t LzCompress(const uint8_t* const source, const uint32_t source_size, uint8_t* const dest, const uint32_t dest_capacity)
+	{
+		std::array<uint32_t, 1 << LZ_HASH_BITS> hash_table{};
+
+		const uint8_t* input = source;
+		const uint8_t* anchor = source;
+		const uint8_t* const input_end = source + source_size;
+
+		uint8_t* output = dest;
+		uint8_t* const output_end = dest + dest_capacity;
+
+		if (source_size > LZ_MATCH_FIND_LIMIT)
+		{
+			const uint8_t* const match_find_limit = input_end - LZ_MATCH_FIND_LIMIT;
+			const uint8_t* const match_extend_limit = input_end - LZ_LAST_LITERALS;
+
+			while (input < match_find_limit)
+			{
+				uint32_t sequence = LzRead32(input);
+				uint32_t& slot = hash_table[LzHash(sequence)];
+
+				const uint8_t* reference = source + slot;
+				slot = static_cast<uint32_t>(input - source);
+
+				if (reference >= input || input - reference > LZ_MAX_OFFSET || LzRead32(reference) != sequence)
+				{
+					input++;
+					continue;
+				}
+
+				const uint8_t* match_end = input + LZ_MIN_MATCH;
+				reference += LZ_MIN_MATCH;
+
+				while (match_end < match_extend_limit && *match_end == *reference)
+				{
+					match_end++;
+					reference++;
+				}
+
+				uint32_t literal_length = static_cast<uint32_t>(input - anchor);
+				uint32_t match_length = static_cast<uint32_t>(match_end - input) - LZ_MIN_MATCH;
+
+				// token + literal length bytes + literals + offset + match length bytes
+				if (output + 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1 > output_end)
+					return 0;
+
+				uint8_t* token = output++;
+				*token = static_cast<uint8_t>((literal_length >= 15 ? 15 : literal_length) << 4);
+				if (literal_length >= 15)
+					output = LzWriteLength(output, literal_length - 15);
+
+				std::memcpy(output, anchor, literal_length);
+				output += literal_length;
+
+				uint16_t offset = static_cast<uint16_t>(input - (reference - (match_end - input)));
+				std::memcpy(output, &offset, sizeof(offset));
+				output += sizeof(offset);
+
+				*token |= static_cast<uint8_t>(match_length >= 15 ? 15 : match_length);
+				if (match_length >= 15)
+					output = LzWriteLength(output, match_length - 15);
+
+				input = match_end;
+				anchor = input;
+			}
+		}
+
+		uint32_t literal_length = static_cast<uint32_t>(input_end - anchor);
+		if (output + 1 + literal_length / 255 + 1 + literal_length > output_end)
+			return 0;
+
+		uint8_t* token = output++;
+		*token = static_cast<uint8_t>((literal_length >= 15 ? 15 : literal_length) << 4);
+		if (literal_length >= 15)
+			output = LzWriteLength(output, literal_length - 15);
+
+		std::memcpy(output, anchor, literal_length);
+		output += literal_length;
+
+		return static_cast<uint32_t>(output - dest);
+	}
+
+	// decompressed size, 0 if source is corrupted or dest capacity is not enough
+	inline uint32_t LzDecompress(const uint8_t* const source, const uint32_t source_size, uint8_t* const dest, const uint32_t dest_capacity)
+	{
+		const uint8_t* input = source;
+		const uint8_t* const input_end = source + source_size;
+
+		uint8_t* output = dest;
+		uint8_t* const output_end = dest + dest_capacity;
+
+		while (input < input_end)
+		{
+			uint8_t token = *input++;
+
+			uint32_t literal_length = token >> 4;
+			if (literal_length == 15)
+			{
+				uint8_t length_byte;
+				do
+				{
+					if (input == input_end)
+						return 0;
+
+					length_byte = *input++;
+					literal_length += length_byte;
+				} while (length_byte == 255);
+			}
+
+			if (static_cast<uint64_t>(input_end - input) < literal_length || static_cast<uint64_t>(output_end - output) < literal_length)
+				return 0;
+
+			std::memcpy(output, input, literal_length);
+			input += literal_length;
+			output += literal_length;
+
+			// last sequence has literals only
+			if (input == input_end)
+				break;
+
+			if (input_end - input < 2)
+				return 0;
+
+			uint16_t offset;
+			std::memcpy(&offset, input, sizeof(offset));
+			input += sizeof(offset);
+
+			if (offset == 0 || offset > output - dest)
+				return 0;
+
+			uint32_t match_length = token & 0x0F;
+			if (match_length == 15)
+			{
+				uint8_t length_byte;
+				do
+				{
+					if (input == input_end)
+						return 0;
+
+					length_byte = *input++;
+					match_length += length_byte;
+				} while (length_byte == 255);
+			}
+
+			match_length += LZ_MIN_MATCH;
+
+			if (static_cast<uint64_t>(output_end - output) < match_length)
+				return 0;
+
+			const uint8_t* reference = output - offset;
+
+			// overlapped match repeats last offset bytes
+			if (offset >= match_length)
+			{
+				std::memcpy(output, reference, match_length);
+				output += match_length;
+			}
+			else
+			{
+				for (uint32_t index = 0; index < match_length; index++)
+					*output++ = *reference++;
+			}
+		}
+
+		return static_cast<uint32_t>(output - dest);
+	}
+}
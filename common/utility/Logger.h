@@ -1,14 +1,26 @@
 #pragma once
 
 #include "../concurrent/LinearWorkQueue.h"
+#include "../concurrent/ProducerLaneQueue.h"
 #include "../memory/ObjectPool.h"
 #include "../memory/Buffer.h"
-#include "Time.h"
+#include "../memory/PoolWarmer.h"
+#include "BinaryLog.h"
+#include "MappedFile.h"
+#include "Clock.h"
+#include <algorithm>
+#include <iomanip>
 #include <source_location>
+#include <string>
 #include <thread>
 #include <sstream>
 #include <iostream>
 
+// levels below are removed at compile time, index of LogLevel
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL 0
+#endif
+
 namespace utility
 {
 	enum class LogLevel : uint8_t
@@ -45,6 +57,65 @@ namespace utility
 	using LogBufferPool = ObjectPool<Log, true, LogBufferInitializer>;
 	using LogQueue = atomic_queue::AtomicQueueB<Log*>;
 
+	constexpr std::array<const char*, static_cast<size_t>(LogLevel::Max) + 1> LogLevelNames{ "Info", "Warn", "Error", "Fatal", "Max" };
+
+	// one static instance per LOG call site
+	struct LogSite
+	{
+		const LogLevel log_level;
+		const std::source_location location;
+
+		// 0 = unlimited
+		const uint32_t max_per_second;
+
+		std::atomic<int64_t> window = 0;
+		std::atomic<uint32_t> window_count = 0;
+		std::atomic<uint32_t> suppressed_count = 0;
+
+		LogSite(const LogLevel log_level, const std::source_location& location, const uint32_t max_per_second)
+			: log_level(log_level), location(location), max_per_second(max_per_second) {}
+		NONCOPYABLE(LogSite)
+
+		// window reset is not exact under contention, suppressed count is handed to next accepted log
+		bool TryAcquire(const Milliseconds time, uint32_t& suppressed)
+		{
+			if (max_per_second == 0)
+				return true;
+
+			int64_t second = time.count() / 1000;
+			int64_t current_window = window.load(std::memory_order_relaxed);
+
+			if (current_window != second && window.compare_exchange_strong(current_window, second, std::memory_order_relaxed))
+				window_count.store(0, std::memory_order_relaxed);
+
+			if (window_count.fetch_add(1, std::memory_order_relaxed) >= max_per_second)
+			{
+				suppressed_count.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+
+			suppressed = suppressed_count.exchange(0, std::memory_order_relaxed);
+
+			return true;
+		}
+	};
+
+	struct BinaryLogConfig
+	{
+		// files are written as {file_prefix}.{0 ~ max_file_count - 1}.log in rotation
+		std::string file_prefix = "server";
+		uint32_t max_file_count = 8;
+		uint64_t file_size = 64 * 1024 * 1024;
+
+		// per producer thread ring
+		uint64_t initial_ring_capacity = 256;
+		uint64_t max_ring_capacity = 8192;
+	};
+
+	constexpr uint32_t MAX_LOG_PRODUCER_COUNT = 128;
+
+	using BinaryLogQueue = ProducerLaneQueue<BinaryLogRecord, MAX_LOG_PRODUCER_COUNT>;
+
 
 	class Logger
 	{
@@ -57,9 +128,21 @@ namespace utility
 		uint32_t _max_log_size;
 		uint32_t _parallelism;
 
+		// binary mode, arguments are copied into ring of calling thread and formatted by logger thread
+		bool _binary_mode = false;
+
+		BinaryLogConfig _binary_config;
+		BinaryLogQueue* _binary_queue = nullptr;
+
+		MappedFile _log_file;
+		uint32_t _log_file_sequence = 0;
+
+		std::atomic<uint64_t> _dropped_log_count = 0;
+
+		static constexpr uint32_t NO_LOG_LANE = UINT32_MAX;
+
 		void LoggerMain()
 		{
-			constexpr std::array<const char*, static_cast<size_t>(LogLevel::Max) + 1> level_str_table{ "Info", "Warn", "Error", "Fatal", "Max"};
 			std::stringstream sstream;
 
 			while(true)
@@ -69,7 +152,7 @@ namespace utility
 					Log* log;
 					while(queue->try_pop(log))
 					{
-						sstream << '[' << level_str_table[static_cast<uint8_t>(log->log_level)] << "][" << DateTime(log->time).ToLocalDateString() << "][" << log->location.file_name() <<" line:"<< log->location.line() << "][" << log->thread_id << "][ ";
+						sstream << '[' << LogLevelNames[static_cast<uint8_t>(log->log_level)] << "][" << CachedLocalDate(log->time) << '.' << std::setfill('0') << std::setw(3) << log->time.count() % 1000 << "][" << log->location.file_name() <<" line:"<< log->location.line() << "][" << log->thread_id << "][ ";
 						sstream << std::string_view(reinterpret_cast<char*>(log->message.ptr), log->message.length);
 						sstream << " ]\n";
 						
@@ -88,6 +171,109 @@ namespace utility
 			}
 		}
 
+		bool OpenNextLogFile()
+		{
+			std::string path = _binary_config.file_prefix + "." + std::to_string(_log_file_sequence++ % _binary_config.max_file_count) + ".log";
+
+			return _log_file.Open(path, _binary_config.file_size);
+		}
+
+		void WriteLogFile(const char* const data, const uint32_t size)
+		{
+			if (_log_file.Write(data, size))
+				return;
+
+			_log_file.Close();
+
+			if (!OpenNextLogFile() || !_log_file.Write(data, size))
+				std::cout.write(data, size);
+		}
+
+		void BinaryLoggerMain()
+		{
+			constexpr uint32_t drain_batch_size = 256;
+			constexpr uint32_t prefix_reserve = 512;
+			constexpr uint32_t suffix_reserve = 64;
+
+			std::vector<BinaryLogRecord> records;
+			std::vector<char> line(prefix_reserve + _max_log_size + suffix_reserve);
+
+			uint64_t reported_dropped_count = 0;
+
+			while (true)
+			{
+				records.clear();
+
+				if (_binary_queue->Drain(records, drain_batch_size) == 0)
+				{
+					std::this_thread::sleep_for(Milliseconds(1));
+					continue;
+				}
+
+				for (const BinaryLogRecord& record : records)
+				{
+					int length = std::snprintf(line.data(), prefix_reserve, "[%s][%s.%03lld][%s line:%u][%u][ ",
+						LogLevelNames[static_cast<uint8_t>(record.site->log_level)], CachedLocalDate(record.time).c_str(), static_cast<long long>(record.time.count() % 1000),
+						record.site->location.file_name(), static_cast<uint32_t>(record.site->location.line()), record.thread_index);
+
+					length = std::clamp(length, 0, static_cast<int>(prefix_reserve) - 1);
+
+					int message_length = record.formatter(record.format, record.payload, line.data() + length, _max_log_size);
+					length += std::clamp(message_length, 0, static_cast<int>(_max_log_size) - 1);
+
+					if (record.suppressed_count != 0)
+						length += std::snprintf(line.data() + length, line.size() - length, " (%u suppressed)", record.suppressed_count);
+
+					length += std::snprintf(line.data() + length, line.size() - length, " ]\n");
+
+					WriteLogFile(line.data(), static_cast<uint32_t>(length));
+				}
+
+				uint64_t dropped_count = _dropped_log_count.load(std::memory_order_relaxed);
+				if (dropped_count != reported_dropped_count)
+				{
+					int length = std::snprintf(line.data(), line.size(), "[Warn][%s][logger][ %llu logs dropped ]\n", CachedLocalDate(records.back().time).c_str(), static_cast<unsigned long long>(dropped_count - reported_dropped_count));
+					WriteLogFile(line.data(), static_cast<uint32_t>(length));
+
+					reported_dropped_count = dropped_count;
+				}
+			}
+		}
+
+		// ring of calling thread, registered on first log
+		uint32_t GetLogLane()
+		{
+			static thread_local uint32_t lane_index = _binary_queue->RegisterLane(_binary_config.initial_ring_capacity, _binary_config.max_ring_capacity);
+
+			return lane_index;
+		}
+
+		template <LogArgument... Args>
+		void PushBinaryLog(const LogSite& site, const Milliseconds time, const uint32_t suppressed_count, const char* const format, const Args... args)
+		{
+			static_assert((LogArgumentReserve<Args>() + ... + 0) <= BINARY_LOG_PAYLOAD_SIZE, "log arguments are larger than binary log payload");
+
+			uint32_t lane_index = GetLogLane();
+			if (lane_index == NO_LOG_LANE)
+			{
+				_dropped_log_count.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+
+			BinaryLogRecord record;
+			record.site = &site;
+			record.format = format;
+			record.formatter = &FormatLogRecord<Args...>;
+			record.time = time;
+			record.thread_index = lane_index;
+			record.suppressed_count = suppressed_count;
+
+			EncodeLogArguments(record.payload, record.payload + BINARY_LOG_PAYLOAD_SIZE, args...);
+
+			if (!_binary_queue->TryPush(lane_index, record))
+				_dropped_log_count.fetch_add(1, std::memory_order_relaxed);
+		}
+
 	public:
 		static void InitializeLogger(const uint32_t max_log_size, const uint32_t parallelism)
 		{
@@ -98,9 +284,11 @@ namespace utility
 
 			for (uint32_t index = 0; index < parallelism; index++)
 			{
-				LogBufferPool* pool = new LogBufferPool(1024, 8, max_log_size, 1);
+				LogBufferPool* pool = new LogBufferPool(1024, 8, max_log_size, 1, 8);
 				LogQueue* queue = new LogQueue(1024 * parallelism);
 
+				PoolWarmer::GetInstance()->Register(pool);
+
 				logger->_buffer_pool.push_back(pool);
 				logger->_log_queue.push_back(queue);
 			}
@@ -108,6 +296,22 @@ namespace utility
 			logger->_logger_routine = new std::thread(&Logger::LoggerMain, logger);
 		}
 
+		// replaces text mode, must be called before any log
+		static void InitializeBinaryLogger(const uint32_t max_log_size, const BinaryLogConfig& config)
+		{
+			Logger* logger = GetInstance();
+
+			logger->_max_log_size = max_log_size;
+			logger->_binary_config = config;
+			logger->_binary_queue = new BinaryLogQueue();
+
+			if (!logger->OpenNextLogFile())
+				throw std::exception("failed to open binary log file");
+
+			logger->_binary_mode = true;
+			logger->_logger_routine = new std::thread(&Logger::BinaryLoggerMain, logger);
+		}
+
 		static Logger* GetInstance()
 		{
 			static Logger logger;
@@ -130,13 +334,45 @@ namespace utility
 
 			_log_queue[std::hash<std::thread::id>()(log->thread_id) % _parallelism]->push(log);
 		}
+
+		template <typename... Args>
+		void Write(LogSite& site, const Milliseconds time, const char* const format, const Args... args)
+		{
+			uint32_t suppressed_count = 0;
+			if (!site.TryAcquire(time, suppressed_count))
+				return;
+
+			if (_binary_mode)
+				PushBinaryLog(site, time, suppressed_count, format, args...);
+			else
+				PushLog(site.log_level, site.location, time, format, args...);
+		}
+
+		uint64_t GetDroppedLogCount() const
+		{
+			return _dropped_log_count.load(std::memory_order_relaxed);
+		}
 	};
 }
 
 using LogLevel = utility::LogLevel;
 
+#define LOG_SITE(log_level, max_per_second, time, ...) \
+	do \
+	{ \
+		if constexpr (static_cast<uint8_t>(log_level) >= LOG_COMPILED_LEVEL) \
+		{ \
+			static utility::LogSite _log_site(log_level, std::source_location::current(), max_per_second); \
+			utility::Logger::GetInstance()->Write(_log_site, time, __VA_ARGS__); \
+		} \
+	} while (false)
+
 #define LOG(log_level, ...) \
-	utility::Logger::GetInstance()->PushLog(log_level, std::source_location::current(), utility::CurrentTimeEpoch<utility::Milliseconds>(), __VA_ARGS__);
+	LOG_SITE(log_level, 0, utility::CoarseTimeEpoch<utility::Milliseconds>(), __VA_ARGS__)
+
+// at most max_per_second logs of this call site per second
+#define LOG_LIMITED(log_level, max_per_second, ...) \
+	LOG_SITE(log_level, max_per_second, utility::CoarseTimeEpoch<utility::Milliseconds>(), __VA_ARGS__)
 
-#define LOG_AT(log_level, time, format, ...) \
-	utility::Logger::GetInstance()->PushLog(log_level, std::source_location::current(), time, format, __VA_ARGS__)
\ No newline at end of file
+#define LOG_AT(log_level, time, ...) \
+	LOG_SITE(log_level, 0, time, __VA_ARGS__)
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+
+namespace utility
+{
+	bool MappedFile::Open(const std::string& path, const uint64_t capacity)
+	{
+		Close();
+
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(capacity >> 32), static_cast<DWORD>(capacity), nullptr);
+		if (mapping == nullptr)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		void* view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, static_cast<SIZE_T>(capacity));
+		if (view == nullptr)
+		{
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+
+		_file_handle = file;
+		_mapping_handle = mapping;
+		_ptr = static_cast<uint8_t*>(view);
+		_capacity = capacity;
+		_length = 0;
+
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (_ptr == nullptr)
+			return;
+
+		UnmapViewOfFile(_ptr);
+		CloseHandle(_mapping_handle);
+
+		// mapping extends file to capacity
+		LARGE_INTEGER length;
+		length.QuadPart = static_cast<LONGLONG>(_length);
+
+		SetFilePointerEx(_file_handle, length, nullptr, FILE_BEGIN);
+		SetEndOfFile(_file_handle);
+		CloseHandle(_file_handle);
+
+		_file_handle = nullptr;
+		_mapping_handle = nullptr;
+		_ptr = nullptr;
+		_capacity = 0;
+		_length = 0;
+	}
+}
+
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "../common.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace utility
+{
+	// "Thread Unsafe"
+	// fixed size file mapped for sequential write, unwritten tail is truncated on close
+	class MappedFile
+	{
+	private:
+		void* _file_handle = nullptr;
+		void* _mapping_handle = nullptr;
+
+		uint8_t* _ptr = nullptr;
+		uint64_t _capacity = 0;
+		uint64_t _length = 0;
+
+	public:
+		MappedFile() {}
+		NONCOPYABLE(MappedFile)
+
+		// existing file is overwritten
+		bool Open(const std::string& path, const uint64_t capacity);
+		void Close();
+
+		// false if remaining capacity is not enough
+		bool Write(const void* const data, const uint64_t size)
+		{
+			if (_ptr == nullptr || size > _capacity - _length)
+				return false;
+
+			std::memcpy(_ptr + _length, data, size);
+			_length += size;
+
+			return true;
+		}
+
+		bool IsOpen() const
+		{
+			return _ptr != nullptr;
+		}
+
+		uint64_t GetLength() const
+		{
+			return _length;
+		}
+
+		~MappedFile()
+		{
+			Close();
+		}
+	};
+}
@@ -0,0 +1,434 @@
+#pragma once
+
+#include "../common.h"
+#include "../memory/Allocator.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace utility
+{
+	// threads over this count share slots, cells stay atomic so shared slot only adds contention
+	constexpr uint32_t MAX_METRIC_THREAD_SLOT = 64;
+
+	inline uint32_t GetMetricThreadSlot()
+	{
+		static std::atomic<uint32_t> next_slot = 0;
+		static thread_local uint32_t slot = next_slot.fetch_add(1, std::memory_order_relaxed) % MAX_METRIC_THREAD_SLOT;
+
+		return slot;
+	}
+
+	enum class MetricType : uint8_t
+	{
+		Counter,
+		Gauge,
+		Histogram,
+	};
+
+	class Metric
+	{
+	private:
+		const MetricType _type;
+		const std::string _name;
+		const std::string _help;
+
+		// prometheus label pairs without braces, e.g. worker="0"
+		const std::string _labels;
+
+	public:
+		Metric(const MetricType type, const std::string_view name, const std::string_view help, const std::string_view labels)
+			: _type(type), _name(name), _help(help), _labels(labels) {}
+		NONCOPYABLE(Metric)
+
+		MetricType GetType() const
+		{
+			return _type;
+		}
+
+		const std::string& GetName() const
+		{
+			return _name;
+		}
+
+		const std::string& GetHelp() const
+		{
+			return _help;
+		}
+
+		const std::string& GetLabels() const
+		{
+			return _labels;
+		}
+
+		virtual ~Metric() {}
+	};
+
+	// monotonic, every thread adds to its own cell
+	// sampled counter reads monotonic value owned by other structure when serialized, it is not added to
+	class MetricCounter final : public Metric
+	{
+	private:
+		struct Cell
+		{
+			CACHE_ALIGN std::atomic<uint64_t> value = 0;
+		};
+
+		std::array<Cell, MAX_METRIC_THREAD_SLOT> _cells;
+
+		const std::function<uint64_t()> _sampler;
+
+	public:
+		MetricCounter(const std::string_view name, const std::string_view help, const std::string_view labels, std::function<uint64_t()>&& sampler = nullptr)
+			: Metric(MetricType::Counter, name, help, labels), _sampler(std::move(sampler)) {}
+
+		void Add(const uint64_t value = 1)
+		{
+			_cells[GetMetricThreadSlot()].value.fetch_add(value, std::memory_order_relaxed);
+		}
+
+		uint64_t Value() const
+		{
+			if (_sampler != nullptr)
+				return _sampler();
+
+			uint64_t sum = 0;
+			for (const Cell& cell : _cells)
+				sum += cell.value.load(std::memory_order_relaxed);
+
+			return sum;
+		}
+	};
+
+	// Set is for single owner, Add is sharded like counter for values changed by many threads
+	class MetricGauge final : public Metric
+	{
+	private:
+		struct Cell
+		{
+			CACHE_ALIGN std::atomic<int64_t> value = 0;
+		};
+
+		std::atomic<int64_t> _value = 0;
+		std::array<Cell, MAX_METRIC_THREAD_SLOT> _deltas;
+
+		// state owned by other structure, read when serialized
+		const std::function<int64_t()> _sampler;
+
+	public:
+		MetricGauge(const std::string_view name, const std::string_view help, const std::string_view labels, std::function<int64_t()>&& sampler = nullptr)
+			: Metric(MetricType::Gauge, name, help, labels), _sampler(std::move(sampler)) {}
+
+		void Set(const int64_t value)
+		{
+			_value.store(value, std::memory_order_relaxed);
+		}
+
+		void Add(const int64_t delta)
+		{
+			_deltas[GetMetricThreadSlot()].value.fetch_add(delta, std::memory_order_relaxed);
+		}
+
+		int64_t Value() const
+		{
+			if (_sampler != nullptr)
+				return _sampler();
+
+			int64_t sum = _value.load(std::memory_order_relaxed);
+			for (const Cell& cell : _deltas)
+				sum += cell.value.load(std::memory_order_relaxed);
+
+			return sum;
+		}
+	};
+
+	/*
+		log linear buckets like HdrHistogram, relative error is under 1 / METRIC_HISTOGRAM_SUB_BUCKET_COUNT
+		values under sub bucket count have their own bucket, others are split by highest bit and next sub bucket bits
+	*/
+	constexpr uint32_t METRIC_HISTOGRAM_SUB_BUCKET_BITS = 3;
+	constexpr uint32_t METRIC_HISTOGRAM_SUB_BUCKET_COUNT = 1 << METRIC_HISTOGRAM_SUB_BUCKET_BITS;
+
+	// values over 2^40 are counted in last bucket
+	constexpr uint32_t METRIC_HISTOGRAM_MAX_VALUE_BITS = 40;
+	constexpr uint32_t METRIC_HISTOGRAM_BUCKET_COUNT = (METRIC_HISTOGRAM_MAX_VALUE_BITS - METRIC_HISTOGRAM_SUB_BUCKET_BITS + 1) * METRIC_HISTOGRAM_SUB_BUCKET_COUNT;
+
+	inline uint32_t GetHistogramBucketIndex(const uint64_t value)
+	{
+		if (value < METRIC_HISTOGRAM_SUB_BUCKET_COUNT)
+			return static_cast<uint32_t>(value);
+
+		uint32_t exponent = static_cast<uint32_t>(std::bit_width(value)) - 1;
+		if (exponent >= METRIC_HISTOGRAM_MAX_VALUE_BITS)
+			return METRIC_HISTOGRAM_BUCKET_COUNT - 1;
+
+		uint32_t shift = exponent - METRIC_HISTOGRAM_SUB_BUCKET_BITS;
+		uint32_t sub_bucket = static_cast<uint32_t>(value >> shift) & (METRIC_HISTOGRAM_SUB_BUCKET_COUNT - 1);
+
+		return (shift + 1) * METRIC_HISTOGRAM_SUB_BUCKET_COUNT + sub_bucket;
+	}
+
+	// largest value counted in bucket
+	inline uint64_t GetHistogramBucketUpperBound(const uint32_t index)
+	{
+		if (index < METRIC_HISTOGRAM_SUB_BUCKET_COUNT)
+			return index;
+
+		uint32_t shift = index / METRIC_HISTOGRAM_SUB_BUCKET_COUNT - 1;
+		uint64_t sub_bucket = index % METRIC_HISTOGRAM_SUB_BUCKET_COUNT + METRIC_HISTOGRAM_SUB_BUCKET_COUNT;
+
+		return ((sub_bucket + 1) << shift) - 1;
+	}
+
+	struct HistogramSnapshot
+	{
+		std::array<uint64_t, METRIC_HISTOGRAM_BUCKET_COUNT> buckets{};
+		uint64_t count = 0;
+		uint64_t sum = 0;
+
+		// upper bound of bucket containing quantile, 0 if empty
+		uint64_t Quantile(const double quantile) const
+		{
+			if (count == 0)
+				return 0;
+
+			uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(count - 1)) + 1;
+			uint64_t seen = 0;
+
+			for (uint32_t index = 0; index < METRIC_HISTOGRAM_BUCKET_COUNT; index++)
+			{
+				seen += buckets[index];
+				if (seen >= rank)
+					return GetHistogramBucketUpperBound(index);
+			}
+
+			return GetHistogramBucketUpperBound(METRIC_HISTOGRAM_BUCKET_COUNT - 1);
+		}
+	};
+
+	// unit of value is part of metric name, e.g. _us, _bytes
+	class MetricHistogram final : public Metric
+	{
+	private:
+		struct Cells
+		{
+			std::array<std::atomic<uint64_t>, METRIC_HISTOGRAM_BUCKET_COUNT> buckets{};
+			std::atomic<uint64_t> sum = 0;
+		};
+
+		// allocated on first record of each thread slot
+		std::array<std::atomic<Cells*>, MAX_METRIC_THREAD_SLOT> _cells{};
+
+		Cells* GetCells()
+		{
+			std::atomic<Cells*>& slot = _cells[GetMetricThreadSlot()];
+
+			Cells* cells = slot.load(std::memory_order_acquire);
+			if (cells != nullptr)
+				return cells;
+
+			Cells* new_cells = new Cells();
+			if (slot.compare_exchange_strong(cells, new_cells, std::memory_order_acq_rel))
+				return new_cells;
+
+			delete new_cells;
+			return cells;
+		}
+
+	public:
+		MetricHistogram(const std::string_view name, const std::string_view help, const std::string_view labels) : Metric(MetricType::Histogram, name, help, labels) {}
+
+		void Record(const uint64_t value)
+		{
+			Cells* cells = GetCells();
+
+			cells->buckets[GetHistogramBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+			cells->sum.fetch_add(value, std::memory_order_relaxed);
+		}
+
+		void Snapshot(HistogramSnapshot& snapshot) const
+		{
+			snapshot = HistogramSnapshot{};
+
+			for (const std::atomic<Cells*>& slot : _cells)
+			{
+				const Cells* cells = slot.load(std::memory_order_acquire);
+				if (cells == nullptr)
+					continue;
+
+				for (uint32_t index = 0; index < METRIC_HISTOGRAM_BUCKET_COUNT; index++)
+				{
+					uint64_t count = cells->buckets[index].load(std::memory_order_relaxed);
+
+					snapshot.buckets[index] += count;
+					snapshot.count += count;
+				}
+
+				snapshot.sum += cells->sum.load(std::memory_order_relaxed);
+			}
+		}
+
+		~MetricHistogram()
+		{
+			for (std::atomic<Cells*>& slot : _cells)
+				delete slot.load(std::memory_order_relaxed);
+		}
+	};
+
+	// instruments live until process exit, so recording thread keeps raw pointer without lock
+	class MetricRegistry
+	{
+	private:
+		std::mutex _registration_mutex;
+		std::vector<std::unique_ptr<Metric>> _metrics;
+
+		// sampler of existing metric is kept, label sets of sampled metrics must be unique
+		template <typename T, typename... Args>
+		T* GetOrCreate(const MetricType type, const std::string_view name, const std::string_view help, const std::string_view labels, Args&&... args)
+		{
+			std::lock_guard<std::mutex> guard(_registration_mutex);
+
+			for (const std::unique_ptr<Metric>& metric : _metrics)
+			{
+				if (metric->GetName() != name || metric->GetLabels() != labels)
+					continue;
+
+				if (metric->GetType() != type)
+					throw std::exception("metric is registered with another type");
+
+				return static_cast<T*>(metric.get());
+			}
+
+			T* metric = new T(name, help, labels, std::forward<Args>(args)...);
+			_metrics.emplace_back(metric);
+
+			return metric;
+		}
+
+		static void AppendSample(std::string& output, const std::string_view name, const std::string& labels, const std::string_view extra_label, const std::string_view value)
+		{
+			output += name;
+
+			if (!labels.empty() || !extra_label.empty())
+			{
+				output += '{';
+				output += labels;
+
+				if (!labels.empty() && !extra_label.empty())
+					output += ',';
+
+				output += extra_label;
+				output += '}';
+			}
+
+			output += ' ';
+			output += value;
+			output += '\n';
+		}
+
+	public:
+		static MetricRegistry* GetInstance()
+		{
+			static MetricRegistry registry;
+			return &registry;
+		}
+
+		MetricCounter* Counter(const std::string_view name, const std::string_view help, const std::string_view labels = "")
+		{
+			return GetOrCreate<MetricCounter>(MetricType::Counter, name, help, labels);
+		}
+
+		MetricGauge* Gauge(const std::string_view name, const std::string_view help, const std::string_view labels = "")
+		{
+			return GetOrCreate<MetricGauge>(MetricType::Gauge, name, help, labels);
+		}
+
+		MetricHistogram* Histogram(const std::string_view name, const std::string_view help, const std::string_view labels = "")
+		{
+			return GetOrCreate<MetricHistogram>(MetricType::Histogram, name, help, labels);
+		}
+
+		// sampler is called by serializing thread, it must only read atomics or immutable state
+		MetricCounter* SampledCounter(const std::string_view name, const std::string_view help, const std::string_view labels, std::function<uint64_t()>&& sampler)
+		{
+			return GetOrCreate<MetricCounter>(MetricType::Counter, name, help, labels, std::move(sampler));
+		}
+
+		MetricGauge* SampledGauge(const std::string_view name, const std::string_view help, const std::string_view labels, std::function<int64_t()>&& sampler)
+		{
+			return GetOrCreate<MetricGauge>(MetricType::Gauge, name, help, labels, std::move(sampler));
+		}
+
+		// prometheus text exposition format, histograms are exported as summary with quantiles
+		std::string Serialize()
+		{
+			constexpr std::array<std::pair<double, std::string_view>, 5> quantiles{ {
+				{ 0.5, "quantile=\"0.5\"" },
+				{ 0.9, "quantile=\"0.9\"" },
+				{ 0.99, "quantile=\"0.99\"" },
+				{ 0.999, "quantile=\"0.999\"" },
+				{ 1.0, "quantile=\"1\"" },
+			} };
+
+			std::vector<Metric*> metrics;
+			{
+				std::lock_guard<std::mutex> guard(_registration_mutex);
+
+				for (const std::unique_ptr<Metric>& metric : _metrics)
+					metrics.push_back(metric.get());
+			}
+
+			// HELP and TYPE once per name, samples of same name must be adjacent
+			std::stable_sort(metrics.begin(), metrics.end(), [](const Metric* left, const Metric* right) {
+				return left->GetName() < right->GetName();
+			});
+
+			std::string output;
+			output.reserve(metrics.size() * 128);
+
+			HistogramSnapshot snapshot;
+			const std::string* previous_name = nullptr;
+
+			for (const Metric* metric : metrics)
+			{
+				if (previous_name == nullptr || *previous_name != metric->GetName())
+				{
+					constexpr std::array<const char*, 3> type_names{ "counter", "gauge", "summary" };
+
+					output += "# HELP " + metric->GetName() + ' ' + metric->GetHelp() + '\n';
+					output += "# TYPE " + metric->GetName() + ' ' + type_names[static_cast<uint8_t>(metric->GetType())] + '\n';
+
+					previous_name = &metric->GetName();
+				}
+
+				switch (metric->GetType())
+				{
+				case MetricType::Counter:
+					AppendSample(output, metric->GetName(), metric->GetLabels(), "", std::to_string(static_cast<const MetricCounter*>(metric)->Value()));
+					break;
+				case MetricType::Gauge:
+					AppendSample(output, metric->GetName(), metric->GetLabels(), "", std::to_string(static_cast<const MetricGauge*>(metric)->Value()));
+					break;
+				case MetricType::Histogram:
+					static_cast<const MetricHistogram*>(metric)->Snapshot(snapshot);
+
+					for (const std::pair<double, std::string_view>& quantile : quantiles)
+						AppendSample(output, metric->GetName(), metric->GetLabels(), quantile.second, std::to_string(snapshot.Quantile(quantile.first)));
+
+					AppendSample(output, metric->GetName() + "_sum", metric->GetLabels(), "", std::to_string(snapshot.sum));
+					AppendSample(output, metric->GetName() + "_count", metric->GetLabels(), "", std::to_string(snapshot.count));
+					break;
+				}
+			}
+
+			return output;
+		}
+	};
+}
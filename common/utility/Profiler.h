@@ -0,0 +1,183 @@
+#pragma once
+
+#include "../common.h"
+#include "../memory/Allocator.h"
+#include "Clock.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace utility
+{
+	struct ProfileZoneRecord
+	{
+		// string literal of PROFILE_ZONE
+		const char* name = nullptr;
+		int64_t start_ns = 0;
+		int64_t end_ns = 0;
+	};
+
+	constexpr uint64_t PROFILER_RING_CAPACITY = 1 << 16;
+
+	// Single Provider / Any Reader, oldest zones are overwritten
+	class ProfilerRing
+	{
+	private:
+		std::array<ProfileZoneRecord, PROFILER_RING_CAPACITY> _records;
+		CACHE_ALIGN std::atomic<uint64_t> _head = 0;
+
+		const uint32_t _thread_index;
+
+	public:
+		ProfilerRing(const uint32_t thread_index) : _thread_index(thread_index) {}
+		NONCOPYABLE(ProfilerRing)
+
+		// owner thread only
+		void Push(const char* const name, const int64_t start_ns, const int64_t end_ns)
+		{
+			uint64_t head = _head.load(std::memory_order_relaxed);
+
+			_records[head & (PROFILER_RING_CAPACITY - 1)] = ProfileZoneRecord{ name, start_ns, end_ns };
+			_head.store(head + 1, std::memory_order_release);
+		}
+
+		// zones ended after since_ns, records overwritten while copying are discarded
+		void Collect(std::vector<ProfileZoneRecord>& result, const int64_t since_ns) const
+		{
+			uint64_t head = _head.load(std::memory_order_acquire);
+			uint64_t begin = head > PROFILER_RING_CAPACITY ? head - PROFILER_RING_CAPACITY : 0;
+
+			std::size_t offset = result.size();
+			for (uint64_t index = begin; index < head; index++)
+				result.push_back(_records[index & (PROFILER_RING_CAPACITY - 1)]);
+
+			// owner may be writing the slot after its head
+			uint64_t after = _head.load(std::memory_order_acquire);
+			uint64_t valid_begin = after + 1 > PROFILER_RING_CAPACITY ? after + 1 - PROFILER_RING_CAPACITY : 0;
+
+			std::size_t skip = static_cast<std::size_t>(valid_begin > begin ? std::min(valid_begin - begin, head - begin) : 0);
+			result.erase(result.begin() + offset, result.begin() + offset + skip);
+
+			std::erase_if(result, [since_ns](const ProfileZoneRecord& record) {
+				return record.end_ns < since_ns;
+			});
+		}
+
+		uint32_t GetThreadIndex() const
+		{
+			return _thread_index;
+		}
+	};
+
+	class Profiler
+	{
+	private:
+		std::mutex _registration_mutex;
+
+		// rings of exited threads are kept for dump
+		std::vector<ProfilerRing*> _rings;
+
+		ProfilerRing* RegisterRing()
+		{
+			std::lock_guard<std::mutex> guard(_registration_mutex);
+
+			ProfilerRing* ring = new ProfilerRing(static_cast<uint32_t>(_rings.size()));
+			_rings.push_back(ring);
+
+			return ring;
+		}
+
+	public:
+		static Profiler* GetInstance()
+		{
+			static Profiler profiler;
+			return &profiler;
+		}
+
+		ProfilerRing* GetThreadRing()
+		{
+			static thread_local ProfilerRing* ring = RegisterRing();
+
+			return ring;
+		}
+
+		// chrome trace event format of zones ended in last duration, open with chrome://tracing or perfetto
+		std::string ExportChromeTrace(const Nanoseconds duration)
+		{
+			std::vector<ProfilerRing*> rings;
+			{
+				std::lock_guard<std::mutex> guard(_registration_mutex);
+				rings = _rings;
+			}
+
+			int64_t since_ns = (CurrentTick() - duration).count();
+
+			std::string output = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+			bool first = true;
+
+			std::vector<ProfileZoneRecord> records;
+			char event[256];
+
+			for (const ProfilerRing* ring : rings)
+			{
+				records.clear();
+				ring->Collect(records, since_ns);
+
+				for (const ProfileZoneRecord& record : records)
+				{
+					int length = std::snprintf(event, sizeof(event), "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+						first ? "" : ",", record.name, ring->GetThreadIndex(), static_cast<double>(record.start_ns) / 1000.0, static_cast<double>(record.end_ns - record.start_ns) / 1000.0);
+
+					output.append(event, std::clamp(length, 0, static_cast<int>(sizeof(event)) - 1));
+					first = false;
+				}
+			}
+
+			output += "]}";
+
+			return output;
+		}
+
+		bool DumpChromeTrace(const std::string& path, const Nanoseconds duration)
+		{
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			if (!file)
+				return false;
+
+			file << ExportChromeTrace(duration);
+
+			return static_cast<bool>(file);
+		}
+	};
+
+	class ProfileZone
+	{
+	private:
+		const char* const _name;
+		const int64_t _start_ns;
+
+	public:
+		ProfileZone(const char* const name) : _name(name), _start_ns(FineTick().count()) {}
+		NONCOPYABLE(ProfileZone)
+
+		~ProfileZone()
+		{
+			Profiler::GetInstance()->GetThreadRing()->Push(_name, _start_ns, FineTick().count());
+		}
+	};
+}
+
+#define PROFILE_ACTUALLY_JOIN(x, y) x##y
+#define PROFILE_JOIN(x, y) PROFILE_ACTUALLY_JOIN(x, y)
+
+// zones are recorded only when USE_PROFILER is defined, name must be string literal
+#ifdef USE_PROFILER
+#define PROFILE_ZONE(name) const utility::ProfileZone PROFILE_JOIN(_profile_zone_, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name)
+#endif
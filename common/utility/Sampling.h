@@ -1,9 +1,10 @@
 #pragma once
 
-#include "Time.h"
+#include "Clock.h"
 
 namespace utility
 {
+	// samplers read coarse clock of the calling thread, accurate to its last refresh
 	template<TimeUnit T>
 	class Timer
 	{
@@ -13,11 +14,11 @@ namespace utility
 
 	public:
 		Timer() : Timer(T(0)) {}
-		Timer(const T tick) : _tick(tick), _last_tick_time(CurrentTick<T>()) {}
+		Timer(const T tick) : _tick(tick), _last_tick_time(CoarseTick<T>()) {}
 
 		operator bool() const
 		{
-			T current_tick = CurrentTick<T>();
+			T current_tick = CoarseTick<T>();
 
 			if (_last_tick_time + _tick < current_tick)
 			{
@@ -38,12 +39,12 @@ namespace utility
 
 	public:
 		Countdown() : Countdown(T(0)) {}
-		Countdown(const T delay) : _delay(delay), _start_time(CurrentTick<T>()) {}
+		Countdown(const T delay) : _delay(delay), _start_time(CoarseTick<T>()) {}
 		Countdown(const Countdown<T>& countdown) : _delay(countdown._delay), _start_time(countdown._start_time) {}
 
 		operator bool() const
 		{
-			T current_tick = CurrentTick<T>();
+			T current_tick = CoarseTick<T>();
 
 			if (_start_time + _delay < current_tick)
 				return true;
@@ -74,12 +75,12 @@ namespace utility
 		void Set()
 		{
 			_is_on = true;
-			_last_enabled_time = CurrentTick<T>();
+			_last_enabled_time = CoarseTick<T>();
 		}
 
 		operator bool() const
 		{
-			if (_is_on && _last_enabled_time + _delay < CurrentTick<T>())
+			if (_is_on && _last_enabled_time + _delay < CoarseTick<T>())
 			{
 				_is_on = false;
 				return true;
@@ -97,11 +98,11 @@ namespace utility
 		mutable T _last_execution_time;
 
 	public:
-		Throttler(const T tick) : _tick(tick), _last_execution_time(CurrentTick<T>()) {}
+		Throttler(const T tick) : _tick(tick), _last_execution_time(CoarseTick<T>()) {}
 
 		operator bool() const
 		{
-			T current_tick = CurrentTick<T>();
+			T current_tick = CoarseTick<T>();
 
 			if (_last_execution_time + _tick <= current_tick)
 			{
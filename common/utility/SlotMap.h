@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace utility
+{
+	// index of slot and generation of it, handle of erased entry never matches again
+	struct SlotHandle
+	{
+		uint32_t index = UINT32_MAX;
+		uint32_t generation = 0;
+
+		bool Valid() const
+		{
+			return index != UINT32_MAX;
+		}
+
+		bool operator==(const SlotHandle& other) const = default;
+	};
+
+	// values are kept dense for linear iteration, slots map handles to values
+	// erase moves last value into erased place, so pointers to values are valid until next erase or emplace
+	template <typename T>
+	class SlotMap
+	{
+	private:
+		struct Slot
+		{
+			// dense index of live slot, next free slot of free one
+			uint32_t index;
+			uint32_t generation;
+		};
+
+		std::vector<Slot> _slots;
+		std::vector<T> _values;
+		std::vector<uint32_t> _value_slots;
+
+		uint32_t _free_slot = UINT32_MAX;
+
+	public:
+		template <typename... Args>
+		SlotHandle Emplace(Args&&... args)
+		{
+			uint32_t slot_index = _free_slot;
+			if (slot_index == UINT32_MAX)
+			{
+				slot_index = static_cast<uint32_t>(_slots.size());
+				_slots.push_back(Slot{ UINT32_MAX, 1 });
+			}
+			else
+				_free_slot = _slots[slot_index].index;
+
+			Slot& slot = _slots[slot_index];
+			slot.index = static_cast<uint32_t>(_values.size());
+
+			_values.emplace_back(std::forward<Args>(args)...);
+			_value_slots.push_back(slot_index);
+
+			return SlotHandle{ slot_index, slot.generation };
+		}
+
+		// nullptr for stale or invalid handle
+		T* Find(const SlotHandle handle)
+		{
+			if (handle.index >= _slots.size() || _slots[handle.index].generation != handle.generation)
+				return nullptr;
+
+			return &_values[_slots[handle.index].index];
+		}
+
+		const T* Find(const SlotHandle handle) const
+		{
+			return const_cast<SlotMap<T>*>(this)->Find(handle);
+		}
+
+		bool Contains(const SlotHandle handle) const
+		{
+			return Find(handle) != nullptr;
+		}
+
+		// false for stale or invalid handle
+		bool Erase(const SlotHandle handle)
+		{
+			if (!Contains(handle))
+				return false;
+
+			Slot& slot = _slots[handle.index];
+
+			uint32_t last_index = static_cast<uint32_t>(_values.size() - 1);
+			if (slot.index != last_index)
+			{
+				_values[slot.index] = std::move(_values[last_index]);
+				_value_slots[slot.index] = _value_slots[last_index];
+				_slots[_value_slots[slot.index]].index = slot.index;
+			}
+
+			_values.pop_back();
+			_value_slots.pop_back();
+
+			slot.index = _free_slot;
+			slot.generation++;
+			_free_slot = handle.index;
+
+			return true;
+		}
+
+		// handle of value at dense index, for erasing while iterating by index
+		SlotHandle HandleAt(const std::size_t value_index) const
+		{
+			assert(value_index < _values.size());
+
+			uint32_t slot_index = _value_slots[value_index];
+			return SlotHandle{ slot_index, _slots[slot_index].generation };
+		}
+
+		void Clear()
+		{
+			// erased one by one, so handles of cleared values become stale
+			while (!_values.empty())
+				Erase(HandleAt(_values.size() - 1));
+		}
+
+		std::size_t Size() const
+		{
+			return _values.size();
+		}
+
+		bool Empty() const
+		{
+			return _values.empty();
+		}
+
+		T& operator[](const std::size_t value_index)
+		{
+			return _values[value_index];
+		}
+
+		const T& operator[](const std::size_t value_index) const
+		{
+			return _values[value_index];
+		}
+
+		auto begin() { return _values.begin(); }
+		auto end() { return _values.end(); }
+		auto begin() const { return _values.begin(); }
+		auto end() const { return _values.end(); }
+	};
+}
@@ -66,6 +66,13 @@ namespace utility
 		return std::chrono::locate_zone(name);
 	}
 
+	// looked up once, tz database search is too slow for every conversion
+	inline const Timezone* LocalTimezone()
+	{
+		static const Timezone* timezone = std::chrono::current_zone();
+		return timezone;
+	}
+
 	template <TimeUnit CastUnit, TimeUnit OriginUnit>
 	inline CastUnit TimeCast(const OriginUnit& org)
 	{
@@ -129,7 +136,7 @@ namespace utility
 		}
 
 		template <TimeUnit T>
-		DateTime(const T epoch_time) : DateTime(epoch_time, std::chrono::current_zone()) {}
+		DateTime(const T epoch_time) : DateTime(epoch_time, LocalTimezone()) {}
 
 		DateTime(const uint32_t year, const uint32_t month, const uint32_t day, const uint32_t hour, const uint32_t minute, const uint32_t second, const Timezone* timezone)
 			: _ymd(std::chrono::year(year), std::chrono::month(month), std::chrono::day(day)), _hms(Seconds(hour * 3600 + minute * 60 + second))
@@ -139,7 +146,7 @@ namespace utility
 
 		DateTime(const Timezone* const timezone) : DateTime(std::chrono::duration_cast<Nanoseconds>(std::chrono::system_clock::now().time_since_epoch()), timezone) {}
 
-		DateTime() : DateTime(std::chrono::duration_cast<Nanoseconds>(std::chrono::system_clock::now().time_since_epoch())) {}
+		DateTime() : DateTime(std::chrono::duration_cast<Nanoseconds>(std::chrono::system_clock::now().time_since_epoch()), LocalTimezone()) {}
 
 		template <TimeUnit T = Nanoseconds>
 		T ToEpochTimestamp()
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "../common.h"
+#include "Time.h"
+#include <atomic>
+#include <cstdint>
+
+/*
+	packet latency tracing, trace context travels in packet header
+
+	hop		one packet handled by one worker, a traced handler stamps its trace id on packets it sends
+	time	truncated microsecond tick, hops on different hosts do not share tick so network time is meaningful on same host only
+*/
+namespace utility
+{
+	inline uint32_t CurrentTraceTime()
+	{
+		return static_cast<uint32_t>(CurrentTick<Microseconds>().count());
+	}
+
+	// elapsed microseconds between two truncated ticks, 0 if one of them is not recorded
+	inline uint32_t TraceElapsed(const uint32_t begin_us, const uint32_t end_us)
+	{
+		if (begin_us == 0 || end_us == 0)
+			return 0;
+
+		int32_t elapsed = static_cast<int32_t>(end_us - begin_us);
+
+		return elapsed < 0 ? 0 : static_cast<uint32_t>(elapsed);
+	}
+
+	struct TraceSpan
+	{
+		uint32_t trace_id = 0;
+
+		// stamped by previous hop
+		uint32_t sent_us = 0;
+
+		uint32_t receive_us = 0;
+		uint32_t enqueue_us = 0;
+		uint32_t dequeue_us = 0;
+		uint32_t handle_begin_us = 0;
+		uint32_t handle_end_us = 0;
+
+		// first traced packet sent by handler
+		uint32_t send_us = 0;
+	};
+
+	// handler of traced packet runs inside scope, nested scope is restored on exit
+	class TraceScope
+	{
+	private:
+		TraceSpan& _span;
+		TraceSpan* const _previous;
+
+	public:
+		static TraceSpan*& Current()
+		{
+			static thread_local TraceSpan* span = nullptr;
+			return span;
+		}
+
+		TraceScope(TraceSpan& span) : _span(span), _previous(Current())
+		{
+			Current() = &span;
+			span.handle_begin_us = CurrentTraceTime();
+		}
+
+		NONCOPYABLE(TraceScope)
+
+		~TraceScope()
+		{
+			_span.handle_end_us = CurrentTraceTime();
+			Current() = _previous;
+		}
+	};
+
+	// trace context of outbound packet, zero outside traced handler
+	inline void StampTrace(uint32_t& trace_id, uint32_t& sent_us)
+	{
+		TraceSpan* span = TraceScope::Current();
+		if (span == nullptr)
+			return;
+
+		uint32_t now_us = CurrentTraceTime();
+
+		trace_id = span->trace_id;
+		sent_us = now_us;
+
+		if (span->send_us == 0)
+			span->send_us = now_us;
+	}
+
+	// one of interval calls on this thread starts a trace, 0 = never
+	inline uint32_t SampleTraceId(const uint32_t interval)
+	{
+		static thread_local uint32_t countdown = 0;
+		static std::atomic<uint32_t> next_trace_id = static_cast<uint32_t>(CurrentTimeEpoch().count()) | 1;
+
+		if (interval == 0)
+			return 0;
+
+		if (countdown > 1)
+		{
+			countdown--;
+			return 0;
+		}
+
+		countdown = interval;
+
+		uint32_t trace_id = next_trace_id.fetch_add(1, std::memory_order_relaxed);
+
+		return trace_id == 0 ? next_trace_id.fetch_add(1, std::memory_order_relaxed) : trace_id;
+	}
+}
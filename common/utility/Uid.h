@@ -1,52 +1,257 @@
 #pragma once
 
-#include <stdlib.h>
+#include <array>
+#include <cassert>
 #include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 #include "../memory/Allocator.h"
-#include "Time.h"
+#include "Clock.h"
 
-enum class UidType
+// type 0 is never generated, so 0 stays free for "no id"
+enum class UidType : uint8_t
 {
 	User = 1,
 	Fixture = 2,
 	Object = 3,
-	Max = 4,
+	Session = 4,
+	Max = 5,
 };
 
-struct UidBlock
+// snowflake layout, from high bit
+// | 0 (1) | type (3) | server id (12) | time (31) | lane (6) | sequence (11) |
+// time is seconds since UID_EPOCH_SECONDS, about 68 years
+constexpr uint32_t UID_SEQUENCE_BITS = 11;
+constexpr uint32_t UID_LANE_BITS = 6;
+constexpr uint32_t UID_TIME_BITS = 31;
+constexpr uint32_t UID_SERVER_BITS = 12;
+constexpr uint32_t UID_TYPE_BITS = 3;
+
+constexpr uint32_t UID_LANE_SHIFT = UID_SEQUENCE_BITS;
+constexpr uint32_t UID_TIME_SHIFT = UID_LANE_SHIFT + UID_LANE_BITS;
+constexpr uint32_t UID_SERVER_SHIFT = UID_TIME_SHIFT + UID_TIME_BITS;
+constexpr uint32_t UID_TYPE_SHIFT = UID_SERVER_SHIFT + UID_SERVER_BITS;
+
+static_assert(UID_TYPE_SHIFT + UID_TYPE_BITS == 63);
+static_assert(static_cast<uint32_t>(UidType::Max) <= (1u << UID_TYPE_BITS));
+
+constexpr uint32_t UID_LANE_COUNT = 1u << UID_LANE_BITS;
+constexpr uint32_t UID_SEQUENCE_COUNT = 1u << UID_SEQUENCE_BITS;
+constexpr uint64_t UID_MAX_SERVER_ID = (1ull << UID_SERVER_BITS) - 1;
+
+// 2025-01-01 00:00:00 UTC
+constexpr int64_t UID_EPOCH_SECONDS = 1735689600;
+
+// a lane runs ahead of wall clock at most this much, restarted server waits it out before generating
+constexpr uint32_t UID_MAX_LEAD_SECONDS = 1;
+
+struct UidInfo
 {
-	CACHE_ALIGN std::atomic<uint64_t> current_number;
+	UidType type;
+	uint64_t server_id;
+	utility::Seconds time_epoch;
+	uint32_t lane;
+	uint32_t sequence;
+
+	std::string ToString() const
+	{
+		char text[128];
+		int length = std::snprintf(text, sizeof(text), "type: %u, server: %llu, time: %lld, lane: %u, sequence: %u",
+			static_cast<uint32_t>(type), static_cast<unsigned long long>(server_id), static_cast<long long>(time_epoch.count()), lane, sequence);
+
+		return std::string(text, length);
+	}
 };
 
+// cluster unique id, unique while server id is unique among running servers
+// each generating thread owns a lane, so generation reads and writes its own block only
+// a lane which runs out of sequence borrows next second up to UID_MAX_LEAD_SECONDS, then waits for wall clock
 class UidGenerator
 {
 private:
-	UidBlock* _block;
-	size_t _block_size;
+	// returns automatic lane of exiting thread, next owner continues its blocks
+	struct LaneHolder
+	{
+		uint32_t lane = UINT32_MAX;
+
+		~LaneHolder()
+		{
+			if (lane != UINT32_MAX)
+				UidGenerator::GetInstance()->ReleaseLane(lane);
+		}
+	};
+
+	struct UidBlock
+	{
+		uint32_t time = 0;
+		uint32_t sequence = 0;
+	};
+
+	struct UidLane
+	{
+		CACHE_ALIGN std::array<UidBlock, static_cast<std::size_t>(UidType::Max)> blocks;
+	};
+
+	std::array<UidLane, UID_LANE_COUNT> _lanes;
+
+	// explicit lanes are reserved from 0, automatic lanes are taken from the top
+	std::mutex _lane_mutex;
+	uint32_t _reserved_lane_count = 0;
+	uint32_t _automatic_lane_count = 0;
+
+	// automatic lanes of exited threads
+	std::vector<uint32_t> _free_lanes;
+
+	std::atomic<uint64_t> _server_id = 0;
+
+	// uid time is never below it, see Initialize
+	std::atomic<uint32_t> _time_floor = 0;
+
+	// UINT32_MAX if every lane is taken
+	uint32_t AcquireLane()
+	{
+		std::lock_guard<std::mutex> guard(_lane_mutex);
+
+		if (!_free_lanes.empty())
+		{
+			uint32_t lane = _free_lanes.back();
+			_free_lanes.pop_back();
+
+			return lane;
+		}
+
+		if (_reserved_lane_count + _automatic_lane_count >= UID_LANE_COUNT)
+			return UINT32_MAX;
+
+		return UID_LANE_COUNT - 1 - _automatic_lane_count++;
+	}
+
+	void ReleaseLane(const uint32_t lane)
+	{
+		std::lock_guard<std::mutex> guard(_lane_mutex);
+
+		_free_lanes.push_back(lane);
+	}
+
+	static uint32_t CurrentUidTime()
+	{
+		return static_cast<uint32_t>(utility::CurrentTimeEpoch<utility::Seconds>().count() - UID_EPOCH_SECONDS);
+	}
+
+	UidGenerator() = default;
 
 public:
+	NONCOPYABLE(UidGenerator)
+
+	static UidGenerator* GetInstance()
+	{
+		static UidGenerator generator;
+		return &generator;
+	}
+
+	// ids generated before server id is assigned carry server id 0
+	// new server id is usable after wall clock passes any time previous process with the id could have borrowed, see IsReady
+	void Initialize(const uint64_t server_id)
+	{
+		if (server_id > UID_MAX_SERVER_ID)
+			throw std::exception("server id is out of uid range");
+
+		if (_server_id.load(std::memory_order_relaxed) == server_id)
+			return;
+
+		_time_floor.store(CurrentUidTime() + UID_MAX_LEAD_SECONDS + 1, std::memory_order_relaxed);
+		_server_id.store(server_id, std::memory_order_release);
+	}
+
+	// false until wall clock reaches time floor of Initialize, generation before it waits
+	bool IsReady() const
+	{
+		return CurrentUidTime() >= _time_floor.load(std::memory_order_relaxed);
+	}
+
+	// lanes [0, lane_count) for explicit generation, call before any thread generates
+	void ReserveLanes(const uint32_t lane_count)
+	{
+		std::lock_guard<std::mutex> guard(_lane_mutex);
+
+		if (lane_count + _automatic_lane_count > UID_LANE_COUNT)
+			throw std::exception("no more uid lane");
+
+		_reserved_lane_count = lane_count;
+	}
 
-	UidGenerator(const uint64_t server_id, const uint64_t seed_value)
+	// lane of calling thread is taken on first call and returned when the thread exits
+	uint64_t Generate(const UidType uid_type)
 	{
-		utility::Seconds current_epoch_time = utility::CurrentTimeEpoch<utility::Seconds>();
+		static thread_local LaneHolder holder;
+
+		if (holder.lane == UINT32_MAX)
+		{
+			holder.lane = AcquireLane();
+			if (holder.lane == UINT32_MAX)
+				throw std::exception("no more uid lane");
+		}
+
+		return Generate(uid_type, holder.lane);
+	}
+
+	// lane must be used by one thread only, for threads which must be found again from their ids
+	uint64_t Generate(const UidType uid_type, const uint32_t lane)
+	{
+		assert(lane < UID_LANE_COUNT);
+		assert(uid_type != UidType::Max);
+
+		UidBlock& block = _lanes[lane].blocks[static_cast<std::size_t>(uid_type)];
 
-		_block_size = static_cast<size_t>(UidType::Max) - 1;
+		uint32_t now = static_cast<uint32_t>(utility::CoarseTimeEpoch<utility::Seconds>().count() - UID_EPOCH_SECONDS);
 
-#ifdef _WIN32
-		_block = static_cast<UidBlock*>(_aligned_malloc(_block_size, _block_size * std::hardware_constructive_interference_size));
-#else
-		// _block = static_cast<UidBlock*>(posix_memalign(_block_size, _block_size * std::hardware_constructive_interference_size));
-#endif
-		// 184 467440 73709551615
-		// 000 0000 
-		for (uint32_t uid_type = static_cast<uint32_t>(UidType::User); uid_type < static_cast<uint32_t>(UidType::Max); uid_type++)
+		// caller which does not check IsReady waits here, borrowing below floor could repeat ids of previous process
+		uint32_t time_floor = _time_floor.load(std::memory_order_relaxed);
+		while (now < time_floor)
 		{
-			// _block[uid_type].current_number = 
+			std::this_thread::yield();
+			now = CurrentUidTime();
 		}
+
+		if (now > block.time)
+		{
+			block.time = now;
+			block.sequence = 0;
+		}
+		else if (block.sequence == UID_SEQUENCE_COUNT)
+		{
+			// lead is bounded, so restart wait of Initialize covers every borrowed second
+			while (block.time >= now + UID_MAX_LEAD_SECONDS)
+			{
+				std::this_thread::yield();
+				now = CurrentUidTime();
+			}
+
+			block.time++;
+			block.sequence = 0;
+		}
+
+		uint64_t uid = static_cast<uint64_t>(uid_type) << UID_TYPE_SHIFT;
+		uid |= _server_id.load(std::memory_order_relaxed) << UID_SERVER_SHIFT;
+		uid |= (static_cast<uint64_t>(block.time) & ((1ull << UID_TIME_BITS) - 1)) << UID_TIME_SHIFT;
+		uid |= static_cast<uint64_t>(lane) << UID_LANE_SHIFT;
+		uid |= block.sequence++;
+
+		return uid;
 	}
 
-	uint64_t Genarate(const UidType	uid_type)
+	static UidInfo Decode(const uint64_t uid)
 	{
+		UidInfo info;
+		info.type = static_cast<UidType>((uid >> UID_TYPE_SHIFT) & ((1ull << UID_TYPE_BITS) - 1));
+		info.server_id = (uid >> UID_SERVER_SHIFT) & UID_MAX_SERVER_ID;
+		info.time_epoch = utility::Seconds(static_cast<int64_t>((uid >> UID_TIME_SHIFT) & ((1ull << UID_TIME_BITS) - 1)) + UID_EPOCH_SECONDS);
+		info.lane = static_cast<uint32_t>((uid >> UID_LANE_SHIFT) & (UID_LANE_COUNT - 1));
+		info.sequence = static_cast<uint32_t>(uid & (UID_SEQUENCE_COUNT - 1));
 
+		return info;
 	}
-};
\ No newline at end of file
+};
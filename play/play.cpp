@@ -2,6 +2,7 @@
 #include <iostream>
 #include <engine/NetworkEngine.h>
 #include <engine/CloudConfigManager.h>
+#include <engine/MetricsServer.h>
 #include <network/iocp/IocpSocketServer.h>
 #include "play/PlayWorker.h"
 #include "play/PacketHandler.h"
@@ -17,6 +18,10 @@ int main()
 
     ServerConfig config = config_manager->GetCloudConfig();
 
+    MetricsServer* metrics_server = new MetricsServer();
+    if (config.metrics_listen_port != 0 && !metrics_server->Start(config.metrics_listen_port))
+        throw std::exception("failed to start metrics server");
+
     IocpSocketServer* intra_server = new IocpSocketServer();
     IocpSocketServer* user_server = new IocpSocketServer();
 
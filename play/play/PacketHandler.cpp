@@ -5,17 +5,20 @@
 
 void PacketHandler::OnAgencySpawnCharacterReq(IntraServerInfo* server_session, const PacketHeader& header, const packet_spawn_character_rq& packet)
 {
-	_play->_world->SpawnCharacter(server_session->session, server_session->server_info.server_id, packet);
+	_play->_world->SpawnCharacter(server_session->session, server_session->server_info.server_id, packet, header.correlation_id);
 }
 
-void PacketHandler::OnAgencyRemoveCharacterReq(IntraServerInfo* server_session, const PacketHeader& header, packet_remove_character_rq& packet)
+void PacketHandler::OnAgencyRemoveCharacterReq(IntraServerInfo* server_session, const PacketHeader& header, const packet_remove_character_rq& packet)
 {
-	_play->_world->RemoveCharacter(server_session->session, server_session->server_info.server_id, packet);
+	// world rewrites sector of forwarded request
+	packet_remove_character_rq request = packet;
+	_play->_world->RemoveCharacter(server_session->session, server_session->server_info.server_id, request);
 }
 
-void PacketHandler::OnAgencyUserMoveReq(IntraServerInfo* server_session, const PacketHeader& header, packet_character_move_rq& packet)
+void PacketHandler::OnAgencyUserMoveReq(IntraServerInfo* server_session, const PacketHeader& header, const packet_character_move_rq& packet)
 {
-	_play->_world->MoveObject(server_session->session, server_session->server_info.server_id, packet);
+	packet_character_move_rq request = packet;
+	_play->_world->MoveObject(server_session->session, server_session->server_info.server_id, request);
 }
 
 void PacketHandler::OnPlayCreateObservingObjectReq(IntraServerInfo* server_session, const PacketHeader& header, const packet_create_observing_object_rq& packet)
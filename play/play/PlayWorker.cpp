@@ -4,13 +4,20 @@
 
 bool PlayWorker::InitializeGameServer()
 {
-	_world = new World(_sector_posting_manager, utility::Milliseconds(_game_config.fixture_transform_cooltime_ms));
+	_world = new World(_sector_posting_manager, utility::Milliseconds(_game_config.fixture_transform_cooltime_ms), _game_config.world_update_concurrency);
 	return true;
 }
 
 void PlayWorker::SetPacketHandler(PacketHandler* const packet_handler)
 {
 	_packet_handler = packet_handler;
+
+	_intra_server_packet_dispatcher.Register<&PacketHandler::OnAgencySpawnCharacterReq>(_packet_handler);
+	_intra_server_packet_dispatcher.Register<&PacketHandler::OnAgencyUserMoveReq>(_packet_handler);
+	_intra_server_packet_dispatcher.Register<&PacketHandler::OnAgencyRemoveCharacterReq>(_packet_handler);
+	_intra_server_packet_dispatcher.Register<&PacketHandler::OnPlayCreateObservingObjectReq>(_packet_handler);
+	_intra_server_packet_dispatcher.Register<&PacketHandler::OnPlayRemoveObservingObjectReq>(_packet_handler);
+	_intra_server_packet_dispatcher.Register<&PacketHandler::OnPlayPromoteObjectReq>(_packet_handler);
 }
 
 bool PlayWorker::Update(const WorkerTimeUnit current_time, const WorkerTimeUnit delta_time)
@@ -18,10 +25,6 @@ bool PlayWorker::Update(const WorkerTimeUnit current_time, const WorkerTimeUnit
 	_world->Update(current_time, delta_time);
 	_packet_throttler->ForceFlushPacket();
 
-	if (delta_time.count() > 100)
-	{
-		LOG(LogLevel::Warn, "delta time is upper than %lld", delta_time.count());
-	}
 	return true;
 }
 
@@ -44,7 +47,7 @@ void PlayWorker::OnSupervisorSectorAllocation(const packet_sector_allocation_ps&
 	{
 		if (info.server_info.server_id == _my_server_info.server_id)
 		{
-			_world->AddSector(info.server_info.server_id, info.sector_id);
+			_world->AddSector(info.sector_id);
 		}
 	}
 }
@@ -59,6 +62,7 @@ void PlayWorker::OnIntraServerAccepted(IntraServerInfo* server_session)
 	if (server_session->server_info.server_type == ServerType::Agency)
 	{
 		packet_object_list_ps packet;
+		UseFrameArena(packet.object_list);
 
 		const auto& all_sectors = _world->GetAllSectors();
 
@@ -95,16 +99,3 @@ void PlayWorker::OnIntraServerClosed(IntraServerInfo* server_session)
 {
 
 }
-
-void PlayWorker::OnIntraServerData(IntraServerInfo* server_session, const PacketHeader& header, const DynamicBufferCursor<SocketBuffer>& buffer)
-{
-	switch (header.packet_type)
-	{
-		PACKET_CASE(server_session, packet_spawn_character_rq, _packet_handler->OnAgencySpawnCharacterReq);
-		PACKET_CASE(server_session, packet_character_move_rq, _packet_handler->OnAgencyUserMoveReq);
-		PACKET_CASE(server_session, packet_remove_character_rq, _packet_handler->OnAgencyRemoveCharacterReq);
-		PACKET_CASE(server_session, packet_create_observing_object_rq, _packet_handler->OnPlayCreateObservingObjectReq);
-		PACKET_CASE(server_session, packet_remove_observing_object_rq, _packet_handler->OnPlayRemoveObservingObjectReq);
-		PACKET_CASE(server_session, packet_promote_object_rq, _packet_handler->OnPlayPromoteObjectReq);
-	}
-}
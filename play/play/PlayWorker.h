@@ -30,8 +30,6 @@ public:
 	virtual void OnIntraServerConnected(IntraServerInfo* server_session) override;
 	virtual void OnIntraServerAccepted(IntraServerInfo* server_session) override;
 	virtual void OnIntraServerClosed(IntraServerInfo* server_session) override;
-
-	virtual void OnIntraServerData(IntraServerInfo* server_session, const PacketHeader& header, const DynamicBufferCursor<SocketBuffer>& buffer) override;
 };
 
 struct ConnectorAttachment
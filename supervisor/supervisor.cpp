@@ -1,6 +1,7 @@
 ﻿
 #include <iostream>
 #include <engine/NetworkEngine.h>
+#include <engine/MetricsServer.h>
 #include <network/iocp/IocpSocketServer.h>
 #include "supervisor/SupervisorWorker.h"
 
@@ -43,6 +44,10 @@ int main()
     if (engine->Start() != 0)
         throw std::exception("failed to start supervisor server engine");
 
+    MetricsServer* metrics_server = new MetricsServer();
+    if (!metrics_server->Start(9988))
+        throw std::exception("failed to start supervisor metrics server");
+
     while (true)
         std::this_thread::sleep_for(utility::Seconds(60));
 }
\ No newline at end of file
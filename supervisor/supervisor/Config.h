@@ -36,6 +36,20 @@ struct NetworkEngineOption
 	uint32_t session_reconnect_timeout_ms;
 
 	uint32_t worker_update_tick_ms;
+
+	bool use_producer_lane;
+	uint32_t producer_lane_capacity;
+	uint32_t producer_lane_max_capacity;
+
+	uint32_t worker_context_budget_us;
+	uint32_t worker_max_catch_up_ticks;
+
+	bool use_link_compression;
+	uint32_t link_compression_threshold;
+
+	uint32_t trace_sample_interval;
+
+	bool accept_packet_chunk;
 };
 */
 
@@ -63,7 +77,14 @@ constexpr ServerConfig AgencyServerConfig = {
 		256,
 		false,
 		0,
-		33
+		33,
+		false,
+		4096,
+		65536,
+		16000,
+		4,
+		true,
+		512
 	},
 
 	// user network layer
@@ -86,13 +107,25 @@ constexpr ServerConfig AgencyServerConfig = {
 		1024,
 		false,
 		0,
-		33
+		33,
+		true,
+		4096,
+		65536,
+		16000,
+		4,
+		false,
+		512,
+		1024,
+		false
 	},
 
 	{
 		33,
 		10,
 		1000,
+		4,
+		0,
+		true,
 	}
 };
 
@@ -116,7 +149,14 @@ constexpr ServerConfig PlayServerConfig = {
 		256,
 		false,
 		0,
-		33
+		33,
+		true,
+		4096,
+		65536,
+		16000,
+		4,
+		true,
+		512
 	},
 
 	0,
@@ -127,5 +167,7 @@ constexpr ServerConfig PlayServerConfig = {
 		33,
 		10,
 		1000,
+		0,
+		4,
 	}
 };
\ No newline at end of file
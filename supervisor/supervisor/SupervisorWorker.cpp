@@ -20,6 +20,10 @@ SupervisorWorker::SupervisorWorker(NetworkEngine* engine, const SocketAddress& m
 			_sector_info[sector.sector_id] = ManagedSectorInfo{ sector.sector_id, sector.grid_index, 0 };
 		}
 	}
+
+	_packet_dispatcher.Register<&SupervisorWorker::OnServerLoadServerConfig>(this);
+	_packet_dispatcher.Register<&SupervisorWorker::OnServerRegisterMinionServerReq>(this);
+	_packet_dispatcher.Register<&SupervisorWorker::OnServerRecoveryMinionServerReq>(this);
 }
 
 packet_update_intra_server_info_ps SupervisorWorker::MakeUpdateIntraServerPacket()
@@ -36,6 +40,7 @@ packet_update_intra_server_info_ps SupervisorWorker::MakeUpdateIntraServerPacket
 packet_sector_allocation_ps SupervisorWorker::MakeSectorAllocationPacket()
 {
 	packet_sector_allocation_ps packet;
+	UseFrameArena(packet.allocation_info);
 
 	for (const std::pair<uint64_t, ManagedServerInfo>& server_pair : _managed_server_list)
 	{
@@ -82,6 +87,7 @@ bool SupervisorWorker::Update(const WorkerTimeUnit current_time, const WorkerTim
 	}
 
 	packet_sector_allocation_ps sector_allocation_packet;
+	UseFrameArena(sector_allocation_packet.allocation_info);
 
 	for (std::pair<const uint64_t, ManagedSectorInfo>& sector_pair : _sector_info)
 	{
@@ -139,6 +145,7 @@ void SupervisorWorker::OnSocketSessionClosed(SocketContext* context)
 	intra_server_packet.leaved_server_info.push_back(iterator->second.server_info);
 
 	packet_sector_allocation_ps sector_allocation_packet;
+	UseFrameArena(sector_allocation_packet.deallocation_info);
 
 	for (const uint64_t sector_id : iterator->second.sector_list)
 	{
@@ -161,48 +168,10 @@ void SupervisorWorker::OnSocketSessionData(SocketContext* context)
 		return;
 	}
 
-	switch (context->header.packet_type)
+	if (_packet_dispatcher.Dispatch(context->session, context->header, context->buffer) == PacketDispatchResult::DeserializeFailed)
 	{
-	case PacketType::packet_load_server_config_rq: {
-		packet_load_server_config_rq packet;
-		if (!DeserializePacketBody(context->buffer.Data(), context->header.body_size, packet))
-		{
-			std::string format_string = std::string("failed to deserialize ") + typeid(packet_load_server_config_rq).name() + " packet, session: %llu";
-
-			LOG(LogLevel::Warn, format_string.c_str(), context->session->GetSessionId());
-			context->session->Disconnect();
-			return;
-		}
-
-		OnServerLoadServerConfig(context->session, packet);
-		break;
-	}
-	case PacketType::packet_register_minion_server_rq: {
-		packet_register_minion_server_rq packet;
-		if (!DeserializePacketBody(context->buffer.Data(), context->header.body_size, packet))
-		{
-			std::string format_string = std::string("failed to deserialize ") + typeid(packet_register_minion_server_rq).name() + " packet, session: %llu";
-
-			LOG(LogLevel::Warn, format_string.c_str(), context->session->GetSessionId());
-			context->session->Disconnect();
-			return;
-		}
-		OnServerRegisterMinionServerReq(context->session, packet);
-		break;
-	}
-	case PacketType::packet_recovery_minion_server_rq: {
-		packet_recovery_minion_server_rq packet;
-		if (!DeserializePacketBody(context->buffer.Data(), context->header.body_size, packet))
-		{
-			std::string format_string = std::string("failed to deserialize ") + typeid(packet_register_minion_server_rq).name() + " packet, session: %llu";
-
-			LOG(LogLevel::Warn, format_string.c_str(), context->session->GetSessionId());
-			context->session->Disconnect();
-			return;
-		}
-		OnServerRecoveryMinionServerReq(context->session, packet);
-		break;
-	}
+		LOG(LogLevel::Warn, "failed to deserialize %s packet, session: %llu", GetPacketTraits(context->header.packet_type).name.data(), context->session->GetSessionId());
+		context->session->Disconnect();
 	}
 }
 
@@ -214,10 +183,12 @@ void SupervisorWorker::OnServerLoadServerConfig(const SocketSessionPtr& session,
 	case ServerType::Agency:
 		response.server_config = AgencyServerConfig;
 		// response.server_config.user_listen_port = _server_port++;
+		response.server_config.metrics_listen_port = _metrics_port++;
 		break;
 	case ServerType::Play:
 		response.server_config = PlayServerConfig;
 		response.server_config.intra_server_listen_port = _server_port++;
+		response.server_config.metrics_listen_port = _metrics_port++;
 		break;
 	}
 	 
@@ -318,6 +289,7 @@ void SupervisorWorker::OnServerRecoveryMinionServerReq(const SocketSessionPtr& s
 
 	packet_update_intra_server_info_ps intra_server_packet;
 	packet_sector_allocation_ps sector_allocation_packet;
+	UseFrameArena(sector_allocation_packet.allocation_info);
 
 	_recoverying_server_list.erase(packet.server_info.server_id);
 
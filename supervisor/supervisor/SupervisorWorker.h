@@ -33,6 +33,7 @@ private:
 	uint64_t _current_server_id = SUPERVISOR_SERVER_ID + 1;
 
 	uint16_t _server_port = 11001;
+	uint16_t _metrics_port = 12001;
 
 	std::unordered_map<uint64_t, ManagedSectorInfo> _sector_info;
 	std::unordered_map<uint64_t, ManagedServerInfo> _managed_server_list;
@@ -43,6 +44,8 @@ private:
 
 	utility::Countdown<utility::Milliseconds>* _initial_delay = nullptr;
 
+	PacketDispatcher<const SocketSessionPtr&> _packet_dispatcher;
+
 	uint64_t GetNextServerId();
 
 	void OnServerLoadServerConfig(const SocketSessionPtr& session, const packet_load_server_config_rq& packet);
@@ -59,14 +62,15 @@ private:
 	}
 
 	template <NetworkPacketConcept Packet, NetworkPacketConcept... Packets>
-	void SendPacket(const SocketSessionPtr& session, const Packet& packet, Packets... packets)
+	void SendPacket(const SocketSessionPtr& session, const Packet& packet, const Packets&... packets)
 	{
 		session->Send(packet);
 		SendPacket(session, packets...);
 	}
 
+	// by reference, a copy of frame packet would allocate on heap for every server
 	template <NetworkPacketConcept... Packets>
-	void BroadcastPacket(Packets... packets)
+	void BroadcastPacket(const Packets&... packets)
 	{
 		for (const std::pair<uint32_t, ManagedServerInfo>& server : _managed_server_list)
 		{